@@ -0,0 +1,235 @@
+// Offline benchmarks of the protocol codecs, mostly on saved scenes, kept out
+// of the engine binary. Objects advance in free flight (no commands, contacts or
+// plans), which is enough for consecutive states to differ as they do live.
+//
+//   focm_bench compress <objects.json> <save.json> [more_saves.json ...]
+//   focm_bench json <objects.json> <save.json> [more_saves.json ...]
+//   focm_bench parse
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <json-c/json.h>
+
+#include "object_def.h"
+#include "file_io/hash_utils.h"
+#include "file_io/object_loader.h"
+#include "file_io/scene_loader.h"
+#include "engine/object.h"
+#include "engine/ship.h"
+#include "stream_io/lz_frame.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/tcp_protocol.h"
+
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+static double ms_since(clock::time_point t0) { return std::chrono::duration<double, std::milli>(clock::now() - t0).count(); }
+
+constexpr double kStepSeconds = 1.0 / 64.0;
+
+// Heap allocations made by this thread while g_count_allocs is set
+thread_local bool g_count_allocs = false;
+thread_local uint64_t g_allocs = 0;
+
+// A loaded save, stepped without the engine's rules
+struct Scene {
+    std::string path;
+    std::string defs_hash;
+    std::vector<std::unique_ptr<Object>> objs;
+    std::map<uint64_t, Ship*> uid_to_ship;
+    uint64_t ticks = 0;
+    double sim_time = 0.0;
+
+    void step() {
+        for (auto& o : objs) o->advance(kStepSeconds);
+        ++ticks; sim_time += kStepSeconds;
+    }
+    tcp_protocol::StateStamp stamp() const { return tcp_protocol::StateStamp{ticks, sim_time, true}; }
+    std::string state_json() const {
+        const tcp_protocol::StateStamp st = stamp();
+        std::string out;
+        tcp_protocol::write_state_json(out, uid_to_ship, objs, defs_hash, true, &st);
+        return out;
+    }
+    std::string state_frame() const {
+        const tcp_protocol::StateStamp st = stamp();
+        return tcp_protocol::build_state_frame(uid_to_ship, objs, true, &st);
+    }
+};
+
+static bool load_scenes(const char* objects_path, const std::vector<const char*>& saves,
+                        std::map<std::string, ObjectDefinition>& defs, std::vector<Scene>& out) {
+    std::string err;
+    if (!load_object_defs(objects_path, defs, &err)) { std::fprintf(stderr, "FATAL: failed to load object defs: %s\n", err.c_str()); return false; }
+    const std::string defs_hash = hash_file_fnv1a64(objects_path);
+    for (const char* path : saves) {
+        Scene s; s.path = path; s.defs_hash = defs_hash;
+        if (!load_scene_objects(path, defs, s.objs, &err)) { std::fprintf(stderr, "FATAL: failed to load save %s: %s\n", path, err.c_str()); return false; }
+        uint64_t uid = 1;
+        for (auto& o : s.objs) if (auto* sh = dynamic_cast<Ship*>(o.get())) s.uid_to_ship[uid++] = sh;
+        out.push_back(std::move(s));
+    }
+    return true;
+}
+
+// How well full state messages compress, alone and against the previous
+// message as a dictionary (as the server sends them to clients with
+// kCapLzState / kCapLzDict). Every message must decode back.
+static int bench_compress(std::vector<Scene>& scenes, int steps) {
+    struct Totals { double raw = 0, lz = 0, lz_dict = 0, enc = 0, dec = 0, enc_dict = 0, dec_dict = 0; std::string prev; tcp_protocol::LzDecoder chain; };
+    int failures = 0;
+    for (Scene& sc : scenes) {
+        Totals t[2]; // json, binary
+        for (int step = 0; step < steps; ++step) {
+            sc.step();
+            for (int f = 0; f < 2; ++f) {
+                const std::string raw = f == 0 ? sc.state_json() : sc.state_frame();
+                Totals& tt = t[f];
+                std::string back;
+                tt.raw += raw.size();
+
+                clock::time_point t0 = clock::now();
+                const std::string plain = tcp_protocol::build_compressed_frame(raw, nullptr);
+                tt.enc += ms_since(t0);
+                tt.lz += plain.empty() ? raw.size() : plain.size();
+                if (!plain.empty()) {
+                    tcp_protocol::LzDecoder one;
+                    t0 = clock::now();
+                    const bool ok = one.decode(plain.data(), plain.size(), back);
+                    tt.dec += ms_since(t0);
+                    if (!ok || back != raw) ++failures;
+                }
+
+                t0 = clock::now();
+                const std::string chained = tcp_protocol::build_compressed_frame(raw, tt.prev.empty() ? nullptr : &tt.prev);
+                tt.enc_dict += ms_since(t0);
+                tt.lz_dict += chained.empty() ? raw.size() : chained.size();
+                if (!chained.empty()) {
+                    t0 = clock::now();
+                    const bool ok = tt.chain.decode(chained.data(), chained.size(), back);
+                    tt.dec_dict += ms_since(t0);
+                    if (!ok || back != raw) ++failures;
+                    tt.prev = raw; // the dictionary only advances on compressed messages
+                }
+            }
+        }
+        std::printf("# %s: ships=%zu objs=%zu steps=%d\n", sc.path.c_str(), sc.uid_to_ship.size(), sc.objs.size(), steps);
+        for (int f = 0; f < 2; ++f) {
+            const Totals& tt = t[f];
+            const double n = steps;
+            std::printf("%-6s raw=%.0fB  lz=%.0fB (%.2fx, enc %.3fms dec %.3fms)  lz+dict=%.0fB (%.2fx, enc %.3fms dec %.3fms)\n",
+                        f == 0 ? "json" : "binary", tt.raw / n,
+                        tt.lz / n, tt.raw / std::max(tt.lz, 1.0), tt.enc / n, tt.dec / n,
+                        tt.lz_dict / n, tt.raw / std::max(tt.lz_dict, 1.0), tt.enc_dict / n, tt.dec_dict / n);
+        }
+    }
+    if (failures) std::fprintf(stderr, "ERR %d compressed messages did not round-trip\n", failures);
+    return failures ? 1 : 0;
+}
+
+// Encode each scene's full state line with the streaming writer into a
+// reused buffer (as the server's build_state_json callback does), reporting
+// size, time and heap allocations per line after a warmup line. Every line
+// must parse back with all the scene's objects.
+static int bench_json(std::vector<Scene>& scenes, int steps) {
+    int failures = 0;
+    std::vector<tcp_protocol::NetObjectView> objs;
+    for (Scene& sc : scenes) {
+        std::string out;
+        double bytes = 0.0, ms = 0.0; uint64_t allocs = 0;
+        for (int step = 0; step <= steps; ++step) {
+            sc.step();
+            const tcp_protocol::StateStamp st = sc.stamp();
+            out.clear();
+            g_allocs = 0; g_count_allocs = true;
+            const clock::time_point t0 = clock::now();
+            tcp_protocol::write_state_json(out, sc.uid_to_ship, sc.objs, sc.defs_hash, true, &st);
+            const double dt = ms_since(t0);
+            g_count_allocs = false;
+            std::string defs_hash;
+            // Ships are listed on their own and again among the objects
+            if (!tcp_protocol::parse_state_objects(out, objs, &defs_hash) || defs_hash != sc.defs_hash
+                || objs.size() != sc.uid_to_ship.size() + sc.objs.size()) ++failures;
+            if (step == 0) continue; // warmup: the buffer grows to its working size
+            bytes += out.size(); ms += dt; allocs += g_allocs;
+        }
+        const double n = steps;
+        std::printf("# %s: ships=%zu objs=%zu lines=%d\n", sc.path.c_str(), sc.uid_to_ship.size(), sc.objs.size(), steps);
+        std::printf("json   %.0fB  %.3fms  %.2f allocations per line\n", bytes / n, ms / n, (double)allocs / n);
+    }
+    if (failures) std::fprintf(stderr, "ERR %d state lines did not parse back\n", failures);
+    return failures ? 1 : 0;
+}
+
+// Parse a typical mix of client messages (two commands, an end of turn, a
+// state ack) the way the server's network thread does, against json-c
+// tokenizing the same lines as a reference
+static int bench_parse(int rounds) {
+    const std::string lines[] = {
+        tcp_protocol::build_cmd("THROTTLE", 123456789, 0.75, false),
+        tcp_protocol::build_cmd("HEADING", 123456789, 1.25, true),
+        tcp_protocol::build_end_turn(1.0),
+        tcp_protocol::build_state_ack(4242),
+    };
+    const double msgs = (double)rounds * (sizeof(lines) / sizeof(lines[0]));
+    int failures = 0;
+    tcp_protocol::ClientMsg msg;
+    g_allocs = 0; g_count_allocs = true;
+    clock::time_point t0 = clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto& l : lines) if (!tcp_protocol::parse_client_message(l, msg)) ++failures;
+    const double ms = ms_since(t0);
+    g_count_allocs = false;
+    const uint64_t allocs = g_allocs;
+    t0 = clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const auto& l : lines) { json_object* o = json_tokener_parse(l.c_str()); if (!o) ++failures; json_object_put(o); }
+    const double ms_jsonc = ms_since(t0);
+    std::printf("parse_client_message  %.2fM msgs/s  %.2f allocations per message\n", msgs / ms / 1000.0, (double)allocs / msgs);
+    std::printf("json_tokener_parse    %.2fM msgs/s\n", msgs / ms_jsonc / 1000.0);
+    if (failures) std::fprintf(stderr, "ERR %d messages did not parse\n", failures);
+    return failures ? 1 : 0;
+}
+
+static int usage(const char* argv0) {
+    std::fprintf(stderr, "Usage: %s compress|json <objects.json> <save.json> [more_saves.json ...]\n"
+                         "       %s parse\n", argv0, argv0);
+    return 2;
+}
+
+} // namespace bench
+
+// Counting replacement of the global allocator (see g_count_allocs)
+void* operator new(std::size_t n) {
+    if (bench::g_count_allocs) ++bench::g_allocs;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+// (GCC pairs free with the replaced operator new as if it were the default one)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+int main(int argc, char** argv) {
+    using namespace bench;
+    if (argc < 2) return usage(argv[0]);
+    const std::string mode = argv[1];
+    if (mode == "parse") return bench_parse(1000000);
+    if ((mode != "compress" && mode != "json") || argc < 4) return usage(argv[0]);
+    std::map<std::string, ObjectDefinition> defs;
+    std::vector<Scene> scenes;
+    if (!load_scenes(argv[2], std::vector<const char*>(argv + 3, argv + argc), defs, scenes)) return 1;
+    return mode == "json" ? bench_json(scenes, 64) : bench_compress(scenes, 64);
+}
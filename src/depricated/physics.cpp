@@ -74,8 +74,8 @@ get_collision_time (const std::vector<PhysicsBody> &bodies,
 std::vector<DebrisSpawn>
 compute_debris_for (const Object &obj, int team, std::mt19937 &rng)
 {
-    // 10 debris2, 2 debris1, 1 debris3
-    struct Req { const char* key; int count; } reqs[] = { {"debris2", 10}, {"debris1", 2}, {"debris3", 1} };
+    // 10 debris2, 2 debris1, 1 debris3 (pieces index kDebrisKeys)
+    struct Req { int piece; int count; } reqs[] = { {0, 10}, {1, 2}, {2, 1} };
     std::normal_distribution<double> nboost(0.0, 300.0);
     std::normal_distribution<double> nspin(0.0, 1.0);
     std::uniform_real_distribution<double> utheta(0.0, 2.0*M_PI);
@@ -91,7 +91,8 @@ compute_debris_for (const Object &obj, int team, std::mt19937 &rng)
             double dvx = mag * std::cos(theta);
             double dvy = mag * std::sin(theta);
             DebrisSpawn d;
-            d.key = r.key;
+            d.piece = r.piece;
+            d.key = kDebrisKeys[r.piece];
             d.x = sx; d.y = sy;
             d.vx = svx + dvx; d.vy = svy + dvy;
             d.ang_vel = nspin(rng);
@@ -28,8 +28,14 @@ float get_collision_time (const std::vector<PhysicsBody> &bodies,
                           float time_horizon,
                           float minx, float miny, float maxx, float maxy);
 
+// Debris object keys; DebrisSpawn::piece indexes this table so callers can
+// resolve the definitions once instead of per spawn.
+constexpr int kDebrisPieceCount = 3;
+constexpr const char* kDebrisKeys[kDebrisPieceCount] = { "debris2", "debris1", "debris3" };
+
 struct DebrisSpawn {
-    std::string key; // which debris object to use (e.g., "debris2")
+    int piece = 0;           // index into kDebrisKeys
+    const char* key = "";    // kDebrisKeys[piece]
     double x = 0.0;
     double y = 0.0;
     double vx = 0.0;
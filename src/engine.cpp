@@ -26,6 +26,8 @@
 #include "engine/ship.h"
 #include "engine/planet.h"
 #include "engine/command.h"
+#include "engine/object_factory.h"
+#include "engine/spatial_grid.h"
 #include "physics.h"
 
 #include <sys/types.h>
@@ -36,9 +38,12 @@
 #include <fcntl.h>
 
 #include "stream_io/tcp_protocol.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/interest.h"
 #include "stream_io/server.h"
 #include "file_io/hash_utils.h"
 #include <set>
+#include <csignal>
 
 namespace engine_main {
 
@@ -56,13 +61,16 @@ static bool parse_kv_double(const std::string& s, const char* key, double& out)
 }
 
 struct World {
-    std::map<std::string, ObjectDefinition> defs;
+    const std::map<std::string, ObjectDefinition>* defs = nullptr; // read-only, shared by every hosted world
+    const ObjectDefinition* debris_defs[physics::kDebrisPieceCount] = {}; // resolved kDebrisKeys
     std::vector<std::unique_ptr<Object>> objs;
     std::vector<Command> command_stack;
     std::mt19937 rng{std::random_device{}()};
     std::map<uint64_t, Ship*> uid_to_ship;
     uint64_t next_uid = 1;
     std::string defs_hash;
+    double sim_time = 0.0; // seconds simulated so far (drives maneuver plans)
+    SpatialGrid grid;      // scratch index for ray/broadphase queries
 };
 
 static void rebuild_uid_map_stable(World& w) {
@@ -91,8 +99,135 @@ static void remove_object_ptr(std::vector<std::unique_ptr<Object>>& objs, Object
     for (size_t i = 0; i < objs.size(); ++i) if (objs[i].get() == p) { objs.erase(objs.begin() + i); return; }
 }
 
+// Resolve per-world lookup tables once after defs are loaded.
+static void index_defs(World& w) {
+    for (int i = 0; i < physics::kDebrisPieceCount; ++i) {
+        auto it = w.defs->find(physics::kDebrisKeys[i]);
+        w.debris_defs[i] = (it != w.defs->end()) ? &it->second : nullptr;
+    }
+}
+
+static void spawn_debris(World& w, const Ship& sh) {
+    auto debris = ::spawn_debris_for(sh, sh.team, w.rng);
+    for (const auto& d : debris) {
+        const ObjectDefinition* ddef = w.debris_defs[d.piece];
+        if (!ddef) continue;
+        InitialState init; init.x = (float)d.x; init.y = (float)d.y; init.vx = (float)d.vx; init.vy = (float)d.vy; init.team = d.team; init.has_x = true; init.has_y = true; init.has_vx = true; init.has_vy = true; { double ang = std::atan2(d.vy, d.vx); init.theta = (float)ang; init.has_theta = true; } init.has_give_commands = true; init.give_commands = false; init.has_ang_vel = true; init.ang_vel = (float)d.ang_vel;
+        w.objs.push_back(make_object(*ddef, init));
+    }
+}
+
+// Resolve laser shots as instantaneous ray casts: the first ship along each ray
+// within range is destroyed unless a planet occludes it first. Ships are
+// indexed once per volley, so each shot only visits the cells it crosses.
+static void resolve_hitscan(World& w, const std::vector<HitscanShot>& shots) {
+    if (shots.empty()) return;
+    std::vector<Ship*> ships; std::vector<const Planet*> planets; double max_r = 0.0;
+    for (auto& o : w.objs) {
+        if (o->dead) continue;
+        if (auto* sh = dynamic_cast<Ship*>(o.get())) { ships.push_back(sh); if (sh->def) max_r = std::max(max_r, sh->def->radius); }
+        else if (auto* pl = dynamic_cast<const Planet*>(o.get())) planets.push_back(pl);
+    }
+    w.grid.clear(std::max(256.0, 4.0 * max_r));
+    for (size_t i = 0; i < ships.size(); ++i) w.grid.insert((uint32_t)i, ships[i]->x_pixels(), ships[i]->y_pixels(), ships[i]->def ? ships[i]->def->radius : 0.0);
+
+    std::vector<Object*> killed;
+    for (const auto& s : shots) {
+        double max_t = s.range;
+        for (const Planet* p : planets) {
+            double t;
+            if (ray_circle(s.ox, s.oy, s.dx, s.dy, p->x_pixels(), p->y_pixels(), p->radius_pixels, t) && t < max_t) max_t = t;
+        }
+        SpatialGrid::RayHit hit;
+        auto accept = [&](uint32_t h){ return ships[h] != s.shooter && !ships[h]->dead; };
+        if (!w.grid.raycast(s.ox, s.oy, s.dx, s.dy, max_t, accept, hit)) continue;
+        Ship* target = ships[hit.handle];
+        target->dead = true;
+        spawn_debris(w, *target);
+        killed.push_back(target);
+    }
+    for (auto* p : killed) remove_object_ptr(w.objs, p);
+}
+
+// Apply a command stack to the world, including hitscan resolution.
+static void apply_world_commands(World& w, std::vector<Command>& stack) {
+    std::vector<HitscanShot> shots;
+    apply_commands(stack, w.objs, shots);
+    resolve_hitscan(w, shots);
+}
+
+// A ship's path over one substep, in fixed-point units.
+struct ShipSweep { Ship* ship; int64_t x0, y0; };
+
+// Continuous ship-ship collision over the substep just advanced. Each ship's
+// swept circle goes into the grid as a bounding circle of its path; candidate
+// pairs get an exact time of impact and contacts are handled in time order,
+// so a ship destroyed early in the substep cannot collide again later in it.
+static void resolve_ship_contacts(World& w, const std::vector<ShipSweep>& sweeps) {
+    if (sweeps.size() < 2) return;
+    const double inv = 1.0 / (double)Object::FP_ONE;
+    double max_r = 0.0;
+    for (const auto& s : sweeps) if (s.ship->def) max_r = std::max(max_r, s.ship->def->radius);
+    w.grid.clear(std::max(256.0, 4.0 * max_r));
+    for (size_t i = 0; i < sweeps.size(); ++i) {
+        const Ship* sh = sweeps[i].ship;
+        double hx = (double)(sh->x - sweeps[i].x0) * inv * 0.5, hy = (double)(sh->y - sweeps[i].y0) * inv * 0.5;
+        double r = (sh->def ? sh->def->radius : 0.0) + std::sqrt(hx*hx + hy*hy);
+        w.grid.insert((uint32_t)i, (double)sweeps[i].x0 * inv + hx, (double)sweeps[i].y0 * inv + hy, r);
+    }
+
+    struct Contact { double t; uint32_t a, b; };
+    std::vector<Contact> contacts; std::vector<uint32_t> cand;
+    for (uint32_t i = 0; i < (uint32_t)sweeps.size(); ++i) {
+        const Ship* A = sweeps[i].ship;
+        double ax0 = (double)sweeps[i].x0 * inv, ay0 = (double)sweeps[i].y0 * inv;
+        double ax1 = A->x_pixels(), ay1 = A->y_pixels();
+        double ra = A->def ? A->def->radius : 0.0;
+        w.grid.query_aabb(std::min(ax0, ax1) - ra, std::min(ay0, ay1) - ra,
+                          std::max(ax0, ax1) + ra, std::max(ay0, ay1) + ra, cand);
+        for (uint32_t j : cand) {
+            if (j <= i) continue; // each pair once
+            const Ship* B = sweeps[j].ship;
+            if (!can_collide(*A, *B)) continue;
+            double bx0 = (double)sweeps[j].x0 * inv, by0 = (double)sweeps[j].y0 * inv;
+            double rb = B->def ? B->def->radius : 0.0;
+            double mx = (B->x_pixels() - bx0) - (ax1 - ax0), my = (B->y_pixels() - by0) - (ay1 - ay0);
+            double t;
+            if (swept_circle_toi(bx0 - ax0, by0 - ay0, mx, my, ra + rb, t)) contacts.push_back(Contact{t, i, j});
+        }
+    }
+    if (contacts.empty()) return;
+    std::sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b){ return a.t < b.t; });
+
+    std::vector<Object*> rm;
+    for (const auto& c : contacts) {
+        Ship* A = sweeps[c.a].ship; Ship* B = sweeps[c.b].ship;
+        if (A->dead || B->dead) continue;
+        // Wreck both at their contact positions
+        for (uint32_t k : {c.a, c.b}) {
+            Ship* sh = sweeps[k].ship;
+            sh->x = sweeps[k].x0 + (int64_t)std::llround(c.t * (double)(sh->x - sweeps[k].x0));
+            sh->y = sweeps[k].y0 + (int64_t)std::llround(c.t * (double)(sh->y - sweeps[k].y0));
+            sh->dead = true;
+            spawn_debris(w, *sh);
+            rm.push_back(sh);
+        }
+    }
+    for (auto* p : rm) remove_object_ptr(w.objs, p);
+}
+
 static void step_world(World& w, double dt) {
+    // Maneuver plans act at substep granularity, independent of the client turn queue
+    std::vector<Command> plan_stack;
+    queue_plan_steps(w.objs, w.sim_time, plan_stack);
+    if (!plan_stack.empty()) apply_world_commands(w, plan_stack);
+    w.sim_time += dt;
+    std::vector<ShipSweep> sweeps;
+    for (auto& o : w.objs) {
+        if (auto* sh = dynamic_cast<Ship*>(o.get())) { if (!sh->dead) sweeps.push_back(ShipSweep{sh, sh->x, sh->y}); }
+    }
     for (auto& o : w.objs) o->advance(dt);
+    resolve_ship_contacts(w, sweeps);
     // Projectile-ship collisions
     std::vector<Object*> rm_bullets; std::vector<Object*> rm_ships;
     for (size_t i = 0; i < w.objs.size(); ++i) {
@@ -110,20 +245,10 @@ static void step_world(World& w, double dt) {
                 double dy = oi->y_pixels() - oj->y_pixels();
                 double R = oj->def ? oj->def->radius : 0.0;
                 if (dx*dx + dy*dy <= R*R) {
+                    // Mark both dead first so the debris spawned below cannot re-hit this ship
+                    oi->dead = true; oj->dead = true;
                     rm_bullets.push_back(oi);
-                    if (auto* sh = dynamic_cast<Ship*>(oj)) {
-                        auto debris = ::spawn_debris_for(*sh, sh->team, w.rng);
-                        for (const auto& d : debris) {
-                            auto itdef = w.defs.find(d.key);
-                            if (itdef != w.defs.end()) {
-                                const auto& ddef = itdef->second;
-                                InitialState init; init.object = d.key; init.x = (float)d.x; init.y = (float)d.y; init.vx = (float)d.vx; init.vy = (float)d.vy; init.team = d.team; init.has_x = true; init.has_y = true; init.has_vx = true; init.has_vy = true; { double ang = std::atan2(d.vy, d.vx); init.theta = (float)ang; init.has_theta = true; } init.has_give_commands = true; init.give_commands = false; init.has_ang_vel = true; init.ang_vel = (float)d.ang_vel;
-                                if (ddef.type == "ship") w.objs.push_back(std::make_unique<Ship>(ddef, init));
-                                else if (ddef.type == "planet") w.objs.push_back(std::make_unique<Planet>(ddef, init));
-                                else w.objs.push_back(std::make_unique<Object>(ddef, init));
-                            }
-                        }
-                    }
+                    if (auto* sh = dynamic_cast<Ship*>(oj)) spawn_debris(w, *sh);
                     rm_ships.push_back(oj);
                     break;
                 }
@@ -135,61 +260,16 @@ static void step_world(World& w, double dt) {
 }
 
 static void end_of_turn_cleanup(World& w) {
-    // Ship-ship overlap -> both destroyed with debris
-    std::vector<Object*> rm;
-    for (size_t i = 0; i < w.objs.size(); ++i) {
-        for (size_t j = i + 1; j < w.objs.size(); ++j) {
-            auto* A = w.objs[i].get();
-            auto* B = w.objs[j].get();
-            if (!A || !B) continue;
-            if (A->type != Object::SHIP || B->type != Object::SHIP) continue;
-            if (!can_collide(*A, *B)) continue;
-            double dx = A->x_pixels() - B->x_pixels();
-            double dy = A->y_pixels() - B->y_pixels();
-            double RA = A->def ? A->def->radius : 0.0;
-            double RB = B->def ? B->def->radius : 0.0;
-            double R = RA + RB;
-            if (dx*dx + dy*dy <= R*R) {
-                if (auto* AS = dynamic_cast<Ship*>(A)) {
-                    auto debrisA = ::spawn_debris_for(*AS, AS->team, w.rng);
-                    for (const auto& d : debrisA) {
-                        auto itdef = w.defs.find(d.key);
-                        if (itdef != w.defs.end()) {
-                            const auto& ddef = itdef->second;
-                            InitialState init; init.object = d.key; init.x = (float)d.x; init.y = (float)d.y; init.vx = (float)d.vx; init.vy = (float)d.vy; init.team = d.team; init.has_x = true; init.has_y = true; init.has_vx = true; init.has_vy = true; { double ang = std::atan2(d.vy, d.vx); init.theta = (float)ang; init.has_theta = true; } init.has_give_commands = true; init.give_commands = false; init.has_ang_vel = true; init.ang_vel = (float)d.ang_vel;
-                            if (ddef.type == "ship") w.objs.push_back(std::make_unique<Ship>(ddef, init));
-                            else if (ddef.type == "planet") w.objs.push_back(std::make_unique<Planet>(ddef, init));
-                            else w.objs.push_back(std::make_unique<Object>(ddef, init));
-                        }
-                    }
-                }
-                if (auto* BS = dynamic_cast<Ship*>(B)) {
-                    auto debrisB = ::spawn_debris_for(*BS, BS->team, w.rng);
-                    for (const auto& d : debrisB) {
-                        auto itdef = w.defs.find(d.key);
-                        if (itdef != w.defs.end()) {
-                            const auto& ddef = itdef->second;
-                            InitialState init; init.object = d.key; init.x = (float)d.x; init.y = (float)d.y; init.vx = (float)d.vx; init.vy = (float)d.vy; init.team = d.team; init.has_x = true; init.has_y = true; init.has_vx = true; init.has_vy = true; { double ang = std::atan2(d.vy, d.vx); init.theta = (float)ang; init.has_theta = true; } init.has_give_commands = true; init.give_commands = false; init.has_ang_vel = true; init.ang_vel = (float)d.ang_vel;
-                            if (ddef.type == "ship") w.objs.push_back(std::make_unique<Ship>(ddef, init));
-                            else if (ddef.type == "planet") w.objs.push_back(std::make_unique<Planet>(ddef, init));
-                            else w.objs.push_back(std::make_unique<Object>(ddef, init));
-                        }
-                    }
-                }
-                rm.push_back(A); rm.push_back(B);
-            }
-        }
-    }
-    for (auto* p : rm) remove_object_ptr(w.objs, p);
-    // Reset per-turn states
-    for (auto& o : w.objs) if (auto sh = dynamic_cast<Ship*>(o.get())) { sh->throttle = 0; sh->fired_this_turn = false; }
+    // Ship-ship contacts are resolved continuously in step_world
+    // Reset per-turn states; an active maneuver plan keeps control of throttle
+    for (auto& o : w.objs) if (auto sh = dynamic_cast<Ship*>(o.get())) { if (!sh->plan.active()) sh->throttle = 0; sh->fired_this_turn = false; }
 }
 
 static void handle_command_line(World& w, const std::string& line) {
     if (line.empty()) return;
     if (line[0] == '#') return;
     if (line == "END_TURN") {
-        apply_commands(w.command_stack, w.objs, w.defs);
+        apply_world_commands(w, w.command_stack);
         double min_dt = (g_min_time_step > 0.0 ? g_min_time_step : 1.0/64.0);
         int steps = (int)std::ceil(1.0 / min_dt);
         if (steps < 1) steps = 1;
@@ -253,9 +333,42 @@ static void handle_command_line(World& w, const std::string& line) {
         if (!parse_kv_u64(line, "uid", uid)) { std::fprintf(stderr, "ERR missing uid in FIRE\n"); return; }
         if (!parse_kv_double(line, "theta", th)) { std::fprintf(stderr, "ERR missing theta in FIRE\n"); return; }
         Command c; c.type = Command::Type::FIRE; c.uid = uid; c.a = th;
-        if (auto* s = find_ship(w, uid)) { c.ship = s; c.key = pick_projectile_key(*s); } else { std::fprintf(stderr, "ERR unknown uid=%llu\n", (unsigned long long)uid); return; }
+        if (auto* s = find_ship(w, uid)) c.ship = s; else { std::fprintf(stderr, "ERR unknown uid=%llu\n", (unsigned long long)uid); return; }
         queue_command(c, w.command_stack); return;
     }
+    if (line.rfind("PLAN", 0) == 0) {
+        // PLAN uid=N steps=t:OP:arg;t:OP:arg;...   or   PLAN uid=N CANCEL
+        uint64_t uid=0;
+        if (!parse_kv_u64(line, "uid", uid)) { std::fprintf(stderr, "ERR missing uid in PLAN\n"); return; }
+        Ship* s = find_ship(w, uid);
+        if (!s) { std::fprintf(stderr, "ERR unknown uid=%llu\n", (unsigned long long)uid); return; }
+        std::vector<PlanStep> steps;
+        size_t p = line.find("steps=");
+        if (p != std::string::npos && line.find("CANCEL") == std::string::npos) {
+            p += 6; size_t e = line.find(' ', p);
+            std::stringstream ss(line.substr(p, e == std::string::npos ? std::string::npos : e - p));
+            std::string tok;
+            while (std::getline(ss, tok, ';')) {
+                size_t c1 = tok.find(':'); size_t c2 = (c1 == std::string::npos) ? c1 : tok.find(':', c1 + 1);
+                if (c2 == std::string::npos) { std::fprintf(stderr, "ERR bad PLAN step: %s\n", tok.c_str()); return; }
+                std::string op = tok.substr(c1 + 1, c2 - c1 - 1);
+                // Times sort the plan and must come due: finite and not negative
+                char* t_end = nullptr; char* a_end = nullptr;
+                PlanStep st; st.t = (float)std::strtod(tok.c_str(), &t_end); st.a = (float)std::strtod(tok.c_str() + c2 + 1, &a_end);
+                if (c1 == 0 || t_end != tok.c_str() + c1 || !std::isfinite(st.t) || st.t < 0.0f
+                    || c2 + 1 == tok.size() || a_end != tok.c_str() + tok.size() || !std::isfinite(st.a)) {
+                    std::fprintf(stderr, "ERR bad PLAN step: %s\n", tok.c_str()); return;
+                }
+                if (op == "THROTTLE") st.op = PlanStep::THROTTLE;
+                else if (op == "HEADING") st.op = PlanStep::HEADING;
+                else if (op == "FIRE") st.op = PlanStep::FIRE;
+                else { std::fprintf(stderr, "ERR unknown PLAN op: %s\n", op.c_str()); return; }
+                steps.push_back(st);
+            }
+        }
+        attach_plan(*s, std::move(steps), w.sim_time);
+        return;
+    }
     std::fprintf(stderr, "ERR unknown command: %s\n", line.c_str());
 }
 
@@ -271,59 +384,113 @@ static void print_ship_index(World& w) {
     }
 }
 
+// Build a world from a save on top of already loaded (shared) defs.
+static bool load_world(World& w, const std::map<std::string, ObjectDefinition>& defs, const std::string& defs_hash,
+                       const char* save_path, std::string* err) {
+    w.defs = &defs; w.defs_hash = defs_hash;
+    index_defs(w);
+    if (!load_scene_objects(save_path, defs, w.objs, err)) return false;
+    rebuild_uid_map_stable(w);
+    return true;
+}
+
 // server moved to stream_io/server.{h,cpp}
 
+// A world served by run_engine_server with the per-world scratch its
+// callbacks use
+struct HostedWorld {
+    World world;
+    std::string json_buf; // reused: the state line is written in place, then copied out once
+    tcp_protocol::InterestIndex interest;
+    explicit HostedWorld(double interest_radius) : interest(interest_radius) {}
+};
+
+static ServerCallbacks make_server_callbacks(HostedWorld& h, double interest_radius) {
+    World& world = h.world;
+    ServerCallbacks cbs;
+    cbs.step_world_dt = [&](double dt){ step_world(world, dt); };
+    cbs.apply_queued_commands = [&](){ apply_world_commands(world, world.command_stack); };
+    cbs.rebuild_uid_map = [&](){ rebuild_uid_map_stable(world); };
+    cbs.end_of_turn_cleanup = [&](){ end_of_turn_cleanup(world); };
+    cbs.find_ship_by_uid = [&](uint64_t uid){ return find_ship(world, uid); };
+    cbs.build_state_json = [&](bool all, const tcp_protocol::StateStamp* stamp){ h.json_buf.clear(); tcp_protocol::write_state_json(h.json_buf, world.uid_to_ship, world.objs, world.defs_hash, all, stamp); return h.json_buf; };
+    cbs.build_state_frame = [&](bool all, const tcp_protocol::StateStamp* stamp){ return tcp_protocol::build_state_frame(world.uid_to_ship, world.objs, all, stamp); };
+    cbs.collect_ship_records = [&](std::vector<tcp_protocol::ShipRecord>& out){ tcp_protocol::collect_ship_records(world.uid_to_ship, out); };
+    if (interest_radius > 0.0) {
+        cbs.update_interest = [&](){ h.interest.build(world.uid_to_ship, world.objs); };
+        cbs.select_interest = [&](const tcp_protocol::InterestHint& hint, bool all, tcp_protocol::InterestSelection& out){ h.interest.select(hint, all, out); };
+    }
+    cbs.queue_command = [&](const Command& c){ queue_command(c, world.command_stack); };
+    cbs.set_plan = [&](Ship* s, std::vector<PlanStep> steps){ attach_plan(*s, std::move(steps), world.sim_time); };
+    cbs.get_defs_hash = [&](){ return world.defs_hash; };
+    cbs.get_def_keys = [&](){ std::vector<std::string> out; for (const auto* d : object_defs_by_id(*world.defs)) out.push_back(d ? d->key : std::string()); return out; };
+    cbs.get_required_teams = [&](){ std::vector<int> out; std::set<int> st; for (const auto& kv : world.uid_to_ship) if (kv.second) st.insert(kv.second->team); out.assign(st.begin(), st.end()); return out; };
+    return cbs;
+}
+
 } // namespace engine_main
 
 int main(int argc, char** argv) {
     using namespace engine_main;
     if (argc < 3) {
-        std::fprintf(stderr, "Usage: %s <objects.json> <save.json>\n", argv[0]);
+        std::fprintf(stderr, "Usage: %s <objects.json> <save.json> [more_saves.json ...] [--stdin]\n", argv[0]);
         return LOADING_ERROR;
     }
     const char* objects_path = argv[1];
-    const char* save_path = argv[2];
+    // Each save is one hosted world; --stdin drives the first one only
+    std::vector<const char*> save_paths;
+    bool use_stdin = false;
+    for (int i = 2; i < argc; ++i) {
+        if (std::string(argv[i]) == "--stdin") use_stdin = true;
+        else save_paths.push_back(argv[i]);
+    }
+    if (save_paths.empty()) { std::fprintf(stderr, "FATAL: no save given\n"); return LOADING_ERROR; }
 
-    World world;
+    // Object definitions are loaded once and shared read-only by every world
+    std::map<std::string, ObjectDefinition> defs;
     std::string err;
-    if (!load_object_defs(objects_path, world.defs, &err)) {
+    if (!load_object_defs(objects_path, defs, &err)) {
         std::fprintf(stderr, "FATAL: failed to load object defs: %s\n", err.c_str());
         return LOADING_ERROR;
     }
-    world.defs_hash = hash_file_fnv1a64(objects_path);
-    err.clear();
-    if (!load_scene_objects(save_path, world.defs, world.objs, &err)) {
-        std::fprintf(stderr, "FATAL: failed to load save: %s\n", err.c_str());
-        return LOADING_ERROR;
-    }
-
-    rebuild_uid_map_stable(world);
-    std::fprintf(stderr, "[engine] loaded: objs=%zu ships=%zu\n", world.objs.size(), world.uid_to_ship.size());
-    print_ship_index(world);
+    const std::string defs_hash = hash_file_fnv1a64(objects_path);
 
     // Load game.json to get network port and paths
     GameConfig cfg; std::string cfg_err; (void)load_game_config("config/game.json", cfg, &cfg_err);
     int port = cfg.net_port;
     g_min_time_step = (cfg.min_time_step > 0.0 ? cfg.min_time_step : 1.0/64.0);
 
-    bool use_stdin = (argc >= 4 && std::string(argv[3]) == "--stdin");
+    // Server mode hosts max(sessions, saves given) worlds, cycling through the saves
+    const size_t count = use_stdin ? 1 : std::max((size_t)cfg.sessions, save_paths.size());
+    std::vector<std::unique_ptr<HostedWorld>> worlds;
+    for (size_t i = 0; i < count; ++i) {
+        worlds.push_back(std::make_unique<HostedWorld>(cfg.interest_radius));
+        World& world = worlds.back()->world;
+        const char* save_path = save_paths[i % save_paths.size()];
+        err.clear();
+        if (!load_world(world, defs, defs_hash, save_path, &err)) {
+            std::fprintf(stderr, "FATAL: failed to load save: %s\n", err.c_str());
+            return LOADING_ERROR;
+        }
+        if (count > 1) std::fprintf(stderr, "[engine] world %zu loaded from %s: objs=%zu ships=%zu\n", i, save_path, world.objs.size(), world.uid_to_ship.size());
+        else std::fprintf(stderr, "[engine] loaded: objs=%zu ships=%zu\n", world.objs.size(), world.uid_to_ship.size());
+    }
+    print_ship_index(worlds[0]->world);
+
     if (!use_stdin) {
         // Default: multi-client server mode
-        ServerCallbacks cbs;
-        cbs.step_world_dt = [&](double dt){ step_world(world, dt); };
-        cbs.apply_queued_commands = [&](){ apply_commands(world.command_stack, world.objs, world.defs); };
-        cbs.rebuild_uid_map = [&](){ rebuild_uid_map_stable(world); };
-        cbs.end_of_turn_cleanup = [&](){ end_of_turn_cleanup(world); };
-        cbs.find_ship_by_uid = [&](uint64_t uid){ return find_ship(world, uid); };
-        cbs.build_state_json = [&](bool all){ return tcp_protocol::build_state_json(world.uid_to_ship, world.objs, world.defs_hash, all); };
-        cbs.queue_command = [&](const Command& c){ queue_command(c, world.command_stack); };
-        cbs.get_defs_hash = [&](){ return world.defs_hash; };
-        cbs.get_required_teams = [&](){ std::vector<int> out; std::set<int> st; for (const auto& kv : world.uid_to_ship) if (kv.second) st.insert(kv.second->team); out.assign(st.begin(), st.end()); return out; };
-        run_engine_server(port, g_min_time_step, cbs);
+        std::vector<ServerCallbacks> cbs;
+        for (auto& h : worlds) cbs.push_back(make_server_callbacks(*h, cfg.interest_radius));
+        // Ctrl-C / SIGTERM wake the server loop so it closes its sockets cleanly
+        std::signal(SIGINT, [](int){ stop_engine_server(); });
+        std::signal(SIGTERM, [](int){ stop_engine_server(); });
+        TickConfig tick; tick.tick_rate = cfg.tick_rate; tick.time_scale = cfg.time_scale;
+        tick.max_time_scale = cfg.max_time_scale; tick.max_catchup_steps = cfg.max_catchup_steps;
+        run_engine_server(port, g_min_time_step, cbs, tick, cfg.session_workers, cfg.net_resume_grace);
     } else {
         // Stdin mode for quick tests (e.g., cat engine_test.txt | ./main_engine ... --stdin)
         std::string line;
-        while (std::getline(std::cin, line)) handle_command_line(world, line);
+        while (std::getline(std::cin, line)) handle_command_line(worlds[0]->world, line);
     }
     return 0;
 }
@@ -1,6 +1,7 @@
 #include "command.h"
-#include "planet.h"
+#include "object_factory.h"
 
+#include <algorithm>
 #include <cmath>
 
 static inline bool same_target(const Command& a, const Command& b) {
@@ -24,18 +25,9 @@ void queue_command(const Command& c, std::vector<Command>& command_stack) {
     command_stack.push_back(c);
 }
 
-static std::string pick_proj_for(const Command& c) {
-    if (!c.key.empty()) return c.key;
-    if (c.ship) {
-        // Minimal default: choose by weapon
-        return (c.ship->weapon == Ship::Weapon::LASER) ? std::string("laser") : std::string("bullet");
-    }
-    return std::string("bullet");
-}
-
 void apply_commands(std::vector<Command>& command_stack,
                     std::vector<std::unique_ptr<Object>>& objs,
-                    std::map<std::string, ObjectDefinition>& object_defs)
+                    std::vector<HitscanShot>& shots)
 {
     for (const auto& c : command_stack) {
         if (!c.ship) continue; // invalid target
@@ -47,33 +39,28 @@ void apply_commands(std::vector<Command>& command_stack,
                 c.ship->target_theta = c.a;
             } break;
             case Command::Type::FIRE: {
-                std::string pkey = pick_proj_for(c);
-                auto ps = compute_projectile_spawn(*c.ship, c.a, object_defs, pkey);
+                const ProjectileTemplate* t = c.proj ? c.proj : projectile_template_for(*c.ship);
+                if (t && t->hitscan) {
+                    HitscanShot hs; hs.shooter = c.ship;
+                    hs.ox = c.ship->x_pixels(); hs.oy = c.ship->y_pixels();
+                    hs.dx = std::cos(c.a); hs.dy = std::sin(c.a);
+                    hs.range = t->range;
+                    shots.push_back(hs);
+                } else if (t && t->def) {
+                    auto ps = compute_projectile_spawn(*c.ship, c.a, *t);
 
-                // Offset spawn by shooter radius using def->radius if available
-                double shooter_r = 0.0;
-                if (c.ship->def && c.ship->def->radius > 0.0) shooter_r = c.ship->def->radius;
-                double sx = c.ship->x_pixels();
-                double sy = c.ship->y_pixels();
-                double spawn_x = sx + std::cos(c.a) * shooter_r;
-                double spawn_y = sy + std::sin(c.a) * shooter_r;
+                    // Build InitialState for projectile
+                    InitialState init;
+                    init.x = (float)ps.x; init.y = (float)ps.y; init.has_x = true; init.has_y = true;
+                    init.vx = (float)ps.vx; init.vy = (float)ps.vy; init.has_vx = true; init.has_vy = true;
+                    init.theta = (float)ps.theta; init.has_theta = true;
+                    init.team = ps.team;
+                    init.has_give_commands = true; init.give_commands = false;
+                    init.has_ang_vel = true; init.ang_vel = 0.0f;
+                    init.has_target_theta = true; init.target_theta = (float)ps.theta;
 
-                // Build InitialState for projectile
-                InitialState init;
-                init.object = pkey;
-                init.x = (float)spawn_x; init.y = (float)spawn_y; init.has_x = true; init.has_y = true;
-                init.vx = (float)ps.vx; init.vy = (float)ps.vy; init.has_vx = true; init.has_vy = true;
-                init.theta = (float)ps.theta; init.has_theta = true;
-                init.team = ps.team;
-                init.has_give_commands = true; init.give_commands = false;
-                init.has_ang_vel = true; init.ang_vel = 0.0f;
-                init.has_target_theta = true; init.target_theta = (float)ps.theta;
-
-                // Create engine object and add to world
-                if (ps.def) {
-                    if (ps.def->type == "ship") objs.push_back(std::make_unique<Ship>(*ps.def, init));
-                    else if (ps.def->type == "planet") objs.push_back(std::make_unique<Planet>(*ps.def, init));
-                    else objs.push_back(std::make_unique<Object>(*ps.def, init));
+                    // Create engine object and add to world
+                    objs.push_back(make_object(*ps.def, init));
                 }
                 c.ship->fired_this_turn = true;
             } break;
@@ -81,3 +68,33 @@ void apply_commands(std::vector<Command>& command_stack,
     }
     command_stack.clear();
 }
+
+void attach_plan(Ship& ship, std::vector<PlanStep> steps, double sim_time)
+{
+    std::stable_sort(steps.begin(), steps.end(), [](const PlanStep& a, const PlanStep& b){ return a.t < b.t; });
+    ship.plan.cancel();
+    ship.plan.start_time = sim_time;
+    ship.plan.steps = std::move(steps);
+}
+
+void queue_plan_steps(std::vector<std::unique_ptr<Object>>& objs,
+                      double sim_time,
+                      std::vector<Command>& command_stack)
+{
+    for (auto& o : objs) {
+        Ship* sh = dynamic_cast<Ship*>(o.get());
+        if (!sh) continue;
+        ManeuverPlan& p = sh->plan;
+        while (p.active() && p.start_time + (double)p.steps[p.next].t <= sim_time + 1e-9) {
+            const PlanStep& st = p.steps[p.next++];
+            Command c; c.ship = sh; c.a = st.a;
+            switch (st.op) {
+                case PlanStep::THROTTLE: c.type = Command::Type::THROTTLE; break;
+                case PlanStep::HEADING: c.type = Command::Type::HEADING; break;
+                case PlanStep::FIRE: c.type = Command::Type::FIRE; break;
+            }
+            queue_command(c, command_stack);
+        }
+        if (!p.active() && !p.steps.empty()) p.cancel(); // release finished plans
+    }
+}
@@ -15,19 +15,39 @@ struct Command {
     enum class Type { THROTTLE, HEADING, FIRE } type{Type::THROTTLE};
     double a = 0.0;         // payload: throttle (0/1) or theta (radians)
     double b = 0.0;         // reserved
-    std::string key;        // projectile key for FIRE; may be empty to auto-pick
+    const ProjectileTemplate* proj = nullptr; // FIRE override; null = shooter's current weapon
 
     Ship* ship = nullptr;   // target ship (live pointer when queued)
     uint64_t uid = 0;       // stable id for save/replay
 };
 
+// A hitscan (laser) shot produced by apply_commands. The caller resolves it
+// against the world as an instantaneous ray cast.
+struct HitscanShot {
+    Ship* shooter = nullptr;
+    double ox = 0.0, oy = 0.0;  // ray origin: shooter center (world pixels)
+    double dx = 0.0, dy = 0.0;  // unit direction
+    double range = 0.0;         // max distance (pixels)
+};
+
 // Queue semantics:
 // - FIRE: at most one per-ship per turn (ignore duplicates)
 // - HEADING/THROTTLE: last one wins for the same ship
 void queue_command(const Command& c, std::vector<Command>& command_stack);
 
-// Apply queued commands to the engine world (objs). Spawns projectiles into objs.
-// After application, the stack is cleared.
+// Apply queued commands to the engine world (objs). Spawns projectiles into objs
+// from the shooters' precompiled weapon templates; hitscan weapons append to
+// shots instead. After application, the stack is cleared.
 void apply_commands(std::vector<Command>& command_stack,
                     std::vector<std::unique_ptr<Object>>& objs,
-                    std::map<std::string, ObjectDefinition>& object_defs);
+                    std::vector<HitscanShot>& shots);
+
+// Attach a maneuver plan to ship starting at sim_time (steps are sorted by t).
+// An empty step list cancels the current plan.
+void attach_plan(Ship& ship, std::vector<PlanStep> steps, double sim_time);
+
+// Queue every plan step that is due at sim_time, across all ships in objs.
+// Steps go through queue_command, so the usual per-ship semantics apply.
+void queue_plan_steps(std::vector<std::unique_ptr<Object>>& objs,
+                      double sim_time,
+                      std::vector<Command>& command_stack);
@@ -18,13 +18,11 @@ can_collide (const Object &a, const Object &b)
 Object::Object(const ObjectDefinition& d, const InitialState& init)
 {
     def = &d;
-    // Default type from definition
-    if (!d.type.empty()) {
-        if (d.type == "ship") { type = SHIP; flags |= F_IS_SHIP | F_COMMANDABLE; }
-        else if (d.type == "planet") { type = PLANET; flags |= F_IS_PLANET; }
-        else if (d.type == "projectile") { type = PROJECTILE; flags |= F_IS_PROJECTILE; }
-        else { type = BODY; }
-    }
+    // Default type from definition (resolved at load)
+    type = d.kind;
+    if (type == SHIP) flags |= F_IS_SHIP | F_COMMANDABLE;
+    else if (type == PLANET) flags |= F_IS_PLANET;
+    else if (type == PROJECTILE) flags |= F_IS_PROJECTILE;
     // Strictly require core kinematics
     if (!init.has_x || !init.has_y || !init.has_vx || !init.has_vy || !init.has_theta) {
         std::fprintf(stderr, "FATAL: InitialState missing required kinematics for key=%s (x:%d y:%d vx:%d vy:%d theta:%d)\n",
@@ -1,11 +1,36 @@
 // Canonical object definition shared by all instances of that object key.
 #pragma once
 
+#include <cstdint>
 #include <string>
 
+#include "object.h"
+
+struct ObjectDefinition;
+
+// Precompiled launch parameters for one weapon of a ship definition.
+// Resolved once after loading (resolve_projectile_templates) so FIRE is a
+// plain copy with no key lookups or string compares.
+struct ProjectileTemplate {
+  const ObjectDefinition* def = nullptr;   // projectile definition; null if not loaded
+  double speed = 50.0;                     // launch speed (pixels/s)
+  bool inherit_velocity = true;            // add shooter velocity (false for lasers)
+  double radius = 0.0;                     // projectile radius (pixels)
+  double spawn_offset = 0.0;               // launch distance from shooter center (pixels)
+  bool hitscan = false;                    // resolved as a ray cast at fire time (lasers)
+  double range = 0.0;                      // hitscan max range (pixels)
+};
+
+// Interned definition id: dense index assigned at load in key order, so two
+// processes loading the same objects.json (same defs_hash) agree on ids.
+typedef uint16_t ObjectDefId;
+constexpr ObjectDefId kNoObjectDef = 0xFFFF;
+
 struct ObjectDefinition {
   std::string key;          // object key (map key)
   std::string type;         // "ship", "planet", "projectile", "body"
+  ObjectDefId id = kNoObjectDef;       // interned id (see load_object_defs)
+  Object::Type kind = Object::BODY;    // type resolved at load; use instead of `type`
   std::string image;        // resolved absolute image path
   std::string image_path;   // optional base directory (original)
 
@@ -19,11 +44,15 @@ struct ObjectDefinition {
   double ang_vel_max = 2.0;
   double delta_v = 0.0;     // propellant budget (pixels/s)
 
+  // Ship weapons, indexed by Ship::Weapon (ships only)
+  ProjectileTemplate projectiles[2];
+  int weapon = 1;           // initial Ship::Weapon ("weapon": "laser" | "bullet")
+
   // Projectile parameters
   double initial_velocity = 0.0;     // pixels/s
   double additional_velocity = 0.0;  // pixels/s
+  double range = 0.0;                // hitscan max range (pixels); 0 = one second of flight
 
   // Planet atmosphere
   double atmosphere_depth = 0.0;     // pixels
 };
-
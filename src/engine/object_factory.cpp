@@ -0,0 +1,13 @@
+#include "object_factory.h"
+#include "ship.h"
+#include "planet.h"
+
+std::unique_ptr<Object>
+make_object(const ObjectDefinition& def, const InitialState& init)
+{
+    switch (def.kind) {
+        case Object::SHIP: return std::make_unique<Ship>(def, init);
+        case Object::PLANET: return std::make_unique<Planet>(def, init);
+        default: return std::make_unique<Object>(def, init);
+    }
+}
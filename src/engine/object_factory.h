@@ -0,0 +1,11 @@
+// Builds the engine object subclass matching a definition's kind.
+#pragma once
+
+#include <memory>
+
+#include "object.h"
+#include "object_def.h"
+#include "initial_state.h"
+
+// Ship for SHIP definitions, Planet for PLANET, plain Object otherwise.
+std::unique_ptr<Object> make_object(const ObjectDefinition& def, const InitialState& init);
@@ -0,0 +1,24 @@
+// Multi-turn maneuver plans: time-tagged control steps a ship runs on its own.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// One scheduled control action. Kept to 12 bytes so long plans stay compact.
+struct PlanStep {
+    enum Op : uint8_t { THROTTLE, HEADING, FIRE };
+    float t = 0.0f;   // seconds after the plan was attached
+    float a = 0.0f;   // payload: throttle (0/1) or theta (radians)
+    Op op = THROTTLE;
+};
+
+// Schedule attached to a ship and executed by the engine across turns.
+// Steps are sorted by t; next indexes the first step not yet run.
+struct ManeuverPlan {
+    double start_time = 0.0;     // sim time when the plan was attached
+    std::vector<PlanStep> steps;
+    uint32_t next = 0;
+
+    bool active() const { return next < steps.size(); }
+    void cancel() { steps.clear(); next = 0; }
+};
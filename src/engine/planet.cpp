@@ -37,7 +37,7 @@ Planet::Planet (double px, double py, double r_pixels, double atmosphere_depth)
 Planet::Planet (const ObjectDefinition& def, const InitialState& init)
   : Object(def, init), radius_pixels(0.0)
 {
-  if (def.type != "planet") {
+  if (def.kind != PLANET) {
     std::fprintf(stderr, "FATAL: Planet constructed with non-planet definition key=%s type=%s\n", def.key.c_str(), def.type.c_str());
     std::exit(ExitCode::LOADING_ERROR);
   }
@@ -97,7 +97,7 @@ Ship::advance (double dt_seconds)
 Ship::Ship(const ObjectDefinition& def, const InitialState& init)
   : Object(def, init)
 {
-    if (def.type != "ship") {
+    if (def.kind != SHIP) {
         std::fprintf(stderr, "FATAL: Ship constructed with non-ship definition key=%s type=%s\n", def.key.c_str(), def.type.c_str());
         std::exit(ExitCode::LOADING_ERROR);
     }
@@ -108,6 +108,7 @@ Ship::Ship(const ObjectDefinition& def, const InitialState& init)
     ang_accel = def.ang_accel;
     ang_vel_max = def.ang_vel_max;
     delta_v_max = def.delta_v;
+    weapon = (def.weapon == LASER) ? LASER : BULLET;
 
     // Required initial parameters (crumb enforcement)
     if (!init.has_ang_vel) { std::fprintf(stderr, "FATAL: InitialState missing ang_vel for Ship\n"); std::exit(ExitCode::LOADING_ERROR); }
@@ -131,43 +132,26 @@ Ship::Ship(const ObjectDefinition& def, const InitialState& init)
 ProjectileSpawn
 compute_projectile_spawn(const Ship& shooter,
                          double theta,
-                         const std::map<std::string, ObjectDefinition>& object_defs,
-                         const std::string& proj_key)
+                         const ProjectileTemplate& tmpl)
 {
     ProjectileSpawn out{};
-    // Resolve projectile definition and parameters
-    auto objIt = object_defs.find(proj_key);
-    out.def = (objIt != object_defs.end()) ? &objIt->second : nullptr;
-    out.key = proj_key;
-    double svx = (double)shooter.vx / (double)Object::FP_ONE;
-    double svy = (double)shooter.vy / (double)Object::FP_ONE;
+    out.def = tmpl.def;
     double cs = std::cos(theta), sn = std::sin(theta);
-    double bvx = 0.0, bvy = 0.0;
-    double speed = 50.0;
-    if (out.def && out.def->initial_velocity != 0.0) speed = out.def->initial_velocity;
-    bool is_laser = (proj_key == "laser");
-    if (!is_laser && out.def && out.def->additional_velocity != 0.0) {
-        bvx = svx + out.def->additional_velocity * cs;
-        bvy = svy + out.def->additional_velocity * sn;
-    } else if (is_laser) {
-        bvx = speed * cs; bvy = speed * sn;
-    } else {
-        // Back-compat: use initial_velocity as additional if no additional specified
-        bvx = svx + speed * cs; bvy = svy + speed * sn;
+    double bvx = tmpl.speed * cs, bvy = tmpl.speed * sn;
+    if (tmpl.inherit_velocity) {
+        bvx += (double)shooter.vx / (double)Object::FP_ONE;
+        bvy += (double)shooter.vy / (double)Object::FP_ONE;
     }
-    double sx = shooter.x_pixels();
-    double sy = shooter.y_pixels();
-    double spawn_x = sx + std::cos(theta) * (double)0; // radius unknown to compute offset later; caller may offset by its own bbox
-    double spawn_y = sy + std::sin(theta) * (double)0;
 
-    // Fill out
-    out.x = spawn_x; out.y = spawn_y;
+    // Fill out; spawn just outside the shooter's radius
+    out.x = shooter.x_pixels() + cs * tmpl.spawn_offset;
+    out.y = shooter.y_pixels() + sn * tmpl.spawn_offset;
     out.vx = bvx; out.vy = bvy;
     out.theta = theta;
     out.team = shooter.team;
     if (out.def) {
         if (out.def->rescale != 1.0) out.sprite_scale = (float)out.def->rescale;
-        if (out.def->radius > 0.0) out.radius = (int)std::lround(out.def->radius);
+        if (tmpl.radius > 0.0) out.radius = (int)std::lround(tmpl.radius);
     }
     return out;
 }
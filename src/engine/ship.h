@@ -4,7 +4,7 @@
 #include "object.h"
 #include "object_def.h"
 #include "initial_state.h"
-#include <map>
+#include "plan.h"
 
 class Ship : public Object {
 public:
@@ -26,6 +26,9 @@ public:
     // Linear acceleration magnitude in pixels/s^2 (computed each advance)
     double lin_acc = 0.0;
 
+    // Multi-turn schedule run by the engine; owns throttle while active
+    ManeuverPlan plan;
+
     Ship() { type = SHIP; flags |= F_IS_SHIP | F_COMMANDABLE; }
     Ship(const ObjectDefinition& def, const InitialState& init);
 
@@ -33,15 +36,17 @@ public:
     void advance (double dt_seconds) override;
 };
     
-inline std::string pick_projectile_key(const Ship &ship) {
-    if (ship.weapon == Ship::Weapon::LASER) return "laser";
-    if (ship.weapon == Ship::Weapon::BULLET) return "bullet";
-    return "bullet";
+static_assert(Ship::LASER == 0 && Ship::BULLET == 1, "Ship::Weapon indexes ObjectDefinition::projectiles");
+
+// Precompiled template for the ship's current weapon; null if its def has none.
+inline const ProjectileTemplate* projectile_template_for(const Ship &ship) {
+    if (!ship.def) return nullptr;
+    const ProjectileTemplate& t = ship.def->projectiles[ship.weapon];
+    return t.def ? &t : nullptr;
 }
 
 struct ProjectileSpawn {
     const struct ObjectDefinition* def = nullptr;
-    std::string key;
     double x = 0.0;   // spawn position (world pixels)
     double y = 0.0;
     double vx = 0.0;  // velocity (pixels/s)
@@ -52,8 +57,8 @@ struct ProjectileSpawn {
     float sprite_scale = 1.0f;
 };
 
-// Compute projectile spawn parameters from a shooter ship, fire angle, and defs.
+// Compute projectile spawn parameters from a shooter ship, fire angle, and a
+// precompiled weapon template.
 ProjectileSpawn compute_projectile_spawn(const Ship& shooter,
                                          double theta,
-                                         const std::map<std::string, ObjectDefinition>& object_defs,
-                                         const std::string& proj_key);
+                                         const ProjectileTemplate& tmpl);
@@ -0,0 +1,136 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool
+ray_circle (double ox, double oy, double dx, double dy,
+            double cx, double cy, double r, double& t_out)
+{
+    double lx = cx - ox, ly = cy - oy;
+    double c = lx*lx + ly*ly - r*r;
+    if (c <= 0.0) { t_out = 0.0; return true; }   // origin inside
+    double b = lx*dx + ly*dy;
+    if (b <= 0.0) return false;                    // circle behind the ray
+    double disc = b*b - c;
+    if (disc < 0.0) return false;
+    t_out = b - std::sqrt(disc);
+    return true;
+}
+
+bool
+swept_circle_toi (double px, double py, double mx, double my,
+                  double r, double& t_out)
+{
+    double c = px*px + py*py - r*r;
+    if (c <= 0.0) { t_out = 0.0; return true; }   // already touching
+    double b = px*mx + py*my;
+    if (b >= 0.0) return false;                    // separating or parallel
+    double a = mx*mx + my*my;
+    double disc = b*b - a*c;
+    if (disc < 0.0) return false;
+    double t = (-b - std::sqrt(disc)) / a;
+    if (t > 1.0) return false;
+    t_out = t;
+    return true;
+}
+
+SpatialGrid::SpatialGrid (double cell_size)
+  : cell_(cell_size > 0.0 ? cell_size : 1024.0)
+{
+}
+
+int64_t
+SpatialGrid::cell_of (double v) const
+{
+    return (int64_t)std::floor(v / cell_);
+}
+
+void
+SpatialGrid::clear (double cell_size)
+{
+    for (uint64_t k : used_) cells_[k].clear();
+    used_.clear();
+    count_ = 0;
+    if (cell_size > 0.0 && cell_size != cell_) { cells_.clear(); cell_ = cell_size; }
+}
+
+void
+SpatialGrid::insert (uint32_t handle, double x, double y, double r)
+{
+    int64_t x0 = cell_of(x - r), x1 = cell_of(x + r);
+    int64_t y0 = cell_of(y - r), y1 = cell_of(y + r);
+    for (int64_t cx = x0; cx <= x1; ++cx) {
+        for (int64_t cy = y0; cy <= y1; ++cy) {
+            auto& v = cells_[key(cx, cy)];
+            if (v.empty()) used_.push_back(key(cx, cy));
+            v.push_back(Entry{handle, x, y, r});
+        }
+    }
+    ++count_;
+}
+
+void
+SpatialGrid::query_aabb (double minx, double miny, double maxx, double maxy,
+                         std::vector<uint32_t>& out) const
+{
+    out.clear();
+    int64_t x0 = cell_of(minx), x1 = cell_of(maxx);
+    int64_t y0 = cell_of(miny), y1 = cell_of(maxy);
+    // Huge boxes: scanning the occupied cells is cheaper than walking empty ones
+    if ((double)(x1 - x0 + 1) * (double)(y1 - y0 + 1) > (double)used_.size()) {
+        for (uint64_t k : used_) {
+            auto it = cells_.find(k);
+            for (const Entry& e : it->second)
+                if (e.x + e.r >= minx && e.x - e.r <= maxx && e.y + e.r >= miny && e.y - e.r <= maxy) out.push_back(e.handle);
+        }
+    } else {
+        for (int64_t cx = x0; cx <= x1; ++cx) {
+            for (int64_t cy = y0; cy <= y1; ++cy) {
+                auto it = cells_.find(key(cx, cy));
+                if (it == cells_.end()) continue;
+                for (const Entry& e : it->second)
+                    if (e.x + e.r >= minx && e.x - e.r <= maxx && e.y + e.r >= miny && e.y - e.r <= maxy) out.push_back(e.handle);
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+bool
+SpatialGrid::raycast (double ox, double oy, double dx, double dy, double max_t,
+                      const std::function<bool(uint32_t)>& accept, RayHit& out) const
+{
+    if (count_ == 0 || max_t <= 0.0) return false;
+    const double inf = std::numeric_limits<double>::infinity();
+    int64_t cx = cell_of(ox), cy = cell_of(oy);
+    const int step_x = (dx > 0.0) ? 1 : -1, step_y = (dy > 0.0) ? 1 : -1;
+    // Ray parameter at the next vertical/horizontal cell boundary, and per-cell increments
+    double next_x = (dx != 0.0) ? (((double)(cx + (step_x > 0 ? 1 : 0)) * cell_ - ox) / dx) : inf;
+    double next_y = (dy != 0.0) ? (((double)(cy + (step_y > 0 ? 1 : 0)) * cell_ - oy) / dy) : inf;
+    const double dt_x = (dx != 0.0) ? cell_ / std::fabs(dx) : inf;
+    const double dt_y = (dy != 0.0) ? cell_ / std::fabs(dy) : inf;
+
+    bool hit = false; double best = max_t;
+    // Bound the walk by the cells the segment can cross
+    int64_t max_cells = (int64_t)(max_t / cell_) * 2 + 4;
+    for (int64_t n = 0; n < max_cells; ++n) {
+        auto it = cells_.find(key(cx, cy));
+        if (it != cells_.end()) {
+            for (const Entry& e : it->second) {
+                double t;
+                if (!ray_circle(ox, oy, dx, dy, e.x, e.y, e.r, t) || t > best) continue;
+                if (hit && t == best) continue;
+                if (!accept(e.handle)) continue;
+                hit = true; best = t; out.handle = e.handle; out.t = t;
+            }
+        }
+        double cell_exit = std::min(next_x, next_y);
+        if (cell_exit > best) break; // nothing closer beyond this cell
+        if (next_x < next_y) { next_x += dt_x; cx += step_x; }
+        else { next_y += dt_y; cy += step_y; }
+    }
+    return hit;
+}
@@ -0,0 +1,56 @@
+// Uniform hashed grid over circles: broadphase, range and ray queries.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Ray vs circle: smallest t >= 0 where o + t*d (d unit length) enters the
+// circle. A ray starting inside the circle hits at t = 0.
+bool ray_circle (double ox, double oy, double dx, double dy,
+                 double cx, double cy, double r, double& t_out);
+
+// Swept circles: earliest t in [0, 1] at which two circles moving linearly
+// touch. (px, py) is B - A at t = 0, (mx, my) is B's displacement relative to
+// A over the interval and r the sum of radii. Overlap at t = 0 reports t = 0.
+bool swept_circle_toi (double px, double py, double mx, double my,
+                       double r, double& t_out);
+
+class SpatialGrid {
+public:
+    struct Entry { uint32_t handle; double x, y, r; };
+    struct RayHit { uint32_t handle = 0; double t = 0.0; };
+
+    explicit SpatialGrid (double cell_size = 1024.0);
+
+    // Drop all entries; cell storage is kept for the next rebuild.
+    void clear (double cell_size = 0.0);
+
+    // Insert a circle under a caller-defined handle. Circles are registered in
+    // every cell their bounding box overlaps.
+    void insert (uint32_t handle, double x, double y, double r);
+
+    // Unique handles whose circles overlap the box (broadphase; exact circle
+    // test is left to the caller).
+    void query_aabb (double minx, double miny, double maxx, double maxy,
+                     std::vector<uint32_t>& out) const;
+
+    // First circle along the ray o + t*d (d unit length, 0 <= t <= max_t) whose
+    // handle passes accept. Cells are walked front to back (DDA) and the walk
+    // stops as soon as no later cell can hold a closer hit.
+    bool raycast (double ox, double oy, double dx, double dy, double max_t,
+                  const std::function<bool(uint32_t)>& accept, RayHit& out) const;
+
+    double cell_size () const { return cell_; }
+    size_t size () const { return count_; }
+
+private:
+    static uint64_t key (int64_t cx, int64_t cy) { return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy; }
+    int64_t cell_of (double v) const;
+
+    double cell_;
+    size_t count_ = 0;
+    std::unordered_map<uint64_t, std::vector<Entry>> cells_;
+    std::vector<uint64_t> used_; // cells holding entries since the last clear
+};
@@ -28,12 +28,37 @@ struct GameConfigModel : public JsonInterface {
         // Networking block with legacy fallback
         JsonView jnet; if (root.get_view("net", jnet) && jnet.is_object()) {
             (void)get_json_value(jnet, "port", &cfg.net_port);
+            (void)get_json_value(jnet, "udp_state", &cfg.net_udp_state);
+            (void)get_json_value(jnet, "shm_state", &cfg.net_shm_state);
+            (void)get_json_value(jnet, "state_rate", &cfg.net_state_rate);
+            (void)get_json_value(jnet, "state_max_bps", &cfg.net_state_max_bps);
+            (void)get_json_value(jnet, "compress", &cfg.net_compress);
+            (void)get_json_value(jnet, "compress_dict", &cfg.net_compress_dict);
+            (void)get_json_value(jnet, "compress_min", &cfg.net_compress_min);
+            (void)get_json_value(jnet, "trace", &cfg.net_trace);
+            (void)get_json_value(jnet, "resume_grace", &cfg.net_resume_grace);
         } else {
             (void)get_json_value(root, "net_port", &cfg.net_port);
+            (void)get_json_value(root, "net_udp_state", &cfg.net_udp_state);
+            (void)get_json_value(root, "net_shm_state", &cfg.net_shm_state);
+            (void)get_json_value(root, "net_state_rate", &cfg.net_state_rate);
+            (void)get_json_value(root, "net_state_max_bps", &cfg.net_state_max_bps);
+            (void)get_json_value(root, "net_compress", &cfg.net_compress);
+            (void)get_json_value(root, "net_compress_dict", &cfg.net_compress_dict);
+            (void)get_json_value(root, "net_compress_min", &cfg.net_compress_min);
+            (void)get_json_value(root, "net_trace", &cfg.net_trace);
+            (void)get_json_value(root, "net_resume_grace", &cfg.net_resume_grace);
         }
 
         // Engine timing
         (void)get_json_value(root, "min_time_step", &cfg.min_time_step);
+        (void)get_json_value(root, "tick_rate", &cfg.tick_rate);
+        (void)get_json_value(root, "time_scale", &cfg.time_scale);
+        (void)get_json_value(root, "max_time_scale", &cfg.max_time_scale);
+        (void)get_json_value(root, "max_catchup_steps", &cfg.max_catchup_steps);
+        (void)get_json_value(root, "interest_radius", &cfg.interest_radius);
+        (void)get_json_value(root, "sessions", &cfg.sessions);
+        (void)get_json_value(root, "session_workers", &cfg.session_workers);
 
         return true;
     }
@@ -57,6 +82,10 @@ bool load_game_config(const char* path, GameConfig& out, std::string* err)
     if (out.paths.boot_sequence.empty()) out.paths.boot_sequence = "boot_sequence/boot_sequence.json";
 
     if (out.min_time_step <= 0.0) out.min_time_step = 1.0/64.0;
+    if (out.time_scale < 0.0) out.time_scale = 0.0;
+    if (out.max_time_scale <= 0.0) out.max_time_scale = 1.0;
+    if (out.max_catchup_steps < 1) out.max_catchup_steps = 1;
+    if (out.sessions < 1) out.sessions = 1;
 
     DBG("game config: paths.assets=%s images=%s saves=%s config=%s boot=%s net.port=%d min_dt=%.6f",
         out.paths.assets.c_str(), out.paths.images.c_str(), out.paths.saves.c_str(), out.paths.config.c_str(), out.paths.boot_sequence.c_str(), out.net_port, out.min_time_step);
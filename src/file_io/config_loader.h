@@ -14,7 +14,23 @@ struct GameConfigPaths {
 struct GameConfig {
     GameConfigPaths paths{}; // optional; provides roots/paths
     double min_time_step = 1.0/64.0; // seconds; engine physics max step size
+    double tick_rate = 0.0;        // server timer wakeups per second; <= 0: one per min_time_step
+    double time_scale = 1.0;       // initial sim seconds per wall second (0 starts paused)
+    double max_time_scale = 8.0;   // largest finite time scale clients may request
+    int max_catchup_steps = 32;    // physics steps run per wakeup at most when behind
+    double interest_radius = 50000.0; // px around a client's ships sent in full; <= 0 sends the whole world
+    int sessions = 1;              // worlds one engine hosts (joins pick one by "session")
+    int session_workers = 0;       // sim threads driving them; <= 0: one per hardware thread
     int net_port = 55555; // TCP listen/connect port for engine/ui
+    bool net_udp_state = true; // UI asks for state frames over UDP (same port number)
+    bool net_shm_state = true; // UI asks for state through shared memory (preferred over UDP)
+    double net_state_rate = 0.0;    // states per second the UI asks for; <= 0: every broadcast
+    double net_state_max_bps = 0.0; // state bytes per second the UI accepts; <= 0: no cap
+    bool net_compress = true;       // UI asks for compressed state (lz_frame.h)
+    bool net_compress_dict = true;  // ... primed with the previous compressed state
+    int net_compress_min = 0;       // smallest state message to compress; <= 0: engine default
+    bool net_trace = false;         // UI traces its commands' latency (L shows it)
+    double net_resume_grace = 10.0; // seconds the engine holds a dropped player's team for a resume; <= 0: none
 };
 
 // Reads config/game.json if present; fills out with defaults otherwise.
@@ -61,6 +61,12 @@ load_object_defs (const char *path, std::map<std::string, ObjectDefinition> &out
     (void)get_json_value(item, "delta_v", &def.delta_v);
     (void)get_json_value(item, "initial_velocity", &def.initial_velocity);
     (void)get_json_value(item, "additional_velocity", &def.additional_velocity);
+    (void)get_json_value(item, "range", &def.range);
+    if (std::string w; get_json_value(item, "weapon", &w)) {
+      if (w == "laser") def.weapon = 0;
+      else if (w == "bullet") def.weapon = 1;
+      else CRASH(ExitCode::LOADING_ERROR, "[objects] unknown weapon '%s' for key %s", w.c_str(), k);
+    }
     (void)get_json_value(item, "rescale", &def.rescale);
     (void)get_json_value(item, "atmosphere_depth", &def.atmosphere_depth);
 
@@ -79,10 +85,57 @@ load_object_defs (const char *path, std::map<std::string, ObjectDefinition> &out
       }
       def.image = p;
     }
+    if (def.type == "ship") def.kind = Object::SHIP;
+    else if (def.type == "planet") def.kind = Object::PLANET;
+    else if (def.type == "projectile") def.kind = Object::PROJECTILE;
+    else def.kind = Object::BODY;
     def.key = k;
     out[k] = def;
   }
 
+  // Intern ids in key order so they only depend on the file contents
+  if (out.size () >= kNoObjectDef) CRASH(ExitCode::LOADING_ERROR, "[objects] too many definitions (%zu)", out.size ());
+  ObjectDefId next_id = 0;
+  for (auto &kv : out) kv.second.id = next_id++;
+
+  resolve_projectile_templates (out);
   DBG ("load_object_defs done: %zu entries", out.size ());
   return true;
 }
+
+void
+resolve_projectile_templates (std::map<std::string, ObjectDefinition> &defs)
+{
+  // Weapon slot -> projectile key; order matches Ship::Weapon.
+  static const char *const weapon_keys[] = { "laser", "bullet" };
+  for (auto &kv : defs) {
+    ObjectDefinition &ship = kv.second;
+    if (ship.kind != Object::SHIP) continue;
+    for (int w = 0; w < 2; ++w) {
+      ProjectileTemplate t;
+      auto it = defs.find (weapon_keys[w]);
+      if (it != defs.end ()) {
+        const ObjectDefinition &pd = it->second;
+        const bool is_laser = (w == 0);
+        t.def = &pd;
+        t.inherit_velocity = !is_laser;
+        if (!is_laser && pd.additional_velocity != 0.0) t.speed = pd.additional_velocity;
+        else if (pd.initial_velocity != 0.0) t.speed = pd.initial_velocity;
+        t.radius = pd.radius;
+        t.hitscan = is_laser;
+        t.range = (pd.range > 0.0) ? pd.range : t.speed;
+      }
+      t.spawn_offset = (ship.radius > 0.0) ? ship.radius : 0.0;
+      ship.projectiles[w] = t;
+    }
+  }
+}
+
+std::vector<const ObjectDefinition *>
+object_defs_by_id (const std::map<std::string, ObjectDefinition> &defs)
+{
+  std::vector<const ObjectDefinition *> out (defs.size (), nullptr);
+  for (const auto &kv : defs)
+    if (kv.second.id < out.size ()) out[kv.second.id] = &kv.second;
+  return out;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <map>
+#include <vector>
 #include "object_def.h"
 #include "errors.h"
 
@@ -29,6 +30,17 @@ struct ObjectReadBuffer {
     bool has_atmosphere_depth = false; double atmosphere_depth = 0.0; // pixels
 };
 
+// Loads objects.json into out, keyed by object key. Each definition gets a
+// dense interned id (ObjectDefinition::id, key order) and a resolved kind.
 bool load_object_defs (const char *path,
                        std::map<std::string, ObjectDefinition> &out,
                        std::string *err = nullptr);
+
+// Precompile each ship definition's weapon templates (projectile def, launch
+// speed, spawn offset). Called by load_object_defs; safe to call again after
+// editing defs in place.
+void resolve_projectile_templates (std::map<std::string, ObjectDefinition> &defs);
+
+// Dense id -> definition table for the ids assigned by load_object_defs.
+// Pointers refer into defs and stay valid while defs is not modified.
+std::vector<const ObjectDefinition *> object_defs_by_id (const std::map<std::string, ObjectDefinition> &defs);
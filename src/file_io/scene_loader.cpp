@@ -2,8 +2,7 @@
 #include "save_loader.h"
 #include "our_debug.h"
 
-#include "ship.h"
-#include "planet.h"
+#include "object_factory.h"
 
 #include <cmath>
 
@@ -40,12 +39,9 @@ bool load_scene_objects(const char* save_path,
         auto it = object_defs.find(key);
         if (it != object_defs.end()) def = &it->second;
 
+        if (!def) { if (err) *err = "unknown object key: " + key; return false; }
         // Create appropriate engine object via new constructors
-        std::unique_ptr<Object> obj;
-        if (def && def->type == "ship") obj = std::make_unique<Ship>(*def, s);
-        else if (def && def->type == "planet") obj = std::make_unique<Planet>(*def, s);
-        else obj = std::make_unique<Object>(*def, s);
-        out.push_back(std::move(obj));
+        out.push_back(make_object(*def, s));
     }
     return true;
 }
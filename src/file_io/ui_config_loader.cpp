@@ -28,6 +28,7 @@ bool load_ui_config(const char* path, UIConfig& out, std::string* err)
         (void)get_json_value(jwindow, "fullscreen", &out.fullscreen);
     }
     (void)get_json_value(root, "fps_cap", &out.fps_cap);
+    (void)get_json_value(root, "interp_delay", &out.interp_delay);
 
     JsonView fonts; if (root.get_view("fonts", fonts) && fonts.is_object()) {
         (void)get_json_value(fonts, "path", &out.font_path);
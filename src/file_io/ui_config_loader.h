@@ -15,6 +15,9 @@ struct UIConfig {
     int window_h = 600;
     bool fullscreen = false;
     int fps_cap = 60;
+    // Render this many wall seconds behind the newest stamped state,
+    // interpolating ships between states (<= 0: show states as they arrive)
+    double interp_delay = 0.1;
     // HUD
     int hud_width = 340;
     int hud_pad = 8;
@@ -0,0 +1,331 @@
+// Headless load generator: many scripted clients against a running engine on
+// loopback. Each joins a team, sends random THROTTLE/HEADING/FIRE commands and
+// ends its turns; command ack latency and state throughput are reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "file_io/config_loader.h"
+#include "stream_io/delta_frame.h"
+#include "stream_io/line_framer.h"
+#include "stream_io/lz_frame.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/tcp_protocol.h"
+
+namespace loadgen {
+
+using clock = std::chrono::steady_clock;
+
+static double seconds(clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+struct Options {
+    int port = 0;             // 0: net.port from config/game.json
+    int clients = 8;
+    int worlds = 1;           // clients are spread over hosted worlds round-robin
+    int teams = 1;            // per world, the first clients claim teams 0..teams-1
+    double duration = 10.0;   // wall seconds
+    double cmd_rate = 5.0;    // commands per client per wall second
+    double turn_rate = 2.0;   // turn ends per client per wall second at most (<= 0: as soon as due)
+    double turn_wait = 1.0;   // sim seconds until the client's next turn
+    double state_rate = 0.0;  // join "rate" (<= 0: every broadcast)
+    double max_bps = 0.0;     // join "max_bps"
+    std::vector<std::string> caps;
+    uint32_t seed = 1;
+    bool verbose = false;     // per-client lines
+    bool trace = false;       // trace every command (segment breakdown in the report)
+};
+
+// A turn not seen coming due within this long (the world stalled, e.g. on
+// another client or a missed state) is taken as due
+static constexpr double kStallSeconds = 0.5;
+
+struct Client {
+    int fd = -1;
+    int index = 0, world = 0, team = -1;
+    LineFramer in{64u << 20};
+    std::string out;                            // bytes the socket did not take yet
+    tcp_protocol::DeltaDecoder deltas;
+    tcp_protocol::LzDecoder lz;
+    bool joined = false, closed = false;
+    std::deque<clock::time_point> awaiting_ack; // send times of commands, oldest first
+    std::vector<uint64_t> ships;                // commandable uids from the latest state
+    double sim_time = 0.0, turn_at = 0.0;
+    bool turn_due = true;                       // a session has its turn at join
+    clock::time_point next_cmd, next_turn, progress;
+    uint64_t states = 0, bytes = 0, cmds = 0, acks = 0, errors = 0, turns = 0;
+    std::vector<double> ack_ms;
+    std::vector<std::pair<tcp_protocol::CmdTrace, double>> traces; // trace replies and their arrival (trace_clock)
+};
+
+static int connect_loopback(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) { std::perror("socket"); return -1; }
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); addr.sin_port = htons((uint16_t)port);
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("connect"); ::close(fd); return -1; }
+    int one = 1; (void)::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int flags = fcntl(fd, F_GETFL, 0); if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    return fd;
+}
+
+static void flush(Client& c) {
+    while (!c.out.empty()) {
+        ssize_t w = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (w <= 0) { if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK) c.closed = true; return; }
+        c.out.erase(0, (size_t)w);
+    }
+}
+
+static void send_line(Client& c, const std::string& s) { c.out += s; flush(c); }
+
+// A decoded state: refresh the client's ships and turn clock
+static void on_state(Client& c, const std::vector<tcp_protocol::NetObjectView>& objs, const tcp_protocol::StateStamp& stamp, clock::time_point now) {
+    ++c.states;
+    c.ships.clear();
+    for (const auto& o : objs) if (o.is_ship && (c.team < 0 || o.team == c.team)) c.ships.push_back(o.uid);
+    if (stamp.valid && stamp.sim_time > c.sim_time) { c.sim_time = stamp.sim_time; c.progress = now; }
+    if (!c.turn_due && stamp.valid && c.sim_time + 1e-9 >= c.turn_at) c.turn_due = true;
+}
+
+static void handle_frame(Client& c, const char* data, size_t len, std::vector<tcp_protocol::NetObjectView>& objs, clock::time_point now) {
+    const unsigned char kind = (unsigned char)data[2];
+    tcp_protocol::StateStamp stamp;
+    if (kind == tcp_protocol::kFrameKindCompressed) {
+        std::string raw;
+        if (!c.lz.decode(data, len, raw) || raw.empty()) return;
+        if ((unsigned char)raw[0] != tcp_protocol::kFrameMagic) {
+            if (tcp_protocol::parse_state_objects(raw, objs, nullptr, nullptr, &stamp)) on_state(c, objs, stamp, now);
+        } else if (raw.size() >= 4 && (unsigned char)raw[2] != tcp_protocol::kFrameKindCompressed && tcp_protocol::frame_length(raw.data(), raw.size()) == raw.size()) {
+            handle_frame(c, raw.data(), raw.size(), objs, now);
+        }
+    } else if (kind == tcp_protocol::kFrameKindKeyframe || kind == tcp_protocol::kFrameKindDelta) {
+        uint32_t seq = 0;
+        if (c.deltas.decode(data, len, objs, &seq, nullptr, &stamp)) { on_state(c, objs, stamp, now); send_line(c, tcp_protocol::build_state_ack(seq)); }
+    } else if (tcp_protocol::parse_state_frame(data, len, objs, nullptr, &stamp)) {
+        on_state(c, objs, stamp, now);
+    }
+}
+
+static void receive(Client& c, std::vector<tcp_protocol::NetObjectView>& objs) {
+    while (true) {
+        ssize_t n = ::recv(c.fd, c.in.prepare(65536), 65536, 0);
+        if (n == 0) { c.closed = true; break; }
+        if (n < 0) { if (errno != EAGAIN && errno != EWOULDBLOCK) c.closed = true; break; }
+        c.in.commit((size_t)n); c.bytes += (uint64_t)n;
+    }
+    const clock::time_point now = clock::now();
+    while (true) {
+        std::string_view head = c.in.pending();
+        if (head.empty()) break;
+        if ((unsigned char)head[0] == tcp_protocol::kFrameMagic) {
+            size_t len = tcp_protocol::frame_length(head.data(), head.size());
+            if (len == 0) break; // incomplete
+            handle_frame(c, head.data(), len, objs, now);
+            c.in.consume(len);
+            continue;
+        }
+        std::string_view line;
+        LineFramer::Status st = c.in.next_line(line);
+        if (st == LineFramer::kNone) break;
+        if (st != LineFramer::kLine || line.empty()) continue;
+        tcp_protocol::StateStamp stamp; std::string type, msg; tcp_protocol::CmdTrace tr; tcp_protocol::JoinedReply joined;
+        if (tcp_protocol::parse_state_objects(line.data(), objs, nullptr, nullptr, &stamp)) {
+            on_state(c, objs, stamp, now);
+        } else if (tcp_protocol::parse_trace(line.data(), tr)) {
+            c.traces.emplace_back(tr, tcp_protocol::trace_clock());
+        } else if (tcp_protocol::parse_reply(line.data(), &type, &msg)) {
+            if (!c.joined) { std::fprintf(stderr, "[loadgen] client %d: join refused: %s\n", c.index, msg.c_str()); c.closed = true; break; }
+            // Replies come back in order; command replies match the oldest unanswered command
+            if (c.awaiting_ack.empty()) continue;
+            c.ack_ms.push_back(1e3 * seconds(now - c.awaiting_ack.front()));
+            c.awaiting_ack.pop_front();
+            if (type == "ack") ++c.acks; else ++c.errors;
+        } else if (tcp_protocol::parse_joined(line.data(), joined)) {
+            c.joined = true; c.progress = now;
+        }
+    }
+}
+
+// Commands and turn ends that are due for one client
+static void drive(Client& c, const Options& opt, std::mt19937& rng, clock::time_point now) {
+    if (!c.joined || c.closed) return;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    if (opt.cmd_rate > 0.0 && now >= c.next_cmd && !c.ships.empty()) {
+        const uint64_t uid = c.ships[(size_t)(unit(rng) * (double)c.ships.size()) % c.ships.size()];
+        const double r = unit(rng);
+        const uint32_t trace = opt.trace ? (uint32_t)c.cmds + 1 : 0;
+        const double t_send = trace ? tcp_protocol::trace_clock() : 0.0;
+        if (r < 0.4) send_line(c, tcp_protocol::build_cmd("THROTTLE", uid, unit(rng) < 0.5 ? 0.0 : 1.0, false, trace, t_send));
+        else if (r < 0.8) send_line(c, tcp_protocol::build_cmd("HEADING", uid, (unit(rng) * 2.0 - 1.0) * M_PI, true, trace, t_send));
+        else send_line(c, tcp_protocol::build_cmd("FIRE", uid, (unit(rng) * 2.0 - 1.0) * M_PI, true, trace, t_send));
+        c.awaiting_ack.push_back(now); ++c.cmds;
+        // Exponential gaps: commands arrive as a Poisson stream per client
+        c.next_cmd = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(-std::log(1.0 - unit(rng)) / opt.cmd_rate));
+    }
+    if (!c.turn_due && seconds(now - c.progress) > kStallSeconds) c.turn_due = true;
+    if (c.turn_due && now >= c.next_turn) {
+        send_line(c, tcp_protocol::build_end_turn(opt.turn_wait));
+        c.turn_due = false; c.turn_at = c.sim_time + opt.turn_wait; c.progress = now; ++c.turns;
+        if (opt.turn_rate > 0.0) c.next_turn = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / opt.turn_rate));
+    }
+}
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    const size_t k = std::min(v.size() - 1, (size_t)(p * (double)(v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return v[k];
+}
+
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [--clients N] [--worlds W] [--teams T] [--duration S] [--cmd-rate R] [--turn-rate R]\n"
+        "          [--turn-wait S] [--state-rate R] [--max-bps B] [--caps a,b,...] [--port P] [--seed N] [--trace] [-v]\n"
+        "  Runs N clients against the engine on loopback. Rates are per client per wall second;\n"
+        "  caps are join capabilities (bin1, delta1, lz1, lz1dict; default: JSON state).\n"
+        "  --trace asks for a latency trace of every command and breaks it down by segment.\n", argv0);
+}
+
+static bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "-v") { opt.verbose = true; continue; }
+        if (a == "--trace") { opt.trace = true; continue; }
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+        if (a == "--clients") opt.clients = std::atoi(v);
+        else if (a == "--worlds") opt.worlds = std::atoi(v);
+        else if (a == "--teams") opt.teams = std::atoi(v);
+        else if (a == "--duration") opt.duration = std::atof(v);
+        else if (a == "--cmd-rate") opt.cmd_rate = std::atof(v);
+        else if (a == "--turn-rate") opt.turn_rate = std::atof(v);
+        else if (a == "--turn-wait") opt.turn_wait = std::atof(v);
+        else if (a == "--state-rate") opt.state_rate = std::atof(v);
+        else if (a == "--max-bps") opt.max_bps = std::atof(v);
+        else if (a == "--port") opt.port = std::atoi(v);
+        else if (a == "--seed") opt.seed = (uint32_t)std::strtoul(v, nullptr, 10);
+        else if (a == "--caps") {
+            opt.caps.clear();
+            for (const char* p = v; *p; ) {
+                const char* e = std::strchr(p, ','); if (!e) e = p + std::strlen(p);
+                if (e > p) opt.caps.emplace_back(p, (size_t)(e - p));
+                p = *e ? e + 1 : e;
+            }
+        }
+        else return false;
+    }
+    return opt.clients > 0 && opt.worlds > 0 && opt.duration > 0.0;
+}
+
+} // namespace loadgen
+
+int main(int argc, char** argv) {
+    using namespace loadgen;
+    Options opt;
+    if (!parse_args(argc, argv, opt)) { usage(argv[0]); return 1; }
+    if (opt.port <= 0) { GameConfig cfg; std::string err; (void)load_game_config("config/game.json", cfg, &err); opt.port = cfg.net_port; }
+
+    std::mt19937 rng(opt.seed);
+    std::vector<std::unique_ptr<Client>> clients;
+    const clock::time_point t0 = clock::now();
+    for (int i = 0; i < opt.clients; ++i) {
+        auto c = std::make_unique<Client>();
+        c->index = i; c->world = i % opt.worlds;
+        const int slot = i / opt.worlds; // join order within the world
+        c->team = slot < opt.teams ? slot : -1;
+        c->fd = connect_loopback(opt.port);
+        if (c->fd < 0) { std::fprintf(stderr, "[loadgen] client %d could not connect to port %d\n", i, opt.port); return 1; }
+        c->next_cmd = c->next_turn = c->progress = t0;
+        tcp_protocol::JoinRequest j;
+        j.name = "loadgen"; j.team = c->team; j.caps = opt.caps;
+        j.session = opt.worlds > 1 ? c->world : -1; j.rate = opt.state_rate; j.max_bps = opt.max_bps;
+        send_line(*c, tcp_protocol::build_join(j));
+        clients.push_back(std::move(c));
+    }
+
+    std::vector<pollfd> pfds(clients.size());
+    std::vector<tcp_protocol::NetObjectView> objs;
+    const clock::time_point end = t0 + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(opt.duration));
+    while (clock::now() < end) {
+        for (size_t i = 0; i < clients.size(); ++i) {
+            const Client& c = *clients[i];
+            pfds[i] = pollfd{c.closed ? -1 : c.fd, (short)(POLLIN | (c.out.empty() ? 0 : POLLOUT)), 0};
+        }
+        (void)::poll(pfds.data(), pfds.size(), 2); // commands are scheduled at millisecond granularity
+        const clock::time_point now = clock::now();
+        for (size_t i = 0; i < clients.size(); ++i) {
+            Client& c = *clients[i];
+            if (c.closed) continue;
+            if (pfds[i].revents & POLLOUT) flush(c);
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) receive(c, objs);
+            drive(c, opt, rng, now);
+        }
+    }
+    const double elapsed = seconds(clock::now() - t0);
+
+    // Report: ack latency over every command, rates per client
+    std::vector<double> all_ms, state_rates, byte_rates;
+    static const char* const kSegments[] = {"client->engine", "engine queue", "until applied", "until broadcast", "engine->client", "total"};
+    std::vector<double> seg_ms[6]; double trace_ticks = 0.0;
+    uint64_t cmds = 0, acks = 0, errors = 0, turns = 0, unanswered = 0; int lost = 0;
+    for (auto& cp : clients) {
+        Client& c = *cp;
+        all_ms.insert(all_ms.end(), c.ack_ms.begin(), c.ack_ms.end());
+        for (const auto& [tr, arrival] : c.traces) {
+            const double ms[6] = {tr.t_recv - tr.t_send, tr.t_queued - tr.t_recv, tr.t_applied - tr.t_queued,
+                                  tr.t_broadcast - tr.t_applied, arrival - tr.t_broadcast, arrival - tr.t_send};
+            for (int k = 0; k < 6; ++k) seg_ms[k].push_back(1e3 * ms[k]);
+            trace_ticks += (double)(tr.broadcast_tick - tr.applied_tick);
+        }
+        state_rates.push_back((double)c.states / elapsed); byte_rates.push_back((double)c.bytes / elapsed);
+        cmds += c.cmds; acks += c.acks; errors += c.errors; turns += c.turns; unanswered += c.awaiting_ack.size();
+        if (c.closed) ++lost;
+        if (opt.verbose) {
+            std::vector<double> ms = c.ack_ms;
+            std::printf("client %3d world=%d team=%2d states=%.1f/s bytes=%.0fB/s cmds=%llu acks=%llu errors=%llu turns=%llu ack_p50=%.2fms ack_p99=%.2fms%s\n",
+                        c.index, c.world, c.team, (double)c.states / elapsed, (double)c.bytes / elapsed,
+                        (unsigned long long)c.cmds, (unsigned long long)c.acks, (unsigned long long)c.errors, (unsigned long long)c.turns,
+                        percentile(ms, 0.50), percentile(ms, 0.99), c.closed ? " (closed)" : "");
+        }
+        ::close(c.fd);
+    }
+    auto spread = [](std::vector<double>& v, const char* what, const char* unit) {
+        double sum = 0.0; for (double x : v) sum += x;
+        std::printf("%s per client: avg %.1f%s  min %.1f%s  p50 %.1f%s  max %.1f%s\n", what,
+                    sum / (double)std::max<size_t>(v.size(), 1), unit,
+                    v.empty() ? 0.0 : *std::min_element(v.begin(), v.end()), unit,
+                    percentile(v, 0.50), unit,
+                    v.empty() ? 0.0 : *std::max_element(v.begin(), v.end()), unit);
+    };
+    std::printf("# %d clients, %d world(s), %.1fs, caps=%zu\n", opt.clients, opt.worlds, elapsed, opt.caps.size());
+    std::printf("commands: sent=%llu acked=%llu errors=%llu unanswered=%llu  turns ended=%llu  connections lost=%d\n",
+                (unsigned long long)cmds, (unsigned long long)acks, (unsigned long long)errors, (unsigned long long)unanswered,
+                (unsigned long long)turns, lost);
+    std::printf("ack latency: p50 %.2fms  p90 %.2fms  p99 %.2fms  p99.9 %.2fms  max %.2fms\n",
+                percentile(all_ms, 0.50), percentile(all_ms, 0.90), percentile(all_ms, 0.99), percentile(all_ms, 0.999), percentile(all_ms, 1.0));
+    if (opt.trace) {
+        std::printf("traced commands: %zu, %.1f ticks applied->broadcast on average\n", seg_ms[5].size(), seg_ms[5].empty() ? 0.0 : trace_ticks / (double)seg_ms[5].size());
+        for (int k = 0; k < 6; ++k)
+            std::printf("  %-16s p50 %.2fms  p90 %.2fms  p99 %.2fms  max %.2fms\n", kSegments[k],
+                        percentile(seg_ms[k], 0.50), percentile(seg_ms[k], 0.90), percentile(seg_ms[k], 0.99), percentile(seg_ms[k], 1.0));
+    }
+    spread(state_rates, "states", "/s");
+    spread(byte_rates, "bytes", "B/s");
+    return lost ? 2 : 0;
+}
@@ -0,0 +1,258 @@
+// Keyframe/delta state codec shared by the engine server and the UI.
+
+#include "stream_io/delta_frame.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace tcp_protocol {
+
+namespace {
+
+inline void put_u16(std::string& o, uint16_t v) { o.push_back((char)(v & 0xFF)); o.push_back((char)(v >> 8)); }
+inline void put_u32(std::string& o, uint32_t v) { for (int i = 0; i < 4; ++i) o.push_back((char)((v >> (8 * i)) & 0xFF)); }
+inline void put_varint(std::string& o, uint64_t v) { while (v >= 0x80) { o.push_back((char)(v | 0x80)); v >>= 7; } o.push_back((char)v); }
+inline void put_zigzag(std::string& o, int64_t v) { put_varint(o, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+
+// Bounds-checked reader over a frame payload
+struct Reader {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+    bool need(size_t n) { if ((size_t)(end - p) < n) ok = false; return ok; }
+    uint8_t u8() { return need(1) ? *p++ : 0; }
+    uint16_t u16() { if (!need(2)) return 0; uint16_t v = (uint16_t)(p[0] | (p[1] << 8)); p += 2; return v; }
+    uint32_t u32() { if (!need(4)) return 0; uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); p += 4; return v; }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!need(1)) return 0;
+            uint8_t b = *p++; v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false; return 0;
+    }
+    int64_t zigzag() { uint64_t u = varint(); return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+};
+
+inline int32_t saturate(int64_t v) { return (int32_t)std::max<int64_t>(INT32_MIN, std::min<int64_t>(INT32_MAX, v)); }
+
+void put_header(std::string& o, uint8_t kind, uint32_t seq, uint32_t base_seq, double sim_time,
+                uint16_t spawns, uint16_t despawns, uint16_t changed, const std::vector<RegionSummary>* summaries,
+                const StateStamp* stamp)
+{
+    o.push_back((char)kFrameMagic); o.push_back((char)kStateFrameVersion); o.push_back((char)kind);
+    o.push_back((char)((summaries ? kFrameFlagSummary : 0) | (stamp ? kFrameFlagStamp : 0)));
+    put_u32(o, 0); // payload size, patched by finish()
+    put_u32(o, seq); put_u32(o, base_seq);
+    uint64_t t; std::memcpy(&t, &sim_time, 8); put_u32(o, (uint32_t)t); put_u32(o, (uint32_t)(t >> 32));
+    put_u16(o, spawns); put_u16(o, despawns); put_u16(o, changed);
+    put_u16(o, summaries ? (uint16_t)std::min<size_t>(summaries->size(), 0xFFFF) : 0);
+    if (stamp) { unsigned char buf[kFrameStampSize]; unsigned char* p = buf; write_stamp_record(p, *stamp); o.append((const char*)buf, kFrameStampSize); }
+}
+
+// Append the summary section (if any) and patch the payload size
+void finish(std::string& o, const std::vector<RegionSummary>* summaries)
+{
+    if (summaries) {
+        const size_t n = std::min<size_t>(summaries->size(), 0xFFFF);
+        unsigned char buf[kFrameSummarySize];
+        for (size_t i = 0; i < n; ++i) { unsigned char* p = buf; write_summary_record(p, (*summaries)[i]); o.append((const char*)buf, kFrameSummarySize); }
+    }
+    uint32_t payload = (uint32_t)(o.size() - kDeltaHeaderSize);
+    for (int i = 0; i < 4; ++i) o[4 + i] = (char)((payload >> (8 * i)) & 0xFF);
+}
+
+void put_record(std::string& o, const ShipRecord& r)
+{
+    unsigned char buf[kFrameShipSize]; unsigned char* p = buf;
+    write_ship_record(p, r);
+    o.append((const char*)buf, kFrameShipSize);
+}
+
+bool get_record(Reader& rd, ShipRecord& r)
+{
+    if (!rd.need(kFrameShipSize)) return false;
+    r = read_ship_record(rd.p);
+    return true;
+}
+
+} // anonymous
+
+ShipRecord predict_ship(const ShipRecord& base, double dt)
+{
+    ShipRecord r = base;
+    // x is in 1/8 px and vx in 1/64 px/s: dx = vx * dt / 8
+    r.x = saturate((int64_t)base.x + std::llround((double)base.vx * dt / 8.0));
+    r.y = saturate((int64_t)base.y + std::llround((double)base.vy * dt / 8.0));
+    return r;
+}
+
+std::string build_keyframe(uint32_t seq, double sim_time, const std::vector<ShipRecord>& cur,
+                           const std::vector<RegionSummary>* summaries, const StateStamp* stamp)
+{
+    if (stamp) sim_time = stamp->sim_time;
+    const size_t n = std::min(cur.size(), kMaxFrameShips);
+    std::string o; o.reserve(kDeltaHeaderSize + kFrameStampSize + n * kFrameShipSize);
+    put_header(o, kFrameKindKeyframe, seq, 0, sim_time, (uint16_t)n, 0, 0, summaries, stamp);
+    for (size_t i = 0; i < n; ++i) put_record(o, cur[i]);
+    finish(o, summaries);
+    return o;
+}
+
+std::string build_delta_frame(uint32_t seq, double sim_time, const StateSnapshot& base,
+                              const std::vector<ShipRecord>& cur, std::vector<ShipRecord>& recon,
+                              const std::vector<RegionSummary>* summaries, const StateStamp* stamp)
+{
+    if (stamp) sim_time = stamp->sim_time;
+    static const std::vector<ShipRecord> kNone;
+    const std::vector<ShipRecord>& prev = base.ships ? *base.ships : kNone;
+    const size_t n_cur = std::min(cur.size(), kMaxFrameShips);
+    const double dt = sim_time - base.sim_time;
+    std::string despawns, spawns, changed;
+    size_t n_despawn = 0, n_spawn = 0, n_changed = 0;
+    uint32_t last_despawn = 0, last_changed = 0;
+    recon.clear(); recon.reserve(n_cur);
+
+    // Every count fits the header: n_spawn and n_changed are at most n_cur,
+    // n_despawn at most the baseline's (capped the same way) size
+    size_t i = 0, j = 0;
+    while (i < prev.size() || j < n_cur) {
+        if (j == n_cur || (i < prev.size() && prev[i].uid < cur[j].uid)) {
+            put_varint(despawns, prev[i].uid - last_despawn); last_despawn = prev[i].uid; ++n_despawn; ++i;
+            continue;
+        }
+        if (i == prev.size() || cur[j].uid < prev[i].uid) {
+            put_record(spawns, cur[j]); recon.push_back(cur[j]); ++n_spawn; ++j;
+            continue;
+        }
+        const ShipRecord& b = prev[i]; const ShipRecord& c = cur[j];
+        ShipRecord r = predict_ship(b, dt);
+        uint32_t mask = 0;
+        if (std::llabs((int64_t)c.x - r.x) > kDeltaPosTolerance) mask |= kDeltaX;
+        if (std::llabs((int64_t)c.y - r.y) > kDeltaPosTolerance) mask |= kDeltaY;
+        if (c.vx != b.vx) mask |= kDeltaVx;
+        if (c.vy != b.vy) mask |= kDeltaVy;
+        if (c.theta != b.theta) mask |= kDeltaTheta;
+        if (c.throttle != b.throttle) mask |= kDeltaThrottle;
+        if (c.team != b.team) mask |= kDeltaTeam;
+        if (c.def != b.def) mask |= kDeltaDef;
+        if (c.delta_v != b.delta_v) mask |= kDeltaDv;
+        if (c.acc != b.acc) mask |= kDeltaAcc;
+        if (mask) {
+            put_varint(changed, c.uid - last_changed); last_changed = c.uid; put_varint(changed, mask);
+            if (mask & kDeltaX) { put_zigzag(changed, (int64_t)c.x - r.x); r.x = c.x; }
+            if (mask & kDeltaY) { put_zigzag(changed, (int64_t)c.y - r.y); r.y = c.y; }
+            if (mask & kDeltaVx) { put_zigzag(changed, (int64_t)c.vx - b.vx); r.vx = c.vx; }
+            if (mask & kDeltaVy) { put_zigzag(changed, (int64_t)c.vy - b.vy); r.vy = c.vy; }
+            if (mask & kDeltaTheta) { put_zigzag(changed, (int16_t)(uint16_t)(c.theta - b.theta)); r.theta = c.theta; }
+            if (mask & kDeltaThrottle) { changed.push_back((char)c.throttle); r.throttle = c.throttle; }
+            if (mask & kDeltaTeam) { changed.push_back((char)c.team); r.team = c.team; }
+            if (mask & kDeltaDef) { put_u16(changed, c.def); r.def = c.def; }
+            if (mask & kDeltaDv) { put_u32(changed, c.delta_v); r.delta_v = c.delta_v; }
+            if (mask & kDeltaAcc) { put_u32(changed, c.acc); r.acc = c.acc; }
+            ++n_changed;
+        }
+        recon.push_back(r);
+        ++i; ++j;
+    }
+
+    std::string o; o.reserve(kDeltaHeaderSize + kFrameStampSize + despawns.size() + spawns.size() + changed.size());
+    put_header(o, kFrameKindDelta, seq, base.seq, sim_time, (uint16_t)n_spawn, (uint16_t)n_despawn, (uint16_t)n_changed, summaries, stamp);
+    o += despawns; o += spawns; o += changed;
+    finish(o, summaries);
+    return o;
+}
+
+bool DeltaDecoder::decode (const char* data, size_t n, std::vector<NetObjectView>& out, uint32_t* seq_out,
+                           std::vector<RegionSummary>* summaries_out, StateStamp* stamp_out)
+{
+    out.clear(); if (summaries_out) summaries_out->clear(); if (stamp_out) *stamp_out = StateStamp();
+    if (n < kDeltaHeaderSize) return false;
+    Reader rd{(const unsigned char*)data, (const unsigned char*)data + n};
+    if (rd.u8() != kFrameMagic || rd.u8() != kStateFrameVersion) return false;
+    const uint8_t kind = rd.u8(); const uint8_t flags = rd.u8();
+    if (kind != kFrameKindKeyframe && kind != kFrameKindDelta) return false;
+    uint32_t payload = rd.u32();
+    if (n < kDeltaHeaderSize + payload) return false;
+    rd.end = (const unsigned char*)data + kDeltaHeaderSize + payload; // stop at this frame's end
+    StateSnapshot snap;
+    snap.seq = rd.u32();
+    const uint32_t base_seq = rd.u32();
+    uint64_t tbits = rd.u32(); tbits |= (uint64_t)rd.u32() << 32; std::memcpy(&snap.sim_time, &tbits, 8);
+    const size_t n_spawn = rd.u16(), n_despawn = rd.u16(), n_changed = rd.u16();
+    size_t n_summary = rd.u16(); if (!(flags & kFrameFlagSummary)) n_summary = 0;
+    StateStamp stamp;
+    if (flags & kFrameFlagStamp) { if (!rd.need(kFrameStampSize)) return false; stamp = read_stamp_record(rd.p); }
+
+    auto ships = std::make_shared<std::vector<ShipRecord>>();
+    if (kind == kFrameKindKeyframe) {
+        ships->resize(n_spawn);
+        for (auto& r : *ships) if (!get_record(rd, r)) return false;
+    } else {
+        auto it = std::find_if(history_.begin(), history_.end(), [&](const StateSnapshot& s){ return s.seq == base_seq; });
+        if (it == history_.end()) return false; // baseline too old; wait for a keyframe
+        const std::vector<ShipRecord>& prev = *it->ships;
+        const double dt = snap.sim_time - it->sim_time;
+
+        std::vector<uint32_t> gone(n_despawn); uint32_t uid = 0;
+        for (auto& g : gone) { uid += (uint32_t)rd.varint(); g = uid; }
+        std::vector<ShipRecord> born(n_spawn);
+        for (auto& r : born) if (!get_record(rd, r)) return false;
+        if (!rd.ok) return false;
+
+        // Survivors, predicted; gone and prev are both sorted by uid
+        std::vector<ShipRecord> kept; kept.reserve(prev.size());
+        size_t g = 0;
+        for (const auto& b : prev) {
+            while (g < gone.size() && gone[g] < b.uid) ++g;
+            if (g < gone.size() && gone[g] == b.uid) continue;
+            kept.push_back(predict_ship(b, dt));
+        }
+        size_t k = 0; uid = 0;
+        for (size_t c = 0; c < n_changed; ++c) {
+            uid += (uint32_t)rd.varint();
+            uint32_t mask = (uint32_t)rd.varint();
+            while (k < kept.size() && kept[k].uid < uid) ++k;
+            if (!rd.ok || k == kept.size() || kept[k].uid != uid) return false;
+            ShipRecord& r = kept[k];
+            const ShipRecord b = r; // predicted; velocity/theta still the baseline's
+            if (mask & kDeltaX) r.x = saturate((int64_t)b.x + rd.zigzag());
+            if (mask & kDeltaY) r.y = saturate((int64_t)b.y + rd.zigzag());
+            if (mask & kDeltaVx) r.vx = saturate((int64_t)b.vx + rd.zigzag());
+            if (mask & kDeltaVy) r.vy = saturate((int64_t)b.vy + rd.zigzag());
+            if (mask & kDeltaTheta) r.theta = (uint16_t)(b.theta + (uint16_t)(int16_t)rd.zigzag());
+            if (mask & kDeltaThrottle) r.throttle = (int8_t)rd.u8();
+            if (mask & kDeltaTeam) r.team = (int8_t)rd.u8();
+            if (mask & kDeltaDef) r.def = rd.u16();
+            if (mask & kDeltaDv) r.delta_v = rd.u32();
+            if (mask & kDeltaAcc) r.acc = rd.u32();
+            if (!rd.ok) return false;
+        }
+        ships->reserve(kept.size() + born.size());
+        std::merge(kept.begin(), kept.end(), born.begin(), born.end(), std::back_inserter(*ships),
+                   [](const ShipRecord& a, const ShipRecord& b){ return a.uid < b.uid; });
+    }
+    if (!rd.ok || !rd.need(n_summary * kFrameSummarySize)) return false;
+    if (summaries_out) { summaries_out->resize(n_summary); for (auto& r : *summaries_out) r = read_summary_record(rd.p); }
+
+    out.resize(ships->size());
+    for (size_t i = 0; i < ships->size(); ++i) ship_record_to_view((*ships)[i], out[i]);
+    snap.ships = std::move(ships);
+    if (seq_out) *seq_out = snap.seq;
+    if (stamp_out) *stamp_out = stamp;
+    if (kind == kFrameKindDelta) {
+        // The server's baseline only moves forward: older frames are done with
+        while (history_.front().seq != base_seq) history_.pop_front();
+        base_seq_ = base_seq;
+    }
+    history_.push_back(std::move(snap));
+    while (history_.size() > 2 * kDeltaHistory) {
+        if (history_.front().seq == base_seq_) history_.erase(history_.begin() + 1);
+        else history_.pop_front();
+    }
+    return true;
+}
+
+} // namespace tcp_protocol
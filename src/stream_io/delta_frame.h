@@ -0,0 +1,98 @@
+// Delta-compressed ship state frames against a per-client acknowledged baseline.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stream_io/state_frame.h"
+
+namespace tcp_protocol {
+
+// Join capability (together with kCapBinaryState) for keyframe/delta state;
+// the joined reply then names it as "state_format".
+constexpr const char* kCapDeltaState = "delta1";
+
+// Header of keyframe and delta frames (kDeltaHeaderSize bytes, little endian):
+//   u8 magic, u8 version, u8 kind, u8 flags, u32 payload bytes after the header,
+//   u32 seq, u32 base_seq (0 for keyframes), f64 sim_time,
+//   u16 spawn count, u16 despawn count, u16 changed count, u16 summary count
+// With kFrameFlagStamp the stamp section (state_frame.h) follows the header;
+// its sim_time equals the header's.
+// Keyframe payload: spawn count ship records (the whole ship list).
+// Delta payload:
+//   despawns: varint uid gaps (ascending uids)
+//   spawns:   ship records
+//   changed:  varint uid gap, varint field mask, then per set bit in order:
+//             x, y (zigzag varint from prediction), vx, vy (zigzag from base),
+//             theta (zigzag of the wrapped 16-bit difference), throttle, team (i8),
+//             def (u16), delta_v, acc (u32 float bits)
+// Both kinds end with summary count summary records (state_frame.h) when
+// flags has kFrameFlagSummary; summaries are not delta coded.
+// Ships absent from every list are unchanged up to prediction: position is the
+// baseline moved ballistically by its velocity over the sim time elapsed since
+// the baseline (predict_ship), everything else equals the baseline.
+enum DeltaField : uint32_t {
+    kDeltaX = 1u << 0, kDeltaY = 1u << 1, kDeltaVx = 1u << 2, kDeltaVy = 1u << 3,
+    kDeltaTheta = 1u << 4, kDeltaThrottle = 1u << 5, kDeltaTeam = 1u << 6,
+    kDeltaDef = 1u << 7, kDeltaDv = 1u << 8, kDeltaAcc = 1u << 9,
+};
+
+// Position error (1/8 px units) tolerated before a predicted ship is resent.
+constexpr int32_t kDeltaPosTolerance = 4;
+// Server sends a keyframe at least this often (in frames) to every client.
+constexpr uint32_t kKeyframeInterval = 64;
+// Unacked frames the server keeps for baselines; acks of older frames are
+// ignored and the previous baseline stays in use.
+constexpr size_t kDeltaHistory = 32;
+// Most ships one frame carries (the header counts are u16).
+constexpr size_t kMaxFrameShips = 0xFFFF;
+
+// A decoded or sent ship list (sorted by uid), shared between clients.
+struct StateSnapshot {
+    uint32_t seq = 0;
+    double sim_time = 0.0;
+    std::shared_ptr<const std::vector<ShipRecord>> ships;
+};
+
+// Ballistic prediction of a baseline record dt sim seconds later.
+ShipRecord predict_ship(const ShipRecord& base, double dt);
+
+// Drop the ships past kMaxFrameShips, so the list a frame is built from is
+// also the baseline the client ends up holding.
+inline void cap_frame_ships(std::vector<ShipRecord>& ships) { if (ships.size() > kMaxFrameShips) ships.resize(kMaxFrameShips); }
+
+// Keyframe holding every ship in cur (at most kMaxFrameShips; see
+// cap_frame_ships). A stamp (optional) adds the stamp section; sim_time is
+// taken from it then.
+std::string build_keyframe(uint32_t seq, double sim_time, const std::vector<ShipRecord>& cur,
+                           const std::vector<RegionSummary>* summaries = nullptr,
+                           const StateStamp* stamp = nullptr);
+
+// Delta of cur against base (both at most kMaxFrameShips; ships past that in
+// cur are left out). recon receives what the client will hold after decoding
+// (predicted values where a field was omitted); keep it as the baseline
+// candidate for seq.
+std::string build_delta_frame(uint32_t seq, double sim_time, const StateSnapshot& base,
+                              const std::vector<ShipRecord>& cur, std::vector<ShipRecord>& recon,
+                              const std::vector<RegionSummary>* summaries = nullptr,
+                              const StateStamp* stamp = nullptr);
+
+// Client side: keeps recent decoded frames as baselines.
+class DeltaDecoder {
+public:
+    // Decode a keyframe or delta frame into ship views. Returns false on a
+    // malformed frame or a delta whose baseline is no longer held; seq_out is
+    // set on success (acknowledge it so the server can use it as baseline).
+    bool decode (const char* data, size_t n, std::vector<NetObjectView>& out, uint32_t* seq_out,
+                 std::vector<RegionSummary>* summaries_out = nullptr, StateStamp* stamp_out = nullptr);
+
+private:
+    std::deque<StateSnapshot> history_;
+    uint32_t base_seq_ = 0; // newest baseline a delta used; kept while trimming
+};
+
+} // namespace tcp_protocol
@@ -0,0 +1,106 @@
+// Area-of-interest selection over a per-broadcast spatial index.
+
+#include "stream_io/interest.h"
+
+#include "engine/object.h"
+#include "engine/ship.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace tcp_protocol {
+
+InterestIndex::InterestIndex(double radius, double summary_cell)
+  : radius_(radius > 0.0 ? radius : 1.0),
+    summary_cell_(summary_cell > 0.0 ? summary_cell : 4.0 * radius_),
+    grid_(radius_)
+{
+}
+
+void InterestIndex::build(const std::map<uint64_t, Ship*>& uid_to_ship,
+                          const std::vector<std::unique_ptr<Object>>& objs)
+{
+    items_.clear(); team_ships_.clear();
+    grid_.clear(radius_);
+    for (const auto& kv : uid_to_ship) {
+        const Ship* s = kv.second;
+        if (!s) continue;
+        Item it; it.obj = s; it.uid = kv.first; it.x = s->x_pixels(); it.y = s->y_pixels(); it.team = s->team; it.ship = true;
+        team_ships_[s->team].push_back((uint32_t)items_.size());
+        items_.push_back(it);
+    }
+    ship_count_ = items_.size();
+    for (const auto& up : objs) {
+        const Object* o = up.get();
+        if (!o) continue;
+        Item it; it.obj = o; it.x = o->x_pixels(); it.y = o->y_pixels(); it.team = o->team;
+        it.ship = (o->type == Object::SHIP); it.planet = (o->type == Object::PLANET);
+        items_.push_back(it);
+    }
+    // Centers only: planets are always of interest and would otherwise
+    // cover millions of cells
+    for (size_t i = 0; i < items_.size(); ++i)
+        if (!items_[i].planet) grid_.insert((uint32_t)i, items_[i].x, items_[i].y, 0.0);
+    mark_.assign(items_.size(), 0); epoch_ = 0;
+}
+
+void InterestIndex::mark_circle(double x, double y, double r) const
+{
+    grid_.query_aabb(x - r, y - r, x + r, y + r, hits_);
+    const double r2 = r * r;
+    for (uint32_t h : hits_) {
+        const double dx = items_[h].x - x, dy = items_[h].y - y;
+        if (dx * dx + dy * dy <= r2) mark_[h] = epoch_;
+    }
+}
+
+void InterestIndex::select(const InterestHint& hint, bool include_all, InterestSelection& out) const
+{
+    out.include_all = include_all;
+    out.ships.clear(); out.objects.clear(); out.summaries.clear();
+    if (++epoch_ == 0) { std::fill(mark_.begin(), mark_.end(), 0u); epoch_ = 1; }
+
+    if (hint.team >= 0) {
+        auto it = team_ships_.find(hint.team);
+        if (it != team_ships_.end()) {
+            for (uint32_t i : it->second) { mark_[i] = epoch_; mark_circle(items_[i].x, items_[i].y, radius_); }
+        }
+    }
+    if (hint.has_view && hint.view_r > 0.0) mark_circle(hint.view_x, hint.view_y, hint.view_r);
+
+    // Left-out ships (and objects with include_all) per coarse cell and team
+    struct Acc { double sx = 0.0, sy = 0.0; uint32_t ships = 0, objects = 0; };
+    std::map<std::tuple<int64_t, int64_t, int>, Acc> regions;
+    auto summarize = [&](const Item& it) {
+        Acc& a = regions[std::make_tuple((int64_t)std::floor(it.x / summary_cell_), (int64_t)std::floor(it.y / summary_cell_), it.team)];
+        a.sx += it.x; a.sy += it.y;
+        if (it.ship) ++a.ships; else ++a.objects;
+    };
+
+    for (size_t i = 0; i < ship_count_; ++i) {
+        const Item& it = items_[i];
+        if (mark_[i] == epoch_) out.ships.emplace_back(it.uid, static_cast<const Ship*>(it.obj));
+        else summarize(it);
+    }
+    if (include_all) {
+        for (size_t i = ship_count_; i < items_.size(); ++i) {
+            const Item& it = items_[i];
+            if (it.planet || mark_[i] == epoch_) out.objects.push_back(it.obj);
+            else if (!it.ship) summarize(it); // ships are already counted above
+        }
+    }
+
+    out.summaries.reserve(regions.size());
+    for (const auto& kv : regions) {
+        const Acc& a = kv.second;
+        RegionSummary s;
+        s.team = std::get<2>(kv.first);
+        const double n = (double)(a.ships + a.objects);
+        s.x = a.sx / n; s.y = a.sy / n;
+        s.ships = a.ships; s.objects = a.objects;
+        out.summaries.push_back(s);
+    }
+}
+
+} // namespace tcp_protocol
@@ -0,0 +1,81 @@
+// Per-client area of interest: which objects a state broadcast carries in full
+// for a client, and coarse per-region summaries of everything else.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "engine/spatial_grid.h"
+#include "stream_io/tcp_protocol.h"
+
+class Object;
+class Ship;
+
+namespace tcp_protocol {
+
+// What a client is interested in: the surroundings of its team's ships (team
+// from join) and an optional camera circle (view message), in world pixels.
+struct InterestHint {
+    int team = -1;
+    bool has_view = false;
+    double view_x = 0.0, view_y = 0.0, view_r = 0.0;
+
+    bool filtered() const { return team >= 0 || has_view; }
+    bool operator==(const InterestHint& o) const {
+        return team == o.team && has_view == o.has_view &&
+               (!has_view || (view_x == o.view_x && view_y == o.view_y && view_r == o.view_r));
+    }
+};
+
+// Objects one client receives. Ships are in uid order, objects in world order
+// (include_all only); summaries aggregate what was left out.
+struct InterestSelection {
+    bool include_all = false;
+    std::vector<std::pair<uint64_t, const Ship*>> ships;
+    std::vector<const Object*> objects;
+    std::vector<RegionSummary> summaries;
+};
+
+// Spatial index over the world, rebuilt once per broadcast and queried once
+// per distinct hint. An object is of interest when its center lies within
+// radius of one of the hint team's ships or inside the camera circle; planets
+// always are. Left-out objects are summarized per summary_cell square and team.
+class InterestIndex {
+public:
+    explicit InterestIndex(double radius, double summary_cell = 0.0);
+
+    void build(const std::map<uint64_t, Ship*>& uid_to_ship,
+               const std::vector<std::unique_ptr<Object>>& objs);
+
+    void select(const InterestHint& hint, bool include_all, InterestSelection& out) const;
+
+    double radius() const { return radius_; }
+
+private:
+    struct Item {
+        const Object* obj = nullptr;
+        uint64_t uid = 0;   // ships only
+        double x = 0.0, y = 0.0;
+        int team = 0;
+        bool ship = false;
+        bool planet = false;
+    };
+
+    void mark_circle(double x, double y, double r) const;
+
+    double radius_;
+    double summary_cell_;
+    SpatialGrid grid_;        // handles are item indices; planets are not inserted
+    std::vector<Item> items_; // ships in uid order, then the other objects in world order
+    size_t ship_count_ = 0;
+    std::map<int, std::vector<uint32_t>> team_ships_;
+    mutable std::vector<uint32_t> mark_; // item selected when equal to epoch_
+    mutable uint32_t epoch_ = 0;
+    mutable std::vector<uint32_t> hits_;
+};
+
+} // namespace tcp_protocol
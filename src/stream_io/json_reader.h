@@ -0,0 +1,243 @@
+// In-place JSON reader for small messages of a known shape: a validating
+// cursor over the text that hands out values as spans into it, so nothing is
+// allocated unless a caller copies a string out. Integers are read exactly
+// (no detour through double). Nesting is limited to 64 levels.
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+class JsonReader {
+public:
+    enum Kind : uint8_t { kMissing, kNull, kTrue, kFalse, kNumber, kString, kArray, kObject };
+
+    // A scanned value. Strings span their contents without the quotes;
+    // numbers, arrays and objects span their raw text.
+    struct Value {
+        Kind kind = kMissing;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        bool escaped = false;  // string with backslash escapes
+        bool integral = false; // number without fraction or exponent
+
+        bool present() const { return kind != kMissing; }
+        bool is_number() const { return kind == kNumber; }
+        bool is_string() const { return kind == kString; }
+
+        bool equals(const char* s) const {
+            if (kind != kString) return false;
+            if (escaped) { std::string u; return get(u) && u == s; }
+            const size_t n = std::strlen(s);
+            return (size_t)(end - begin) == n && std::memcmp(begin, s, n) == 0;
+        }
+
+        // Conversions fail on the wrong kind or on out-of-range numbers.
+        // Integer targets take non-integral numbers truncated toward zero.
+        bool get(double& out) const {
+            if (kind != kNumber) return false;
+            auto r = std::from_chars(begin, end, out);
+            return r.ec == std::errc() && r.ptr == end;
+        }
+        bool get(int64_t& out) const {
+            if (kind != kNumber) return false;
+            if (integral) { auto r = std::from_chars(begin, end, out); return r.ec == std::errc() && r.ptr == end; }
+            double d; if (!get(d) || !(d > -9223372036854775808.0 && d < 9223372036854775808.0)) return false;
+            out = (int64_t)d; return true;
+        }
+        bool get(uint64_t& out) const {
+            if (kind != kNumber || *begin == '-') return false;
+            if (integral) { auto r = std::from_chars(begin, end, out); return r.ec == std::errc() && r.ptr == end; }
+            double d; if (!get(d) || !(d < 18446744073709551616.0)) return false;
+            out = (uint64_t)d; return true;
+        }
+        bool get(std::string& out) const {
+            if (kind != kString) return false;
+            if (!escaped) { out.assign(begin, end); return true; }
+            return unescape(begin, end, out);
+        }
+    };
+
+    JsonReader(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    // Scan one value (validating nested containers) and advance past it
+    bool value(Value& out) { return scan(out, 0); }
+
+    // Scan an object, calling f(std::string_view key, const Value& v) per
+    // member in text order. Keys are compared raw (escapes are not decoded).
+    template <typename F>
+    bool object(F&& f) { ws(); return p_ != end_ && *p_ == '{' && members(f, 1); }
+
+    // Scan an array, calling f(const Value& v) per element
+    template <typename F>
+    bool array(F&& f) { ws(); return p_ != end_ && *p_ == '[' && elements(f, 1); }
+
+    // Only whitespace left
+    bool at_end() { ws(); return p_ == end_; }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    void ws() { while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_; }
+
+    static bool digit(char c) { return c >= '0' && c <= '9'; }
+    static int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool literal(const char* lit, size_t n) {
+        if ((size_t)(end_ - p_) < n || std::memcmp(p_, lit, n) != 0) return false;
+        p_ += n; return true;
+    }
+
+    // At the opening quote
+    bool string(Value& out) {
+        out.kind = kString; out.escaped = false;
+        out.begin = ++p_;
+        while (p_ != end_) {
+            const unsigned char c = (unsigned char)*p_;
+            if (c == '"') { out.end = p_++; return true; }
+            if (c < 0x20) return false;
+            if (c == '\\') {
+                out.escaped = true;
+                if (++p_ == end_) return false;
+                switch (*p_) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': break;
+                case 'u':
+                    if (end_ - p_ < 5 || hex(p_[1]) < 0 || hex(p_[2]) < 0 || hex(p_[3]) < 0 || hex(p_[4]) < 0) return false;
+                    p_ += 4; break;
+                default: return false;
+                }
+            }
+            ++p_;
+        }
+        return false;
+    }
+
+    bool number(Value& out) {
+        out.kind = kNumber; out.begin = p_; out.integral = true;
+        if (p_ != end_ && *p_ == '-') ++p_;
+        if (p_ == end_ || !digit(*p_)) return false;
+        if (*p_ == '0') ++p_; else while (p_ != end_ && digit(*p_)) ++p_;
+        if (p_ != end_ && *p_ == '.') {
+            out.integral = false; ++p_;
+            if (p_ == end_ || !digit(*p_)) return false;
+            while (p_ != end_ && digit(*p_)) ++p_;
+        }
+        if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+            out.integral = false; ++p_;
+            if (p_ != end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (p_ == end_ || !digit(*p_)) return false;
+            while (p_ != end_ && digit(*p_)) ++p_;
+        }
+        out.end = p_;
+        return true;
+    }
+
+    bool scan(Value& out, int depth) {
+        ws();
+        out.escaped = out.integral = false;
+        if (p_ == end_) return false;
+        switch (*p_) {
+        case '"': return string(out);
+        case 't': out.kind = kTrue; out.begin = p_; if (!literal("true", 4)) return false; out.end = p_; return true;
+        case 'f': out.kind = kFalse; out.begin = p_; if (!literal("false", 5)) return false; out.end = p_; return true;
+        case 'n': out.kind = kNull; out.begin = p_; if (!literal("null", 4)) return false; out.end = p_; return true;
+        case '{': case '[': {
+            if (depth >= kMaxDepth) return false;
+            const bool obj = (*p_ == '{');
+            out.kind = obj ? kObject : kArray; out.begin = p_;
+            // Nested containers are validated and skipped; callers that
+            // need their contents scan the span again with their own reader
+            auto skip_member = [](std::string_view, const Value&) {};
+            auto skip_element = [](const Value&) {};
+            bool ok = obj ? members(skip_member, depth + 1) : elements(skip_element, depth + 1);
+            out.end = p_;
+            return ok;
+        }
+        default: return number(out);
+        }
+    }
+
+    // At the opening brace; children are scanned at depth
+    template <typename F>
+    bool members(F& f, int depth) {
+        ++p_; ws();
+        if (p_ != end_ && *p_ == '}') { ++p_; return true; }
+        while (true) {
+            Value k, v;
+            ws();
+            if (p_ == end_ || *p_ != '"' || !string(k)) return false;
+            ws();
+            if (p_ == end_ || *p_ != ':') return false;
+            ++p_;
+            if (!scan(v, depth)) return false;
+            f(std::string_view(k.begin, (size_t)(k.end - k.begin)), v);
+            ws();
+            if (p_ == end_) return false;
+            if (*p_ == ',') { ++p_; continue; }
+            if (*p_ == '}') { ++p_; return true; }
+            return false;
+        }
+    }
+
+    template <typename F>
+    bool elements(F& f, int depth) {
+        ++p_; ws();
+        if (p_ != end_ && *p_ == ']') { ++p_; return true; }
+        while (true) {
+            Value v;
+            if (!scan(v, depth)) return false;
+            f(v);
+            ws();
+            if (p_ == end_) return false;
+            if (*p_ == ',') { ++p_; continue; }
+            if (*p_ == ']') { ++p_; return true; }
+            return false;
+        }
+    }
+
+    // Escapes were validated by string(); \u code units are written as UTF-8
+    static bool unescape(const char* p, const char* end, std::string& out) {
+        out.clear();
+        while (p != end) {
+            if (*p != '\\') { out.push_back(*p++); continue; }
+            ++p;
+            const char c = *p++;
+            switch (c) {
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp = (uint32_t)(hex(p[0]) << 12 | hex(p[1]) << 8 | hex(p[2]) << 4 | hex(p[3]));
+                p += 4;
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    const int h0 = hex(p[2]), h1 = hex(p[3]), h2 = hex(p[4]), h3 = hex(p[5]);
+                    const uint32_t lo = (uint32_t)(h0 << 12 | h1 << 8 | h2 << 4 | h3);
+                    if (h0 >= 0 && h1 >= 0 && h2 >= 0 && h3 >= 0 && lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                if (cp < 0x80) out.push_back((char)cp);
+                else if (cp < 0x800) { out.push_back((char)(0xC0 | cp >> 6)); out.push_back((char)(0x80 | (cp & 0x3F))); }
+                else if (cp < 0x10000) { out.push_back((char)(0xE0 | cp >> 12)); out.push_back((char)(0x80 | (cp >> 6 & 0x3F))); out.push_back((char)(0x80 | (cp & 0x3F))); }
+                else { out.push_back((char)(0xF0 | cp >> 18)); out.push_back((char)(0x80 | (cp >> 12 & 0x3F))); out.push_back((char)(0x80 | (cp >> 6 & 0x3F))); out.push_back((char)(0x80 | (cp & 0x3F))); }
+                break;
+            }
+            default: out.push_back(c); break; // " \ /
+            }
+        }
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+};
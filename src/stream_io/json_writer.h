@@ -0,0 +1,80 @@
+// Streaming JSON writer: appends straight into a caller-owned buffer, so no
+// object graph is built and nothing is allocated once the buffer has reached
+// its working size. Doubles use the shortest representation that parses back
+// to the same value. Nesting is limited to 64 levels.
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter& begin_object() { open('{'); return *this; }
+    JsonWriter& end_object() { close('}'); return *this; }
+    JsonWriter& begin_array() { open('['); return *this; }
+    JsonWriter& end_array() { close(']'); return *this; }
+
+    // Key of the next value inside an object
+    JsonWriter& key(const char* k) { separate(); string(k); out_.push_back(':'); after_key_ = true; return *this; }
+
+    JsonWriter& value(double v) { separate(); number(v); return *this; }
+    JsonWriter& value(int64_t v) { separate(); integer(v); return *this; }
+    JsonWriter& value(int v) { return value((int64_t)v); }
+    JsonWriter& value(uint64_t v) { separate(); char b[24]; auto r = std::to_chars(b, b + sizeof(b), v); out_.append(b, r.ptr); return *this; }
+    JsonWriter& value(const char* s) { separate(); string(s); return *this; }
+    JsonWriter& value(const std::string& s) { return value(s.c_str()); }
+
+    template <typename T>
+    JsonWriter& field(const char* k, const T& v) { key(k); return value(v); }
+
+    // Terminate a line-delimited message
+    void newline() { out_.push_back('\n'); }
+
+private:
+    void separate() {
+        if (after_key_) { after_key_ = false; return; }
+        if (depth_ == 0) return;
+        const uint64_t bit = 1ull << (depth_ - 1);
+        if (nonempty_ & bit) out_.push_back(',');
+        nonempty_ |= bit;
+    }
+    void open(char c) {
+        separate(); out_.push_back(c);
+        ++depth_; if (depth_ <= 64) nonempty_ &= ~(1ull << (depth_ - 1));
+    }
+    void close(char c) { out_.push_back(c); if (depth_ > 0) --depth_; }
+
+    void integer(int64_t v) { char b[24]; auto r = std::to_chars(b, b + sizeof(b), v); out_.append(b, r.ptr); }
+
+    // Non-finite values have no JSON spelling; they are written as null
+    void number(double v) {
+        if (!std::isfinite(v)) { out_.append("null", 4); return; }
+        char b[32]; auto r = std::to_chars(b, b + sizeof(b), v);
+        out_.append(b, r.ptr);
+        // Keep doubles recognizable as such (json-c writes 1.0, not 1)
+        if (std::memchr(b, '.', (size_t)(r.ptr - b)) == nullptr && std::memchr(b, 'e', (size_t)(r.ptr - b)) == nullptr) out_.append(".0", 2);
+    }
+
+    void string(const char* s) {
+        static const char kHex[] = "0123456789abcdef";
+        out_.push_back('"');
+        for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+            const unsigned char c = *p;
+            if (c == '"' || c == '\\') { out_.push_back('\\'); out_.push_back((char)c); }
+            else if (c == '\n') out_.append("\\n", 2);
+            else if (c < 0x20) { const char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]}; out_.append(esc, 6); }
+            else out_.push_back((char)c);
+        }
+        out_.push_back('"');
+    }
+
+    std::string& out_;
+    int depth_ = 0;
+    uint64_t nonempty_ = 0; // bit d-1: container at depth d already has an element
+    bool after_key_ = false;
+};
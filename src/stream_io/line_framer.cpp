@@ -0,0 +1,52 @@
+#include "stream_io/line_framer.h"
+
+#include <algorithm>
+#include <cstring>
+
+LineFramer::LineFramer(size_t max_line)
+  : max_line_(max_line)
+{
+}
+
+char* LineFramer::prepare(size_t n)
+{
+    if (buf_.size() - wr_ < n) {
+        // Move the unread tail to the front before growing; each byte is moved
+        // at most once per line, not once per message as with erase(0, ...)
+        if (rd_ > 0) {
+            std::memmove(buf_.data(), buf_.data() + rd_, wr_ - rd_);
+            wr_ -= rd_; scan_ -= rd_; rd_ = 0;
+        }
+        if (buf_.size() - wr_ < n) buf_.resize(std::max(2 * buf_.size(), wr_ + n));
+    }
+    return buf_.data() + wr_;
+}
+
+LineFramer::Status LineFramer::next_line(std::string_view& line)
+{
+    while (true) {
+        char* base = buf_.data();
+        char* nl = (wr_ > scan_) ? (char*)std::memchr(base + scan_, '\n', wr_ - scan_) : nullptr;
+        if (!nl) {
+            scan_ = wr_;
+            if (discard_) { rd_ = scan_ = wr_; }
+            else if (wr_ - rd_ > max_line_) { discard_ = true; rd_ = scan_ = wr_; return kTooLong; }
+            if (rd_ == wr_) rd_ = wr_ = scan_ = 0; // empty: restart at the front for free
+            return kNone;
+        }
+        const size_t start = rd_, end = (size_t)(nl - base);
+        *nl = '\0';
+        rd_ = scan_ = end + 1;
+        if (discard_) { discard_ = false; continue; } // tail of a dropped line
+        if (end - start > max_line_) return kTooLong;
+        line = std::string_view(base + start, end - start);
+        return kLine;
+    }
+}
+
+void LineFramer::consume(size_t n)
+{
+    rd_ += std::min(n, wr_ - rd_);
+    if (scan_ < rd_) scan_ = rd_;
+    if (rd_ == wr_) rd_ = wr_ = scan_ = 0;
+}
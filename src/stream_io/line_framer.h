@@ -0,0 +1,40 @@
+// Newline framing over a compacting receive buffer, shared by the engine
+// server and the UI. Bytes are received in place, lines are handed out as
+// views into the buffer and memory is reused across messages.
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+class LineFramer {
+public:
+    enum Status { kNone, kLine, kTooLong };
+
+    // Lines longer than max_line bytes are dropped (see next_line).
+    explicit LineFramer(size_t max_line);
+
+    // Writable space for at least n more bytes; fill it, then commit what
+    // was written. Invalidates views handed out earlier.
+    char* prepare(size_t n);
+    void commit(size_t n) { wr_ += n; }
+
+    // Next complete line without its '\n'. The '\n' is overwritten with a NUL,
+    // so line.data() is also a C string; it stays valid until prepare().
+    // kTooLong reports (once per line) that a line exceeded max_line and was
+    // dropped; framing resumes after its newline.
+    Status next_line(std::string_view& line);
+
+    // Unread bytes, for callers that also carry length-prefixed binary frames;
+    // consume(n) drops n of them.
+    std::string_view pending() const { return std::string_view(buf_.data() + rd_, wr_ - rd_); }
+    void consume(size_t n);
+
+private:
+    std::vector<char> buf_;
+    size_t rd_ = 0;   // first unread byte
+    size_t wr_ = 0;   // end of received data
+    size_t scan_ = 0; // bytes before this hold no '\n' of the current line
+    size_t max_line_;
+    bool discard_ = false; // inside a dropped overlong line
+};
@@ -0,0 +1,77 @@
+// Lock-free queues for handing work between the network and simulation threads.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Unbounded multi-producer / single-consumer queue (Vyukov). push never
+// blocks or fails; pop is only called from the one consumer thread.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue () : head_(new Node()), tail_(head_.load()) {}
+    ~MpscQueue () { T tmp; while (pop(tmp)) {} delete tail_; }
+    MpscQueue (const MpscQueue&) = delete;
+    MpscQueue& operator= (const MpscQueue&) = delete;
+
+    void push (T v) {
+        Node* n = new Node(); n->value = std::move(v);
+        Node* prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    // False when empty (or a producer is mid-push; the item shows up on a later pop).
+    bool pop (T& out) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        delete tail_;
+        tail_ = next; // next becomes the new stub
+        return true;
+    }
+
+private:
+    struct Node { std::atomic<Node*> next{nullptr}; T value{}; };
+    alignas(64) std::atomic<Node*> head_; // producers
+    alignas(64) Node* tail_;               // consumer-owned stub
+};
+
+// Bounded single-producer / single-consumer ring. Capacity is rounded up to a
+// power of two; try_push fails instead of blocking when the ring is full.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing (size_t capacity) {
+        size_t n = 2; while (n < capacity) n <<= 1;
+        slots_.resize(n); mask_ = n - 1;
+    }
+    SpscRing (const SpscRing&) = delete;
+    SpscRing& operator= (const SpscRing&) = delete;
+
+    bool try_push (T v) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_.load(std::memory_order_acquire) > mask_) return false;
+        slots_[h & mask_] = std::move(v);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop (T& out) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire)) return false;
+        out = std::move(slots_[t & mask_]);
+        slots_[t & mask_] = T(); // release payload references promptly
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity () const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // producer
+    alignas(64) std::atomic<size_t> tail_{0}; // consumer
+};
@@ -0,0 +1,182 @@
+// LZ77 codec and compressed frame container shared by the engine server and
+// the UI.
+
+#include "stream_io/lz_frame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace tcp_protocol {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr int kHashBits = 16;
+constexpr uint32_t kNoPos = UINT32_MAX;
+
+inline uint32_t load32(const char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+inline uint64_t load64(const char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+inline void put_u32(unsigned char*& p, uint32_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24); p += 4; }
+inline uint32_t get_u32(const unsigned char*& p) { uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); p += 4; return v; }
+
+// Lengths of 15 and up continue in bytes of 255
+inline void put_length(std::string& o, size_t n) { while (n >= 255) { o.push_back((char)255); n -= 255; } o.push_back((char)n); }
+inline void put_varint(std::string& o, uint64_t v) { while (v >= 0x80) { o.push_back((char)(v | 0x80)); v >>= 7; } o.push_back((char)v); }
+
+void put_sequence(std::string& o, const char* lit, size_t lit_n, size_t offset, size_t match_n)
+{
+    const size_t m = match_n ? match_n - kMinMatch : 0;
+    o.push_back((char)((std::min<size_t>(lit_n, 15) << 4) | std::min<size_t>(m, 15)));
+    if (lit_n >= 15) put_length(o, lit_n - 15);
+    o.append(lit, lit_n);
+    if (!match_n) return;
+    put_varint(o, offset);
+    if (m >= 15) put_length(o, m - 15);
+}
+
+// Bytes at a and b that agree, up to limit
+inline size_t common_length(const char* a, const char* b, size_t limit)
+{
+    size_t n = 0;
+    while (n + 8 <= limit) {
+        const uint64_t x = load64(a + n) ^ load64(b + n);
+        if (x) return n + (size_t)(__builtin_ctzll(x) >> 3);
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) ++n;
+    return n;
+}
+
+// Bounds-checked reader over a compressed payload
+struct Reader {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+    size_t length(size_t n) {
+        if (n < 15) return n;
+        while (true) {
+            if (p == end) { ok = false; return 0; }
+            const unsigned char b = *p++; n += b;
+            if (b != 255) return n;
+        }
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) break;
+            const unsigned char b = *p++; v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false; return 0;
+    }
+};
+
+} // anonymous
+
+uint32_t lz_hash(const char* data, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ull ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) h = (h ^ load64(data + i)) * 0x100000001b3ull;
+    for (; i < n; ++i) h = (h ^ (unsigned char)data[i]) * 0x100000001b3ull;
+    const uint32_t v = (uint32_t)(h ^ (h >> 32));
+    return v ? v : 1;
+}
+
+bool lz_compress(const char* src, size_t n, const char* dict, size_t dict_n, std::string& out)
+{
+    // Matches search one window: the dictionary followed by the input
+    thread_local std::string window;
+    thread_local std::vector<uint32_t> table;
+    const char* base = src;
+    if (dict_n) { window.assign(dict, dict_n); window.append(src, n); base = window.data(); }
+    table.assign((size_t)1 << kHashBits, kNoPos);
+    for (size_t i = 0; i + kMinMatch <= dict_n; ++i) table[hash4(load32(base + i))] = (uint32_t)i;
+
+    const size_t start = out.size();
+    const size_t end = dict_n + n;
+    size_t ip = dict_n, anchor = dict_n;
+    while (ip + kMinMatch <= end && out.size() - start < n) {
+        uint32_t& slot = table[hash4(load32(base + ip))];
+        size_t ref = slot; slot = (uint32_t)ip;
+        if (ref == kNoPos || load32(base + ref) != load32(base + ip)) {
+            ip += 1 + ((ip - anchor) >> 6); // skip faster through incompressible runs
+            continue;
+        }
+        while (ip > anchor && ref > 0 && base[ip - 1] == base[ref - 1]) { --ip; --ref; }
+        const size_t len = kMinMatch + common_length(base + ref + kMinMatch, base + ip + kMinMatch, end - ip - kMinMatch);
+        put_sequence(out, base + anchor, ip - anchor, ip - ref, len);
+        ip += len; anchor = ip;
+        if (ip >= 2 && ip - 2 + kMinMatch <= end) table[hash4(load32(base + ip - 2))] = (uint32_t)(ip - 2);
+    }
+    if (anchor < end) put_sequence(out, base + anchor, end - anchor, 0, 0);
+    if (out.size() - start >= n) { out.resize(start); return false; }
+    return true;
+}
+
+bool lz_decompress(const char* src, size_t n, const char* dict, size_t dict_n, size_t raw_n, std::string& out)
+{
+    // A payload byte yields at most 255 output bytes (a length continuation),
+    // so a larger raw_n is malformed; refuse it before allocating
+    if (raw_n / 255 > n) return false;
+    out.resize(raw_n);
+    char* o = raw_n ? &out[0] : nullptr;
+    Reader rd{(const unsigned char*)src, (const unsigned char*)src + n};
+    size_t pos = 0;
+    while (pos < raw_n) {
+        if (rd.p == rd.end) return false;
+        const unsigned char token = *rd.p++;
+        const size_t lit = rd.length(token >> 4);
+        if (!rd.ok || lit > raw_n - pos || lit > (size_t)(rd.end - rd.p)) return false;
+        std::memcpy(o + pos, rd.p, lit); rd.p += lit; pos += lit;
+        if (pos == raw_n) break;
+        const uint64_t offset = rd.varint();
+        size_t len = rd.length(token & 15) + kMinMatch;
+        if (!rd.ok || offset == 0 || offset > pos + dict_n || len > raw_n - pos) return false;
+        if (offset > pos) {
+            // Starts in the dictionary; the rest continues from the output start
+            const size_t d = dict_n - (size_t)(offset - pos);
+            const size_t k = std::min(len, dict_n - d);
+            std::memcpy(o + pos, dict + d, k); pos += k; len -= k;
+        }
+        const char* from = o + pos - offset;
+        if (offset >= len) std::memcpy(o + pos, from, len);
+        else for (size_t i = 0; i < len; ++i) o[pos + i] = from[i]; // overlapping run
+        pos += len;
+    }
+    return rd.p == rd.end;
+}
+
+std::string build_compressed_frame(const std::string& raw, const std::string* dict)
+{
+    std::string o(kDeltaHeaderSize, '\0');
+    if (!lz_compress(raw.data(), raw.size(), dict ? dict->data() : nullptr, dict ? dict->size() : 0, o)) return std::string();
+    unsigned char* p = (unsigned char*)&o[0];
+    *p++ = kFrameMagic; *p++ = kStateFrameVersion; *p++ = kFrameKindCompressed; *p++ = 0;
+    put_u32(p, (uint32_t)(o.size() - kDeltaHeaderSize));
+    put_u32(p, (uint32_t)raw.size());
+    put_u32(p, lz_hash(raw.data(), raw.size()));
+    put_u32(p, dict ? lz_hash(dict->data(), dict->size()) : 0);
+    put_u32(p, dict ? (uint32_t)dict->size() : 0);
+    return o;
+}
+
+bool LzDecoder::decode(const char* data, size_t n, std::string& raw)
+{
+    if (n < kDeltaHeaderSize) return false;
+    const unsigned char* p = (const unsigned char*)data;
+    if (p[0] != kFrameMagic || p[1] != kStateFrameVersion || p[2] != kFrameKindCompressed) return false;
+    p += 4;
+    const uint32_t payload = get_u32(p), raw_n = get_u32(p), raw_hash = get_u32(p), dict_hash = get_u32(p), dict_n = get_u32(p);
+    if (n < kDeltaHeaderSize + payload) return false;
+    if (dict_hash && (dict_hash != dict_hash_ || dict_n != dict_.size())) return false; // dictionary frame was lost
+    if (!lz_decompress(data + kDeltaHeaderSize, payload, dict_.data(), dict_hash ? dict_.size() : 0, raw_n, raw)) return false;
+    if (lz_hash(raw.data(), raw.size()) != raw_hash) return false;
+    dict_ = raw; dict_hash_ = raw_hash;
+    return true;
+}
+
+} // namespace tcp_protocol
@@ -0,0 +1,63 @@
+// Compressed state frames: an in-tree LZ77 codec in the LZ4 mould (byte
+// aligned sequences, no entropy stage) for large state messages.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "stream_io/state_frame.h"
+
+namespace tcp_protocol {
+
+// Join capabilities asking for compressed state. kCapLzDict also lets the
+// engine use the previous compressed message as a dictionary. The joined
+// reply names the accepted one as "compression".
+constexpr const char* kCapLzState = "lz1";
+constexpr const char* kCapLzDict = "lz1dict";
+// State messages below this many bytes are sent as they are (join
+// "compress_min" overrides it)
+constexpr size_t kLzDefaultMinBytes = 16u << 10;
+
+// Compressed frame (kFrameKindCompressed, kDeltaHeaderSize-byte header,
+// little endian):
+//   u8 magic, u8 version, u8 kind, u8 flags (0), u32 payload bytes after the header,
+//   u32 raw bytes, u32 raw hash, u32 dictionary hash (0: none),
+//   u32 dictionary bytes, u64 reserved (0)
+// The raw message is a JSON state line or a frame of another kind. The
+// dictionary is the raw form of the previous compressed frame on the same
+// channel; hashes are lz_hash values.
+// Payload: sequences of
+//   u8 token (high nibble literal count, low nibble match length - 4; 15 is
+//   continued by bytes of 255 and a final byte below 255), the literals,
+//   varint match offset (bytes back from the current position; may reach into
+//   the dictionary), then the match length continuation.
+// The last sequence may stop after its literals, at raw bytes.
+
+// 32-bit content hash (never 0)
+uint32_t lz_hash(const char* data, size_t n);
+
+// Compress src as if it followed dict (dict_n may be 0) and append to out.
+// Returns false when the result would not be smaller than src.
+bool lz_compress(const char* src, size_t n, const char* dict, size_t dict_n, std::string& out);
+// Decompress exactly raw_n bytes into out. Returns false on malformed input.
+bool lz_decompress(const char* src, size_t n, const char* dict, size_t dict_n, size_t raw_n, std::string& out);
+
+// Frame raw as a compressed frame against dict (optional). Empty when
+// compression does not make it smaller.
+std::string build_compressed_frame(const std::string& raw, const std::string* dict);
+
+// Client side: decodes compressed frames of one channel, keeping the last
+// raw message as the next dictionary.
+class LzDecoder {
+public:
+    // Decode a complete compressed frame into raw. Returns false on a
+    // malformed frame, a hash mismatch or a dictionary that is not held.
+    bool decode(const char* data, size_t n, std::string& raw);
+
+private:
+    std::string dict_;
+    uint32_t dict_hash_ = 0;
+};
+
+} // namespace tcp_protocol
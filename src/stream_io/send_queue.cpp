@@ -0,0 +1,61 @@
+// Send queue bookkeeping shared by the server's network and fan-out threads.
+
+#include "stream_io/send_queue.h"
+
+namespace tcp_protocol {
+
+void SendQueue::supersede()
+{
+    // Newest first, so a kept message protects the one it was compressed
+    // against however far back that is
+    const std::string* needed = nullptr;
+    for (size_t i = msgs.size(); i-- > 0;) {
+        Pending& m = msgs[i];
+        const bool started = i == 0 && front_off > 0;
+        if (m.state && !started && !(m.raw && m.raw.get() == needed)) {
+            const size_t n = m.data->size();
+            bytes -= n; dropped_bytes += n; ++dropped_frames;
+            msgs.erase(msgs.begin() + (std::ptrdiff_t)i);
+            continue;
+        }
+        if (m.dict) needed = m.dict.get();
+    }
+}
+
+void SendQueue::push(std::shared_ptr<const std::string> data, bool state,
+                     std::shared_ptr<const std::string> raw, std::shared_ptr<const std::string> dict)
+{
+    if (state) supersede();
+    bytes += data->size();
+    msgs.push_back(Pending{std::move(data), state, std::move(raw), std::move(dict)});
+}
+
+const std::shared_ptr<const std::string>& SendQueue::lz_dictionary() const
+{
+    for (auto it = msgs.rbegin(); it != msgs.rend(); ++it) if (it->raw) return it->raw;
+    return lz_sent;
+}
+
+int SendQueue::fill(iovec* iov, int max) const
+{
+    int n = 0;
+    for (auto it = msgs.begin(); it != msgs.end() && n < max; ++it, ++n) {
+        const size_t off = (n == 0) ? front_off : 0;
+        iov[n].iov_base = (void*)(it->data->data() + off); iov[n].iov_len = it->data->size() - off;
+    }
+    return n;
+}
+
+void SendQueue::written(size_t n)
+{
+    bytes -= n;
+    while (n > 0) {
+        const size_t rest = msgs.front().data->size() - front_off;
+        if (n < rest) { front_off += n; break; }
+        n -= rest;
+        if (msgs.front().raw) lz_sent = std::move(msgs.front().raw);
+        msgs.pop_front(); front_off = 0;
+    }
+}
+
+} // namespace tcp_protocol
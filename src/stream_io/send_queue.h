@@ -0,0 +1,54 @@
+// Per-connection send queue of the engine server: replies are kept in order,
+// unsent state messages give way to newer ones, and compressed messages keep
+// the dictionary chain of lz_frame.h intact.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include <sys/uio.h>
+
+namespace tcp_protocol {
+
+// Encoded message waiting in a send queue; state snapshots may be dropped in
+// favour of a newer one, replies never are
+struct Pending {
+    std::shared_ptr<const std::string> data;
+    bool state = false;
+    std::shared_ptr<const std::string> raw;  // data is its compressed frame (lz_frame.h)
+    std::shared_ptr<const std::string> dict; // ... encoded against this raw message
+};
+
+struct SendQueue {
+    std::deque<Pending> msgs;
+    size_t front_off = 0;         // bytes of the front message already written
+    size_t bytes = 0;             // unsent bytes
+    uint64_t dropped_bytes = 0;   // superseded state messages never sent
+    uint64_t dropped_frames = 0;
+    // Raw form of the last compressed message fully written
+    std::shared_ptr<const std::string> lz_sent;
+
+    bool empty() const { return msgs.empty(); }
+
+    // Drop queued state messages the socket has not started on, except those
+    // a later queued message was compressed against: the client must decode
+    // them first to hold the dictionary.
+    void supersede();
+    // Queue a message. A state message supersedes queued ones first; call
+    // supersede() before lz_dictionary() when compressing one.
+    void push(std::shared_ptr<const std::string> data, bool state,
+              std::shared_ptr<const std::string> raw = nullptr, std::shared_ptr<const std::string> dict = nullptr);
+    // Dictionary for the next compressed message: the raw form of the newest
+    // compressed one the client will receive (queued, or else written)
+    const std::shared_ptr<const std::string>& lz_dictionary() const;
+
+    // Point up to max iovecs at the unsent bytes; returns how many
+    int fill(iovec* iov, int max) const;
+    // Account for n bytes the socket took
+    void written(size_t n);
+};
+
+} // namespace tcp_protocol
@@ -1,171 +1,1224 @@
 #include "stream_io/server.h"
 
 #include "stream_io/tcp_protocol.h"
+#include "stream_io/lockfree_queue.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/delta_frame.h"
+#include "stream_io/interest.h"
+#include "stream_io/line_framer.h"
+#include "stream_io/udp_state.h"
+#include "stream_io/shm_snapshot.h"
+#include "stream_io/lz_frame.h"
+#include "stream_io/send_queue.h"
 #include "engine/command.h"
 
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
 #include <set>
+#include <thread>
+#include <unordered_map>
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 namespace {
 
+// State encodings a connection can receive. Delta clients get per-client
+// keyframe/delta frames instead of the shared broadcast.
+enum StateFormat : uint8_t { kFormatJson = 0, kFormatBinary = 1, kFormatDelta = 2, kFormatCount };
+// Network-side broadcast group of clients that only get per-client state
+// (delta and area-of-interest sessions)
+static constexpr uint8_t kGroupNone = kFormatCount;
+
+// Backlog of replies a client may leave unread before it is disconnected
+// (state frames never pile up: only the newest unsent one is kept)
+static constexpr size_t kMaxClientBacklog = 8u << 20;
+// Longest client line accepted; longer ones are dropped with an error reply
+static constexpr size_t kMaxClientLine = 1u << 20;
+// Messages handed to one sendmsg call (datagrams to one sendmmsg call)
+static constexpr int kMaxIov = 64;
+
+// Network-thread view of a connection
 struct Client {
+    uint64_t id = 0;
     int fd = -1;
-    std::string buf;
+    uint32_t world = 0;           // hosted world its events go to (chosen at join)
+    LineFramer in{kMaxClientLine};
+    uint8_t format = kFormatJson; // which broadcast snapshots it receives (kGroupNone: none)
+    tcp_protocol::SendQueue out;
+    uint64_t sent_bytes = 0;
+    bool dirty = false;           // queued to this pass; flushed after the batch
+    // UDP state channel: token granted at join, address learned from the
+    // client's hello; state frames bypass the send queue once it is known
+    uint64_t udp_token = 0;
+    bool udp_ready = false;
+    sockaddr_in udp_addr{};
+    uint32_t udp_seq = 0;
+    uint64_t udp_frames = 0;
+    // Compressed state (granted at join): messages of at least lz_min bytes,
+    // against the previous compressed one with lz_dict
+    size_t lz_min = 0;            // 0: off
+    bool lz_dict = false;
+    uint64_t lz_raw_bytes = 0;    // state bytes before and after compression
+    uint64_t lz_bytes = 0;
+};
+
+// Simulation-thread view of a connection: turn scheduling and team claim
+struct Session {
     double next_turn_time = 0.0; // when <= sim_time, client has turn
     int team = -1;
+    uint8_t format = kFormatJson; // negotiated at join
+    tcp_protocol::InterestHint hint; // area of interest: team from join, camera from view
+    bool shm = false;             // reads full-world state from shared memory; nothing streamed
+    // State pacing asked for at join: at most one state per period and
+    // max_bps bytes per second (token bucket, one second of burst), wall time
+    double state_period = 0.0;
+    double max_bps = 0.0;
+    double next_state = 0.0;
+    double byte_credit = 0.0;
+    double credit_time = 0.0;
+    bool paced() const { return state_period > 0.0 || max_bps > 0.0; }
+    // kFormatDelta: the last acknowledged frame (delta baseline), frames sent
+    // since then awaiting an ack (oldest first), and the last keyframe's seq
+    bool has_base = false;
+    tcp_protocol::StateSnapshot base;
+    std::deque<tcp_protocol::StateSnapshot> sent;
+    uint32_t last_key = 0;
+    // Resume: token granted at a player join, and the commands acked since
+    // the world's last end of turn (still queued, reported on resume)
+    uint64_t resume_token = 0;
+    std::vector<std::string> pending_cmds;
 };
 
-static inline void send_line(int fd, const std::string& s) { (void)::send(fd, s.c_str(), s.size(), 0); }
+// Longest spectator delay; the fan-out thread keeps this much history
+static constexpr double kMaxSpectatorDelay = 60.0;
+// Fan-out wakeup interval while delayed or rate-limited spectators wait
+static constexpr int kFanoutPollMs = 5;
 
-static void remove_client(std::vector<Client>& cs, int fd) {
-    cs.erase(std::remove_if(cs.begin(), cs.end(), [&](const Client& c){ return c.fd == fd; }), cs.end());
-}
+// Fan-out thread view of a spectator: the connection handed over by the
+// network thread after its join, with its delay and rate
+struct Spectator {
+    Client client;
+    double delay = 0.0;
+    double period = 0.0;    // seconds between states (0: every broadcast)
+    double next_send = 0.0;
+    uint64_t last_frame = 0;
+};
 
-} // anonymous
+// Broadcast state for spectators, encoded once by the sim thread
+struct FanoutFrame {
+    uint32_t world = 0;
+    uint8_t format = kFormatJson;
+    std::shared_ptr<const std::string> data;
+};
+
+// Network -> simulation
+struct SimEvent {
+    enum Kind : uint8_t { Connect, Disconnect, Message } kind = Message;
+    uint32_t world = 0;
+    uint64_t client = 0;
+    tcp_protocol::ClientMsg msg;
+    double t_recv = 0.0; // trace_clock() when a traced message was parsed
+    bool dropped = false; // Disconnect: the connection closed (not moved to another world)
+};
+
+// Simulation -> network: an immutable encoded line or frame for one client,
+// or for every client of the world using format when broadcast
+static constexpr uint64_t kBroadcast = 0;
+struct Outbound {
+    uint32_t world = 0;     // sender; lines for a client that moved on are dropped
+    uint64_t client = kBroadcast;
+    uint8_t format = kFormatJson;
+    int8_t set_format = -1; // >= 0: switch the client's broadcast group before sending
+    bool state = false;     // snapshot (droppable when the client is behind) rather than a reply
+    bool compress = false;  // state content, compressed for clients that asked for it
+    bool set_udp = false;   // replace the client's UDP token (0 revokes the channel)
+    uint64_t udp_token = 0;
+    bool set_lz = false;    // replace the client's compression settings
+    uint32_t lz_min = 0;    // set_lz: 0 turns compression off
+    bool lz_dict = false;
+    bool spectate = false;  // hand the connection to the fan-out thread after line
+    double delay = 0.0, rate = 0.0; // spectate: seconds behind live, states per second
+    std::shared_ptr<const std::string> line; // null: only apply set_format/set_udp
+};
+
+// Queues between the network thread and one sim worker, which drives every
+// world w with w % workers == its index
+struct Shard {
+    MpscQueue<SimEvent> events;   // parsed client messages, connects, disconnects
+    SpscRing<Outbound> out{4096}; // replies and snapshots, in send order
+    SpscRing<FanoutFrame> fanout{256}; // broadcasts for spectators
+    int sim_wake = -1;            // eventfd: events queued or stop requested
+    bool wake_net = false;        // worker only: outbound queued this pass
+};
+
+// State shared by the server threads
+struct Shared {
+    std::vector<std::unique_ptr<Shard>> shards;
+    uint32_t worlds = 1;
+    Shard& shard_of(uint32_t world) { return *shards[world % shards.size()]; }
+    int net_wake = -1;            // eventfd: outbound queued or stop requested
+    bool udp = false;             // UDP state socket bound (fixed before the sim threads start)
+    double resume_grace = 0.0;    // seconds a dropped player's session is held (<= 0: not held)
+    // Spectators: connections handed to the fan-out thread and how many
+    // watch each world and format (world * kFormatCount + format; read by
+    // the sim workers)
+    MpscQueue<Spectator> handoff;
+    int fan_wake = -1;            // eventfd: handoff or frames queued, or stop requested
+    std::unique_ptr<std::atomic<uint32_t>[]> spectators;
+    std::atomic<bool> stop{false};
+    // Network thread counters, read by the sim thread for tick_status
+    std::atomic<uint64_t> net_queued_bytes{0};
+    std::atomic<uint64_t> net_dropped_bytes{0};
+    std::atomic<uint64_t> net_dropped_frames{0};
+};
+
+// epoll tags for the network thread's non-client fds (client ids start at 1)
+static constexpr uint64_t kTagListener = UINT64_MAX;
+static constexpr uint64_t kTagWake = UINT64_MAX - 1;
+static constexpr uint64_t kTagUdp = UINT64_MAX - 2;
 
-void run_engine_server(int port, double min_time_step, const ServerCallbacks& cb)
+// Write as much of the queue as the socket takes, coalescing messages into
+// one sendmsg. Returns false when the connection failed.
+static bool flush(Client& c)
 {
-    int srv = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (srv < 0) { std::perror("socket"); return; }
-    int yes = 1; setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); addr.sin_port = htons((uint16_t)port);
-    if (bind(srv, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("bind"); ::close(srv); return; }
-    if (listen(srv, 8) < 0) { std::perror("listen"); ::close(srv); return; }
-    int flags = fcntl(srv, F_GETFL, 0); if (flags >= 0) fcntl(srv, F_SETFL, flags | O_NONBLOCK);
-    std::fprintf(stderr, "[engine] listening on 127.0.0.1:%d\n", port);
+    while (!c.out.empty()) {
+        iovec iov[kMaxIov];
+        msghdr m{}; m.msg_iov = iov; m.msg_iovlen = (size_t)c.out.fill(iov, kMaxIov);
+        ssize_t w = ::sendmsg(c.fd, &m, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK; // EPOLLOUT resumes
+        }
+        c.sent_bytes += (uint64_t)w;
+        c.out.written((size_t)w);
+    }
+    return true;
+}
+
+// Send a state frame to a client's UDP address as one datagram per fragment.
+// A full socket buffer loses the frame like the network would; returns false
+// only when the frame is too large for the channel (send it over TCP).
+static bool send_udp(int ufd, Client& c, const std::string& frame)
+{
+    const size_t count = tcp_protocol::udp_fragment_count(frame.size());
+    if (count > tcp_protocol::kUdpMaxFragments) return false;
+    const uint32_t seq = ++c.udp_seq;
+    unsigned char hdr[kMaxIov][tcp_protocol::kUdpHeaderSize];
+    iovec iov[kMaxIov][2];
+    mmsghdr msgs[kMaxIov];
+    size_t k = 0;
+    while (k < count) {
+        const size_t n = std::min((size_t)kMaxIov, count - k);
+        for (size_t i = 0; i < n; ++i) {
+            const size_t off = (k + i) * tcp_protocol::kUdpFragmentPayload;
+            tcp_protocol::write_udp_header(hdr[i], tcp_protocol::kUdpKindState, (uint16_t)(k + i), (uint16_t)count, seq);
+            iov[i][0].iov_base = hdr[i]; iov[i][0].iov_len = tcp_protocol::kUdpHeaderSize;
+            iov[i][1].iov_base = (void*)(frame.data() + off); iov[i][1].iov_len = std::min(tcp_protocol::kUdpFragmentPayload, frame.size() - off);
+            msgs[i] = mmsghdr{};
+            msgs[i].msg_hdr.msg_name = &c.udp_addr; msgs[i].msg_hdr.msg_namelen = sizeof(c.udp_addr);
+            msgs[i].msg_hdr.msg_iov = iov[i]; msgs[i].msg_hdr.msg_iovlen = 2;
+        }
+        int w = ::sendmmsg(ufd, msgs, (unsigned)n, 0);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) { c.out.dropped_bytes += frame.size(); ++c.out.dropped_frames; return true; }
+        k += (size_t)w;
+    }
+    c.sent_bytes += frame.size(); ++c.udp_frames;
+    return true;
+}
+
+static inline void signal_fd(int fd) { uint64_t one = 1; (void)!::write(fd, &one, sizeof(one)); }
+static inline void drain_fd(int fd) { uint64_t v; while (::read(fd, &v, sizeof(v)) > 0) {} }
+
+// Wakeup eventfd of the running server loop (-1 when none) and its stop flag
+static std::atomic<int> g_wake_fd{-1};
+static std::atomic<bool> g_stop{false};
+
+// Arm the tick timer with the given period, or disarm it with period <= 0.
+static void arm_timer(int tfd, double period) {
+    itimerspec its{};
+    if (period > 0.0) {
+        its.it_interval.tv_sec = (time_t)period;
+        its.it_interval.tv_nsec = (long)((period - (double)its.it_interval.tv_sec) * 1e9);
+        if (its.it_interval.tv_sec == 0 && its.it_interval.tv_nsec == 0) its.it_interval.tv_nsec = 1;
+        its.it_value = its.it_interval;
+    }
+    timerfd_settime(tfd, 0, &its, nullptr);
+}
+
+// One hosted world: its sessions, turn scheduling and tick timing. Driven
+// by a sim worker thread (every ServerCallbacks call of the world happens
+// there); never touches a socket.
+class SimWorld {
+public:
+    SimWorld(Shared& sh, const ServerCallbacks& cb, uint32_t world, double dt, const TickConfig& tick_cfg)
+        : sh(sh), shard(sh.shard_of(world)), cb(cb), world(world), dt(dt), sched(dt, tick_cfg)
+    {
+        if (cb.get_required_teams) { auto v = cb.get_required_teams(); required_teams.insert(v.begin(), v.end()); }
+        initial_wait = !required_teams.empty();
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tfd < 0) std::perror("timerfd_create");
+    }
+
+    ~SimWorld()
+    {
+        if (tfd >= 0) ::close(tfd);
+        const TickScheduler::Stats& st = sched.stats();
+        std::fprintf(stderr, "[engine] world %u: ticks=%llu steps=%llu jitter avg=%.3fms max=%.3fms overruns catchup=%llu work=%llu (max %.3fms) dropped_sim=%.3fs dropped_snapshots=%llu\n",
+                     world, (unsigned long long)st.ticks, (unsigned long long)st.steps,
+                     st.jitter_samples ? 1e3 * st.jitter_sum / (double)st.jitter_samples : 0.0, 1e3 * st.jitter_max,
+                     (unsigned long long)st.catchup_overruns, (unsigned long long)st.work_overruns, 1e3 * st.max_work,
+                     st.dropped_sim_time, (unsigned long long)dropped_snapshots);
+    }
+
+    SimWorld(const SimWorld&) = delete;
+    SimWorld& operator=(const SimWorld&) = delete;
+
+    int timer_fd() const { return tfd; }
+
+private:
+    Shared& sh;
+    Shard& shard;
+    const ServerCallbacks& cb;
+    const uint32_t world;
+    const double dt;
 
-    std::vector<Client> clients;
+    std::unordered_map<uint64_t, Session> sessions;
     std::set<int> required_teams;
-    if (cb.get_required_teams) { auto v = cb.get_required_teams(); required_teams.insert(v.begin(), v.end()); }
-    bool initial_wait = !required_teams.empty();
+    bool initial_wait = false;
     std::set<int> claimed_teams;
     double sim_time = 0.0;
-    const double dt = (min_time_step > 0.0 ? min_time_step : (1.0/64.0));
+    uint64_t tick_count = 0; // steps taken; with sim_time, stamps every state
+    tcp_protocol::StateStamp stamp() const { tcp_protocol::StateStamp st; st.tick = tick_count; st.sim_time = sim_time; return st; }
 
-    while (true) {
-        // Build fd set
-        fd_set rfds; FD_ZERO(&rfds);
-        FD_SET(srv, &rfds);
-        int maxfd = srv;
-        for (const auto& c : clients) { FD_SET(c.fd, &rfds); if (c.fd > maxfd) maxfd = c.fd; }
-        timeval tv{0, 1000 * 10}; // 10ms
-        int rv = select(maxfd + 1, &rfds, nullptr, nullptr, &tv);
-        if (rv < 0) { if (errno == EINTR) continue; std::perror("select"); break; }
-
-        // Accept new clients
-        if (FD_ISSET(srv, &rfds)) {
-            sockaddr_in cli{}; socklen_t len = sizeof(cli);
-            int fd = ::accept(srv, (sockaddr*)&cli, &len);
-            if (fd >= 0) {
-                int fl = fcntl(fd, F_GETFL, 0); if (fl >= 0) fcntl(fd, F_SETFL, fl | O_NONBLOCK);
-                Client c; c.fd = fd; c.next_turn_time = sim_time; // has turn immediately when joining
-                clients.push_back(std::move(c));
-                std::fprintf(stderr, "[engine] client connected (fd=%d)\n", fd);
-                // send initial snapshot
-                if (cb.build_state_json) { std::string st = cb.build_state_json(false); send_line(fd, st); }
-            }
-        }
-
-        // Read from clients
-        for (size_t i = 0; i < clients.size(); ++i) {
-            int fd = clients[i].fd;
-            if (!FD_ISSET(fd, &rfds)) continue;
-            char tmp[4096];
-            while (true) {
-                ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
-                if (n > 0) { clients[i].buf.append(tmp, tmp + n); continue; }
-                if (n == 0) { ::close(fd); clients[i].fd = -1; break; }
-                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-                ::close(fd); clients[i].fd = -1; break;
-            }
-            if (clients[i].fd < 0) continue;
-            size_t pos;
-            while ((pos = clients[i].buf.find('\n')) != std::string::npos) {
-                std::string line = clients[i].buf.substr(0, pos);
-                clients[i].buf.erase(0, pos + 1);
-                if (line.empty()) continue;
-                tcp_protocol::ClientMsg msg; std::string perr;
-                if (!tcp_protocol::parse_client_message(line, msg, &perr)) { send_line(fd, tcp_protocol::build_reply("error", perr.c_str())); continue; }
-                using tcp_protocol::ClientMsgType;
-                if (msg.type == ClientMsgType::Join) {
-                    // Enforce unique team claim if provided
-                    if (msg.team >= 0) {
-                        bool taken = false; for (const auto& c2 : clients) if (c2.fd >= 0 && c2.team == msg.team) { taken = true; break; }
-                        if (taken) { send_line(fd, tcp_protocol::build_reply("error", "team taken")); continue; }
-                        clients[i].team = msg.team; claimed_teams.insert(msg.team);
-                    }
-                    // Compute defs hash match
-                    const char* dh = nullptr; bool match=false; const bool* mp=nullptr; std::string defs_hash;
-                    if (cb.get_defs_hash) { defs_hash = cb.get_defs_hash(); dh = defs_hash.c_str(); }
-                    if (dh && !msg.defs_hash.empty()) { match = (defs_hash == msg.defs_hash); mp = &match; }
-                    send_line(fd, tcp_protocol::build_joined_reply(dh?defs_hash:"", mp));
-                } else if (msg.type == ClientMsgType::StateReq) {
-                    bool all = false; if (!msg.scope.empty()) { all = (msg.scope == "all" || msg.scope == "ALL"); }
-                    if (cb.build_state_json) { std::string sline = cb.build_state_json(all); send_line(fd, sline); }
-                } else if (msg.type == ClientMsgType::Cmd) {
-                    const auto& cc = msg.cmd; Command c; uint64_t uid = cc.uid;
-                    if (cc.name == "THROTTLE") {
-                        c.type = Command::Type::THROTTLE; c.uid = uid; c.a = cc.value; if (cb.find_ship_by_uid) c.ship = cb.find_ship_by_uid(uid); if (!c.ship) { send_line(fd, tcp_protocol::build_reply("error", "unknown uid")); continue; } if (cb.queue_command) cb.queue_command(c); send_line(fd, tcp_protocol::build_reply("ack", "THROTTLE"));
-                    } else if (cc.name == "HEADING") {
-                        c.type = Command::Type::HEADING; c.uid = uid; c.a = cc.theta; if (cb.find_ship_by_uid) c.ship = cb.find_ship_by_uid(uid); if (!c.ship) { send_line(fd, tcp_protocol::build_reply("error", "unknown uid")); continue; } if (cb.queue_command) cb.queue_command(c); send_line(fd, tcp_protocol::build_reply("ack", "HEADING"));
-                    } else if (cc.name == "FIRE") {
-                        c.type = Command::Type::FIRE; c.uid = uid; c.a = cc.theta; if (cb.find_ship_by_uid) { c.ship = cb.find_ship_by_uid(uid); if (c.ship) c.key = pick_projectile_key(*c.ship); } if (!c.ship) { send_line(fd, tcp_protocol::build_reply("error", "unknown uid")); continue; } if (cb.queue_command) cb.queue_command(c); send_line(fd, tcp_protocol::build_reply("ack", "FIRE"));
-                    } else {
-                        send_line(fd, tcp_protocol::build_reply("error", "unknown cmd"));
-                    }
-                } else if (msg.type == ClientMsgType::EndTurn) {
-                    if (cb.apply_queued_commands) cb.apply_queued_commands();
-                    if (cb.end_of_turn_cleanup) cb.end_of_turn_cleanup();
-                    if (cb.rebuild_uid_map) cb.rebuild_uid_map();
-                    // Schedule client's next turn
-                    clients[i].next_turn_time = (msg.wait > 0.0 ? sim_time + msg.wait : sim_time);
-                } else {
-                    send_line(fd, tcp_protocol::build_reply("error", "unknown type"));
+    int tfd = -1;
+    bool ticking = false; // tick timer armed
+    TickScheduler sched;
+    uint64_t dropped_snapshots = 0;
+    std::mt19937_64 token_rng{std::random_device{}()};
+    using clock = std::chrono::steady_clock;
+    const clock::time_point t0 = clock::now();
+    double wall_now() const { return std::chrono::duration<double>(clock::now() - t0).count(); }
+
+    // Replies are never dropped: wait for the network thread to make room
+    void push_reply(Outbound o) {
+        o.world = world;
+        while (!shard.out.try_push(o)) {
+            if (sh.stop.load()) return;
+            signal_fd(sh.net_wake);
+            std::this_thread::yield();
+        }
+        shard.wake_net = true;
+    }
+    void reply(uint64_t client, std::string line, int set_format = -1) {
+        Outbound o; o.client = client; o.set_format = (int8_t)set_format; o.line = std::make_shared<const std::string>(std::move(line));
+        push_reply(o);
+    }
+    // State sent as a reply (never dropped, but compressible)
+    void reply_state(uint64_t client, std::string line) {
+        Outbound o; o.client = client; o.compress = true; o.line = std::make_shared<const std::string>(std::move(line));
+        push_reply(o);
+    }
+    // Snapshots are dropped when the ring is full; the next one supersedes them
+    void push_snapshot(uint64_t client, uint8_t format, std::shared_ptr<const std::string> line) {
+        Outbound o; o.world = world; o.client = client; o.format = format; o.state = true; o.compress = true; o.line = std::move(line);
+        if (shard.out.try_push(std::move(o))) shard.wake_net = true; else ++dropped_snapshots;
+    }
+
+    // Sessions of dropped connections held by resume token until expires
+    // (wall time): their team stays claimed and a join with the token takes
+    // them over. They hold no turn meanwhile, so the world runs on.
+    struct Parked { Session s; uint64_t client; double expires; };
+    std::unordered_map<uint64_t, Parked> parked;
+    bool team_taken(int team) const {
+        for (const auto& kv : sessions) if (kv.second.team == team) return true;
+        for (const auto& kv : parked) if (kv.second.s.team == team) return true;
+        return false;
+    }
+    void expire_parked(double now) {
+        for (auto it = parked.begin(); it != parked.end(); ) {
+            if (it->second.expires > now) { ++it; continue; }
+            if (it->second.s.team >= 0) std::fprintf(stderr, "[engine] world %u: released team %d (not resumed in %.0fs)\n", world, it->second.s.team, sh.resume_grace);
+            it = parked.erase(it);
+        }
+    }
+
+    // A keyframe (or full state frame) right away for a resumed session, so
+    // it catches up without waiting for the next broadcast
+    void send_catchup(uint64_t client, Session& s) {
+        const tcp_protocol::StateStamp st = stamp();
+        const bool filtered = aoi && s.hint.filtered();
+        tcp_protocol::InterestSelection sel;
+        if (filtered) { cb.update_interest(); cb.select_interest(s.hint, false, sel); }
+        if (s.format == kFormatDelta) {
+            ++frame_seq; if (frame_seq == 0) frame_seq = 1;
+            if (filtered) tcp_protocol::collect_ship_records(sel, cur_ships); else cb.collect_ship_records(cur_ships);
+            tcp_protocol::cap_frame_ships(cur_ships);
+            tcp_protocol::StateSnapshot snap; snap.seq = frame_seq; snap.sim_time = sim_time;
+            snap.ships = std::make_shared<const std::vector<tcp_protocol::ShipRecord>>(cur_ships);
+            reply_state(client, tcp_protocol::build_keyframe(frame_seq, sim_time, *snap.ships, filtered ? &sel.summaries : nullptr, &st));
+            s.sent.push_back(std::move(snap)); s.last_key = frame_seq;
+        } else if (s.format == kFormatBinary && !s.shm) {
+            reply_state(client, filtered ? tcp_protocol::build_state_frame(sel, &st) : cb.build_state_frame(false, &st));
+        }
+        // JSON sessions already have the snapshot sent at connect
+    }
+
+    // Traced commands: queued ones wait for an end of turn to apply them,
+    // applied ones for the next broadcast, after which the trace is replied
+    struct PendingTrace { uint64_t client; tcp_protocol::CmdTrace tr; };
+    std::vector<PendingTrace> traces_queued, traces_applied;
+    void reply_traces() {
+        const double now = tcp_protocol::trace_clock();
+        for (auto& p : traces_applied) {
+            p.tr.t_broadcast = now; p.tr.broadcast_tick = tick_count;
+            reply(p.client, tcp_protocol::build_trace(p.tr));
+        }
+        traces_applied.clear();
+    }
+
+    // Area-of-interest filtering is on when the engine provides the index.
+    // Clients that claimed a team or sent a view message then get only their
+    // area of interest plus region summaries instead of the shared broadcast
+    const bool aoi = cb.update_interest && cb.select_interest;
+    const std::string defs_hash = cb.get_defs_hash ? cb.get_defs_hash() : std::string();
+    uint8_t group_of(const Session& s) {
+        return (s.shm || s.format == kFormatDelta || s.paced() || (aoi && s.hint.filtered())) ? kGroupNone : s.format;
+    }
+    // Paced sessions skip broadcasts until their next state is due; the one
+    // they get then is the newest, so skipped steps are coalesced
+    bool state_due(Session& s, double now) {
+        if (!s.paced()) return true;
+        if (s.max_bps > 0.0) {
+            s.byte_credit = std::min(s.byte_credit + (now - s.credit_time) * s.max_bps, s.max_bps);
+            s.credit_time = now;
+            if (s.byte_credit < 0.0) return false;
+        }
+        return s.state_period <= 0.0 || now >= s.next_state;
+    }
+    void charge_state(Session& s, double now, size_t bytes) {
+        if (s.max_bps > 0.0) s.byte_credit -= (double)bytes;
+        if (s.state_period > 0.0) s.next_state = (s.next_state + s.state_period > now) ? s.next_state + s.state_period : now + s.state_period;
+    }
+    // Shared-memory snapshots for local clients, created on the first request
+    tcp_protocol::ShmSnapshotWriter shm;
+    bool shm_failed = false;
+
+    // Selections of the current broadcast, one per distinct hint, with their
+    // encodings built on first use (deque: references stay valid on growth)
+    struct AoiView {
+        tcp_protocol::InterestHint hint;
+        tcp_protocol::InterestSelection sel;
+        std::shared_ptr<const std::string> line[kFormatCount];
+        std::shared_ptr<const std::vector<tcp_protocol::ShipRecord>> ships;
+    };
+    std::deque<AoiView> aoi_views;
+    std::string json_buf; // reused scratch for per-client JSON lines
+    AoiView& aoi_view(const tcp_protocol::InterestHint& h) {
+        for (auto& v : aoi_views) if (v.hint == h) return v;
+        aoi_views.emplace_back(); AoiView& v = aoi_views.back();
+        v.hint = h; cb.select_interest(h, false, v.sel);
+        return v;
+    }
+
+    // Keyframe/delta frames for every kFormatDelta session. Ship lists are
+    // collected once per selection; clients on the same baseline and selection
+    // share one encoding.
+    uint32_t frame_seq = 0;
+    std::vector<tcp_protocol::ShipRecord> cur_ships;
+    void send_delta_frames() {
+        using Ships = std::shared_ptr<const std::vector<tcp_protocol::ShipRecord>>;
+        ++frame_seq; if (frame_seq == 0) frame_seq = 1; // 0 marks "no baseline"
+        Ships all_ships;
+        std::map<const void*, std::shared_ptr<const std::string>> keyframes;
+        std::map<std::pair<const void*, const void*>, std::pair<std::shared_ptr<const std::string>, Ships>> deltas;
+        const double now = wall_now();
+        const tcp_protocol::StateStamp st = stamp();
+        for (auto& kv : sessions) {
+            Session& s = kv.second;
+            if (s.format != kFormatDelta || !state_due(s, now)) continue;
+            Ships cur; const std::vector<tcp_protocol::RegionSummary>* summaries = nullptr;
+            if (aoi && s.hint.filtered()) {
+                AoiView& v = aoi_view(s.hint);
+                if (!v.ships) { tcp_protocol::collect_ship_records(v.sel, cur_ships); tcp_protocol::cap_frame_ships(cur_ships); v.ships = std::make_shared<const std::vector<tcp_protocol::ShipRecord>>(cur_ships); }
+                cur = v.ships; summaries = &v.sel.summaries;
+            } else {
+                if (!all_ships) { cb.collect_ship_records(cur_ships); tcp_protocol::cap_frame_ships(cur_ships); all_ships = std::make_shared<const std::vector<tcp_protocol::ShipRecord>>(cur_ships); }
+                cur = all_ships;
+            }
+            tcp_protocol::StateSnapshot snap; snap.seq = frame_seq; snap.sim_time = sim_time;
+            std::shared_ptr<const std::string> line;
+            if (!s.has_base || frame_seq - s.last_key >= tcp_protocol::kKeyframeInterval) {
+                auto& k = keyframes[cur.get()];
+                if (!k) k = std::make_shared<const std::string>(tcp_protocol::build_keyframe(frame_seq, sim_time, *cur, summaries, &st));
+                line = k; snap.ships = cur; s.last_key = frame_seq;
+            } else {
+                auto& d = deltas[std::make_pair((const void*)s.base.ships.get(), (const void*)cur.get())];
+                if (!d.first) {
+                    std::vector<tcp_protocol::ShipRecord> recon;
+                    d.first = std::make_shared<const std::string>(tcp_protocol::build_delta_frame(frame_seq, sim_time, s.base, *cur, recon, summaries, &st));
+                    d.second = std::make_shared<const std::vector<tcp_protocol::ShipRecord>>(std::move(recon));
                 }
+                line = d.first; snap.ships = d.second;
             }
+            // Unacked history is bounded: acks of frames dropped here are
+            // ignored, but deltas go on against the newest acked baseline
+            // (the client's decoder keeps the baseline it was last sent)
+            s.sent.push_back(std::move(snap));
+            if (s.sent.size() > tcp_protocol::kDeltaHistory) s.sent.pop_front();
+            charge_state(s, now, line->size());
+            push_snapshot(kv.first, kFormatDelta, std::move(line));
         }
+    }
 
-        // Drop disconnected clients
-        clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& c){ return c.fd < 0; }), clients.end());
+    // One snapshot per wakeup: the shared broadcast encoded once per format
+    // in use, then per-client state for filtered and delta sessions
+    void broadcast_state() {
+        if (aoi) { cb.update_interest(); aoi_views.clear(); }
+        bool used[kFormatCount] = {}; bool any_delta = false, any_shm = false;
+        for (const auto& kv : sessions) {
+            const uint8_t g = group_of(kv.second);
+            if (g != kGroupNone) used[g] = true;
+            if (kv.second.format == kFormatDelta) any_delta = true;
+            if (kv.second.shm) any_shm = true;
+        }
+        // Full-world encodings, shared by the broadcast, shm and spectators
+        const tcp_protocol::StateStamp st = stamp();
+        std::shared_ptr<const std::string> frame, json;
+        auto full = [&](int f) -> std::shared_ptr<const std::string>& {
+            auto& line = (f == kFormatBinary) ? frame : json;
+            if (!line) line = std::make_shared<const std::string>(f == kFormatBinary ? cb.build_state_frame(false, &st) : cb.build_state_json(false, &st));
+            return line;
+        };
+        for (int f = 0; f < kFormatCount; ++f) {
+            if (!used[f]) continue;
+            if (f == kFormatBinary || cb.build_state_json) push_snapshot(kBroadcast, (uint8_t)f, full(f));
+        }
+        if (any_shm) { const auto& line = full(kFormatBinary); shm.publish(line->data(), line->size()); }
+        bool fan = false;
+        for (int f : {kFormatJson, kFormatBinary}) {
+            if (sh.spectators[world * kFormatCount + f].load(std::memory_order_relaxed) == 0 || (f == kFormatJson && !cb.build_state_json)) continue;
+            if (shard.fanout.try_push(FanoutFrame{world, (uint8_t)f, full(f)})) fan = true; else ++dropped_snapshots;
+        }
+        if (fan) signal_fd(sh.fan_wake);
+        // Per-client state: filtered sessions get their area of interest,
+        // paced ones the shared full-world encoding once due
+        const double now = wall_now();
+        for (auto& kv : sessions) {
+            Session& s = kv.second;
+            if (s.shm || s.format == kFormatDelta) continue;
+            const bool filtered = aoi && s.hint.filtered();
+            if (!filtered && (!s.paced() || (s.format == kFormatJson && !cb.build_state_json))) continue;
+            if (!state_due(s, now)) continue;
+            std::shared_ptr<const std::string> line;
+            if (filtered) {
+                AoiView& v = aoi_view(s.hint);
+                auto& sel_line = v.line[s.format];
+                if (!sel_line && s.format == kFormatBinary) sel_line = std::make_shared<const std::string>(tcp_protocol::build_state_frame(v.sel, &st));
+                if (!sel_line) { json_buf.clear(); tcp_protocol::write_state_json(json_buf, v.sel, defs_hash, &st); sel_line = std::make_shared<const std::string>(json_buf); }
+                line = sel_line;
+            } else line = full(s.format);
+            charge_state(s, now, line->size());
+            push_snapshot(kv.first, s.format, std::move(line));
+        }
+        if (any_delta) send_delta_frames();
+    }
 
+public:
+    void handle(SimEvent& ev) {
+        const uint64_t id = ev.client;
+        if (ev.kind == SimEvent::Connect) {
+            Session s; s.next_turn_time = sim_time; // has turn immediately when joining
+            sessions[id] = s;
+            // send initial snapshot
+            const tcp_protocol::StateStamp st = stamp();
+            if (cb.build_state_json) reply(id, cb.build_state_json(false, &st));
+            return;
+        }
+        if (ev.kind == SimEvent::Disconnect) {
+            auto it = sessions.find(id);
+            // Only a team or queued commands are worth holding
+            if (it != sessions.end() && ev.dropped && it->second.resume_token && sh.resume_grace > 0.0
+                && (it->second.team >= 0 || !it->second.pending_cmds.empty())) {
+                Session& s = it->second;
+                s.has_base = false; s.sent.clear(); s.base = tcp_protocol::StateSnapshot();
+                const uint64_t token = s.resume_token; const int team = s.team;
+                parked[token] = Parked{std::move(s), id, wall_now() + sh.resume_grace};
+                if (team >= 0) std::fprintf(stderr, "[engine] world %u: holding team %d for %.0fs\n", world, team, sh.resume_grace);
+            }
+            sessions.erase(id);
+            return;
+        }
+        auto sit = sessions.find(id);
+        if (sit == sessions.end()) return; // client already gone
+        Session& session = sit->second;
+        const tcp_protocol::ClientMsg& msg = ev.msg;
+        using tcp_protocol::ClientMsgType;
+        if (msg.type == ClientMsgType::Join) {
+            // Compute defs hash match
+            tcp_protocol::JoinedReply joined;
+            if (cb.get_defs_hash) joined.defs_hash = cb.get_defs_hash();
+            if (cb.get_defs_hash && !msg.defs_hash.empty()) { joined.has_match = true; joined.match = (joined.defs_hash == msg.defs_hash); }
+            // Interned def table is exchanged once here; state lines then carry ids only
+            if (cb.get_def_keys) joined.def_keys = cb.get_def_keys();
+            // Binary state frames when the client offers them and the engine can encode them
+            auto has_cap = [&](const char* c) { return std::find(msg.caps.begin(), msg.caps.end(), c) != msg.caps.end(); };
+            bool binary = cb.build_state_frame && has_cap(tcp_protocol::kCapBinaryState);
+            if (msg.spectator) {
+                // Read-only watcher: the connection moves to the fan-out
+                // thread and the session goes away, so it never has a turn
+                Outbound o; o.client = id; o.set_format = (int8_t)kGroupNone; o.spectate = true;
+                o.format = binary ? kFormatBinary : kFormatJson;
+                o.delay = std::min(msg.delay, kMaxSpectatorDelay); o.rate = msg.rate;
+                if (binary) joined.state_format = tcp_protocol::kCapBinaryState;
+                o.line = std::make_shared<const std::string>(tcp_protocol::build_joined_reply(joined));
+                push_reply(o);
+                sessions.erase(sit);
+                return;
+            }
+            // Resume: take over a held session (team, turn, pending commands);
+            // an unknown or expired token is an ordinary join
+            auto pit = msg.resume ? parked.find(msg.resume) : parked.end();
+            const bool resumed = pit != parked.end();
+            if (resumed) {
+                const Session& old = pit->second.s;
+                session.team = old.team; session.next_turn_time = old.next_turn_time; session.hint = old.hint;
+                session.resume_token = old.resume_token; session.pending_cmds = old.pending_cmds;
+                for (auto* list : {&traces_queued, &traces_applied}) for (auto& p : *list) if (p.client == pit->second.client) p.client = id;
+                parked.erase(pit);
+                std::fprintf(stderr, "[engine] world %u: team %d resumed\n", world, session.team);
+            } else if (msg.team >= 0) {
+                // Enforce unique team claim if provided
+                if (team_taken(msg.team)) { reply(id, tcp_protocol::build_reply("error", "team taken")); return; }
+                session.team = msg.team; claimed_teams.insert(msg.team);
+            }
+            if (!session.resume_token) session.resume_token = (token_rng() & ((1ull << 53) - 1)) | 1;
+            session.hint.team = session.team;
+            // Shared memory replaces streaming entirely (every client is on
+            // this host: the listener is loopback only)
+            if (binary && has_cap(tcp_protocol::kCapShmState) && !shm.ready() && !shm_failed) {
+                shm_failed = !shm.create("/focm_engine." + std::to_string((long)::getpid()) + (world ? "." + std::to_string(world) : std::string()));
+                if (!shm_failed) std::fprintf(stderr, "[engine] shared-memory state at %s\n", shm.name().c_str());
+            }
+            session.shm = binary && has_cap(tcp_protocol::kCapShmState) && shm.ready();
+            bool delta = binary && !session.shm && cb.collect_ship_records && has_cap(tcp_protocol::kCapDeltaState);
+            session.format = delta ? kFormatDelta : binary ? kFormatBinary : kFormatJson;
+            session.has_base = false; session.sent.clear();
+            session.state_period = msg.rate > 0.0 ? 1.0 / msg.rate : 0.0;
+            session.max_bps = msg.max_bps > 0.0 ? msg.max_bps : 0.0;
+            session.next_state = 0.0; session.byte_credit = 0.0; session.credit_time = wall_now();
+            if (binary) joined.state_format = delta ? tcp_protocol::kCapDeltaState : tcp_protocol::kCapBinaryState;
+            // State frames over UDP on request; a random token ties the
+            // client's hello datagrams to this connection
+            const uint64_t udp_token = (sh.udp && binary && !session.shm && has_cap(tcp_protocol::kCapUdpState)) ? ((token_rng() & ((1ull << 53) - 1)) | 1) : 0;
+            // Compression of large state messages, optionally against the
+            // previous one; applied by the network thread
+            const bool lz_dict = has_cap(tcp_protocol::kCapLzDict), lz = lz_dict || has_cap(tcp_protocol::kCapLzState);
+            Outbound o; o.client = id; o.set_format = (int8_t)group_of(session); o.set_udp = true; o.udp_token = udp_token;
+            o.set_lz = true; o.lz_dict = lz_dict;
+            o.lz_min = lz ? (msg.compress_min > 0 ? msg.compress_min : (uint32_t)tcp_protocol::kLzDefaultMinBytes) : 0;
+            joined.udp_token = udp_token;
+            if (session.shm) joined.shm_name = shm.name();
+            if (lz) joined.compression = lz_dict ? tcp_protocol::kCapLzDict : tcp_protocol::kCapLzState;
+            joined.resume_token = session.resume_token;
+            if (resumed) { joined.resumed = true; joined.pending = session.pending_cmds; }
+            o.line = std::make_shared<const std::string>(tcp_protocol::build_joined_reply(joined));
+            push_reply(o);
+            if (resumed) send_catchup(id, session);
+        } else if (msg.type == ClientMsgType::StateReq) {
+            bool all = false; if (!msg.scope.empty()) { all = (msg.scope == "all" || msg.scope == "ALL"); }
+            const tcp_protocol::StateStamp st = stamp();
+            // Delta clients get a full v1 frame; it does not touch their baseline
+            if (aoi && session.hint.filtered()) {
+                cb.update_interest();
+                tcp_protocol::InterestSelection sel; cb.select_interest(session.hint, all, sel);
+                reply_state(id, session.format != kFormatJson ? tcp_protocol::build_state_frame(sel, &st) : tcp_protocol::build_state_json(sel, defs_hash, &st));
+            } else if (session.format != kFormatJson) reply_state(id, cb.build_state_frame(all, &st));
+            else if (cb.build_state_json) reply_state(id, cb.build_state_json(all, &st));
+        } else if (msg.type == ClientMsgType::View) {
+            const uint8_t before = group_of(session);
+            session.hint.has_view = msg.view_r > 0.0;
+            session.hint.view_x = msg.view_x; session.hint.view_y = msg.view_y; session.hint.view_r = msg.view_r;
+            const uint8_t after = group_of(session);
+            if (after != before) { Outbound o; o.client = id; o.set_format = (int8_t)after; push_reply(o); }
+        } else if (msg.type == ClientMsgType::StateAck) {
+            // Newest acked frame becomes the baseline; unknown/stale seqs are ignored
+            for (auto it = session.sent.begin(); it != session.sent.end(); ++it) {
+                if (it->seq != msg.seq) continue;
+                session.base = std::move(*it); session.has_base = true;
+                session.sent.erase(session.sent.begin(), it + 1);
+                break;
+            }
+        } else if (msg.type == ClientMsgType::Cmd) {
+            const auto& cc = msg.cmd; Command c; uint64_t uid = cc.uid;
+            if (cc.name == "THROTTLE") { c.type = Command::Type::THROTTLE; c.a = cc.value; }
+            else if (cc.name == "HEADING") { c.type = Command::Type::HEADING; c.a = cc.theta; }
+            else if (cc.name == "FIRE") { c.type = Command::Type::FIRE; c.a = cc.theta; }
+            else { reply(id, tcp_protocol::build_reply("error", "unknown cmd")); return; }
+            c.uid = uid; if (cb.find_ship_by_uid) c.ship = cb.find_ship_by_uid(uid);
+            if (!c.ship) { reply(id, tcp_protocol::build_reply("error", "unknown uid")); return; }
+            if (cb.queue_command) cb.queue_command(c);
+            reply(id, tcp_protocol::build_reply("ack", cc.name.c_str()));
+            session.pending_cmds.push_back(cc.name);
+            if (msg.trace) {
+                tcp_protocol::CmdTrace tr; tr.id = msg.trace; tr.t_send = msg.t_send; tr.t_recv = ev.t_recv; tr.t_queued = tcp_protocol::trace_clock();
+                traces_queued.push_back(PendingTrace{id, tr});
+            }
+        } else if (msg.type == ClientMsgType::Plan) {
+            Ship* ship = cb.find_ship_by_uid ? cb.find_ship_by_uid(msg.cmd.uid) : nullptr;
+            if (!ship) { reply(id, tcp_protocol::build_reply("error", "unknown uid")); return; }
+            std::vector<PlanStep> steps; steps.reserve(msg.plan.size());
+            for (const auto& ps : msg.plan) {
+                PlanStep st; st.t = (float)ps.t;
+                if (ps.cmd.name == "THROTTLE") { st.op = PlanStep::THROTTLE; st.a = (float)ps.cmd.value; }
+                else if (ps.cmd.name == "HEADING") { st.op = PlanStep::HEADING; st.a = (float)ps.cmd.theta; }
+                else { st.op = PlanStep::FIRE; st.a = (float)ps.cmd.theta; }
+                steps.push_back(st);
+            }
+            if (cb.set_plan) cb.set_plan(ship, std::move(steps));
+            reply(id, tcp_protocol::build_reply("ack", msg.plan.empty() ? "PLAN CANCEL" : "PLAN"));
+        } else if (msg.type == ClientMsgType::TimeScale) {
+            // Only players holding a team may pace the world; anyone may query
+            if (msg.scale >= 0.0 && session.team < 0) { reply(id, tcp_protocol::build_reply("error", "time scale needs a team")); return; }
+            if (msg.scale >= 0.0) {
+                double applied = sched.set_time_scale(msg.scale);
+                if (std::isinf(applied)) std::fprintf(stderr, "[engine] time scale max\n");
+                else std::fprintf(stderr, "[engine] time scale %g\n", applied);
+            }
+            const TickScheduler::Stats& st = sched.stats();
+            tcp_protocol::TickStatus ts;
+            ts.scale = sched.time_scale(); ts.tick_rate = sched.tick_rate(); ts.sim_time = sim_time;
+            ts.ticks = st.ticks; ts.steps = st.steps;
+            ts.catchup_overruns = st.catchup_overruns; ts.work_overruns = st.work_overruns;
+            ts.dropped_sim_time = st.dropped_sim_time;
+            ts.jitter_avg_ms = st.jitter_samples ? 1e3 * st.jitter_sum / (double)st.jitter_samples : 0.0;
+            ts.jitter_max_ms = 1e3 * st.jitter_max;
+            ts.dropped_snapshots = dropped_snapshots;
+            ts.net_queued_bytes = sh.net_queued_bytes.load(); ts.net_dropped_bytes = sh.net_dropped_bytes.load();
+            ts.net_dropped_frames = sh.net_dropped_frames.load();
+            reply(id, tcp_protocol::build_tick_status(ts));
+        } else if (msg.type == ClientMsgType::EndTurn) {
+            if (cb.apply_queued_commands) cb.apply_queued_commands();
+            // Every queued command of the world was applied, whoever sent it
+            for (auto& kv : sessions) kv.second.pending_cmds.clear();
+            for (auto& kv : parked) kv.second.s.pending_cmds.clear();
+            if (!traces_queued.empty()) {
+                const double now = tcp_protocol::trace_clock();
+                for (auto& p : traces_queued) { p.tr.t_applied = now; p.tr.applied_tick = tick_count; traces_applied.push_back(p); }
+                traces_queued.clear();
+            }
+            if (cb.end_of_turn_cleanup) cb.end_of_turn_cleanup();
+            if (cb.rebuild_uid_map) cb.rebuild_uid_map();
+            // Schedule client's next turn
+            session.next_turn_time = (msg.wait > 0.0 ? sim_time + msg.wait : sim_time);
+        } else {
+            reply(id, tcp_protocol::build_reply("error", "unknown type"));
+        }
+    }
+
+    // One worker pass after events were handled; tick: this world's timer fired
+    void advance(bool tick) {
+        if (!parked.empty()) expire_parked(wall_now());
         // Determine if any client has a turn due
         bool any_due = false;
-        for (const auto& c : clients) if (c.fd >= 0 && c.next_turn_time <= sim_time + 1e-12) { any_due = true; break; }
+        for (const auto& kv : sessions) if (kv.second.next_turn_time <= sim_time + 1e-12) { any_due = true; break; }
 
         // Initial wait until all required teams are claimed
         if (initial_wait) {
             bool all_claimed = true; for (int t : required_teams) if (!claimed_teams.count(t)) { all_claimed = false; break; }
-            if (!all_claimed) { usleep(1000); continue; }
-            initial_wait = false;
+            if (all_claimed) initial_wait = false;
+        }
+
+        // Ticks run only while nobody has a turn due and time is not paused;
+        // otherwise the timer is disarmed and the world waits for events.
+        const bool run = tfd >= 0 && !initial_wait && !any_due && !sched.paused();
+        if (run != ticking) {
+            arm_timer(tfd, run ? sched.period() : 0.0); ticking = run;
+            if (run) sched.reset(wall_now());
         }
 
-        if (!any_due) {
-            // Step simulation and broadcast
-            if (cb.step_world_dt) cb.step_world_dt(dt);
+        if (run && tick) {
+            // Fixed dt steps owed since the last wakeup, bounded by the catch-up budget
+            double start = wall_now();
+            const int steps = sched.on_tick(start);
+            int ran = 0;
+            while (ran < steps) {
+                if (cb.step_world_dt) cb.step_world_dt(dt);
+                sim_time += dt; ++tick_count; ++ran;
+                // A client's turn coming due stops the catch-up mid-wakeup
+                bool due = false;
+                for (const auto& kv : sessions) if (kv.second.next_turn_time <= sim_time + 1e-12) { due = true; break; }
+                if (due) break;
+            }
             if (cb.rebuild_uid_map) cb.rebuild_uid_map();
-            sim_time += dt;
-            if (cb.build_state_json) {
-                std::string sline = cb.build_state_json(false);
-                for (const auto& c : clients) if (c.fd >= 0) send_line(c.fd, sline);
+            sched.record_work(ran, wall_now() - start);
+            // Broadcast once per wakeup; a full ring means the network side
+            // is behind, and a newer snapshot supersedes this one anyway
+            if (ran > 0) { broadcast_state(); if (!traces_applied.empty()) reply_traces(); }
+        }
+    }
+};
+
+// Sim worker thread: drives the worlds of one shard, each on its own tick
+// timer, so a busy world only delays the others sharing its worker
+static void sim_worker(Shared& sh, uint32_t index, const std::vector<ServerCallbacks>& cbs, double dt, const TickConfig& tick_cfg)
+{
+    Shard& shard = *sh.shards[index];
+    const uint32_t step = (uint32_t)sh.shards.size();
+    // Local slot of world w is w / step
+    std::vector<std::unique_ptr<SimWorld>> worlds;
+    for (uint32_t w = index; w < sh.worlds; w += step) worlds.push_back(std::make_unique<SimWorld>(sh, cbs[w], w, dt, tick_cfg));
+    std::vector<pollfd> pfds;
+    pfds.push_back(pollfd{shard.sim_wake, POLLIN, 0});
+    for (const auto& w : worlds) pfds.push_back(pollfd{w->timer_fd(), POLLIN, 0}); // fd -1 is ignored by poll
+    std::vector<uint8_t> ticked(worlds.size());
+
+    while (!sh.stop.load()) {
+        int rv = ::poll(pfds.data(), (nfds_t)pfds.size(), -1);
+        if (rv < 0) { if (errno == EINTR) continue; std::perror("poll"); break; }
+        if (pfds[0].revents & POLLIN) drain_fd(shard.sim_wake);
+        for (size_t i = 0; i < worlds.size(); ++i) {
+            ticked[i] = 0;
+            if (!(pfds[i + 1].revents & POLLIN)) continue;
+            uint64_t exp = 0;
+            if (::read(pfds[i + 1].fd, &exp, sizeof(exp)) == (ssize_t)sizeof(exp) && exp > 0) ticked[i] = 1;
+        }
+
+        SimEvent ev;
+        while (shard.events.pop(ev)) worlds[ev.world / step]->handle(ev);
+        for (size_t i = 0; i < worlds.size(); ++i) worlds[i]->advance(ticked[i] != 0);
+        if (shard.wake_net) { signal_fd(sh.net_wake); shard.wake_net = false; }
+    }
+}
+
+// Fan-out thread: serves spectators the broadcast frames the sim thread
+// encodes once, each delayed and thinned to its own settings, so hundreds of
+// watchers cost the network thread and the sim nothing per frame
+static void fanout_loop(Shared& sh)
+{
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) { std::perror("epoll_create1"); return; }
+    epoll_event wev{}; wev.events = EPOLLIN | EPOLLET; wev.data.u64 = kTagWake;
+    epoll_ctl(ep, EPOLL_CTL_ADD, sh.fan_wake, &wev);
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point t0 = clock::now();
+    auto now = [&]{ return std::chrono::duration<double>(clock::now() - t0).count(); };
+    // Recent frames per world and format, oldest first, kept as long as the
+    // most delayed spectator needs them
+    struct Frame { uint64_t id; double t; std::shared_ptr<const std::string> data; };
+    std::vector<std::deque<Frame>> history((size_t)sh.worlds * kFormatCount);
+    auto history_of = [&](const Client& c) -> std::deque<Frame>& { return history[(size_t)c.world * kFormatCount + c.format]; };
+    uint64_t next_frame = 1;
+    std::unordered_map<uint64_t, Spectator> spectators;
+
+    auto drop = [&](uint64_t id, const char* why) {
+        auto it = spectators.find(id); if (it == spectators.end()) return;
+        const Client& c = it->second.client;
+        std::fprintf(stderr, "[engine] spectator disconnected (fd=%d, %s) sent=%llu dropped=%llu bytes in %llu frames\n",
+                     c.fd, why, (unsigned long long)c.sent_bytes, (unsigned long long)c.out.dropped_bytes, (unsigned long long)c.out.dropped_frames);
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        sh.spectators[c.world * kFormatCount + c.format].fetch_sub(1, std::memory_order_relaxed);
+        spectators.erase(it);
+    };
+    auto send = [&](uint64_t id, Client& c) {
+        if (!flush(c)) { drop(id, "send failed"); return false; }
+        if (c.out.bytes > kMaxClientBacklog) { drop(id, "too slow"); return false; }
+        return true;
+    };
+
+    std::vector<epoll_event> events(256);
+    std::vector<uint64_t> gone;
+    bool waiting = false; // a delayed or rate-limited spectator has a frame coming
+    while (!sh.stop.load()) {
+        int rv = epoll_wait(ep, events.data(), (int)events.size(), waiting ? kFanoutPollMs : -1);
+        if (rv < 0) { if (errno == EINTR) continue; std::perror("epoll_wait"); break; }
+
+        for (int e = 0; e < rv; ++e) {
+            const uint64_t tag = events[e].data.u64;
+            if (tag == kTagWake) { drain_fd(sh.fan_wake); continue; }
+            auto it = spectators.find(tag);
+            if (it == spectators.end()) continue;
+            Client& c = it->second.client;
+            if ((events[e].events & EPOLLOUT) && !c.out.empty() && !send(tag, c)) continue;
+            if (!(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+            // Spectators are read-only: input is discarded, EOF ends the watch
+            char buf[4096];
+            bool closed = false;
+            while (true) {
+                ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (n <= 0) { closed = true; break; }
             }
-        } else {
-            // Pause stepping to let due client(s) act
-            usleep(1000);
+            if (closed) drop(tag, "closed");
+        }
+
+        Spectator sp;
+        while (sh.handoff.pop(sp)) {
+            const uint64_t id = sp.client.id;
+            epoll_event ev{}; ev.events = EPOLLIN | EPOLLOUT | EPOLLET; ev.data.u64 = id;
+            if (epoll_ctl(ep, EPOLL_CTL_ADD, sp.client.fd, &ev) < 0) { std::perror("epoll_ctl"); ::close(sp.client.fd); continue; }
+            sh.spectators[sp.client.world * kFormatCount + sp.client.format].fetch_add(1, std::memory_order_relaxed);
+            Spectator& s = spectators[id] = std::move(sp);
+            send(id, s.client);
+        }
+        const double t = now();
+        FanoutFrame f;
+        for (auto& shard : sh.shards)
+            while (shard->fanout.pop(f)) if (f.world < sh.worlds && f.format < kFormatCount) history[(size_t)f.world * kFormatCount + f.format].push_back(Frame{next_frame++, t, std::move(f.data)});
+
+        // Each spectator gets the newest frame old enough for its delay, no
+        // sooner than its rate allows; frames in between are skipped
+        waiting = false;
+        double keep = 0.0;
+        for (auto& kv : spectators) {
+            Spectator& s = kv.second;
+            keep = std::max(keep, s.delay);
+            const auto& h = history_of(s.client);
+            const Frame* pick = nullptr;
+            for (auto r = h.rbegin(); r != h.rend(); ++r) if (r->t <= t - s.delay) { pick = &*r; break; }
+            if (pick && pick->id == s.last_frame) pick = nullptr;
+            if (pick && s.period > 0.0 && t < s.next_send) { waiting = true; continue; }
+            if (!pick) { if (s.delay > 0.0 && !h.empty() && h.back().id != s.last_frame) waiting = true; continue; }
+            s.last_frame = pick->id;
+            if (s.period > 0.0) s.next_send = (s.next_send + s.period > t) ? s.next_send + s.period : t + s.period;
+            s.client.out.push(pick->data, true);
+            if (!flush(s.client)) gone.push_back(kv.first);
+            else if (s.client.out.bytes > kMaxClientBacklog) gone.push_back(kv.first);
+        }
+        for (uint64_t id : gone) drop(id, "send failed or too slow");
+        gone.clear();
+        // Trim history, always keeping each format's newest frame
+        for (auto& h : history)
+            while (h.size() > 1 && h[1].t < t - keep - 1.0) h.pop_front();
+    }
+
+    for (const auto& kv : spectators) ::close(kv.second.client.fd);
+    Spectator sp;
+    while (sh.handoff.pop(sp)) ::close(sp.client.fd);
+    ::close(ep);
+}
+
+} // anonymous
+
+void stop_engine_server()
+{
+    g_stop.store(true);
+    int fd = g_wake_fd.load();
+    if (fd >= 0) signal_fd(fd);
+}
+
+void run_engine_server(int port, double min_time_step, const ServerCallbacks& cb, const TickConfig& tick)
+{
+    run_engine_server(port, min_time_step, std::vector<ServerCallbacks>{cb}, tick);
+}
+
+void run_engine_server(int port, double min_time_step, const std::vector<ServerCallbacks>& worlds, const TickConfig& tick, int workers,
+                       double resume_grace)
+{
+    if (worlds.empty()) { std::fprintf(stderr, "[engine] no worlds to serve\n"); return; }
+    int srv = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (srv < 0) { std::perror("socket"); return; }
+    int yes = 1; setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); addr.sin_port = htons((uint16_t)port);
+    if (bind(srv, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("bind"); ::close(srv); return; }
+    if (listen(srv, SOMAXCONN) < 0) { std::perror("listen"); ::close(srv); return; }
+    int flags = fcntl(srv, F_GETFL, 0); if (flags >= 0) fcntl(srv, F_SETFL, flags | O_NONBLOCK);
+    // UDP state channel on the same port number; without it clients keep
+    // getting state over TCP
+    int usock = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (usock >= 0 && bind(usock, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("bind udp"); ::close(usock); usock = -1; }
+    if (usock >= 0) { int sz = 4 << 20; setsockopt(usock, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz)); }
+
+    // Network thread: edge-triggered epoll over the listener, every client and
+    // a wakeup eventfd signalled by the sim workers and stop_engine_server()
+    Shared sh;
+    sh.worlds = (uint32_t)worlds.size();
+    sh.resume_grace = resume_grace;
+    if (workers <= 0) workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, (int)sh.worlds);
+    bool fds_ok = true;
+    for (int i = 0; i < workers; ++i) {
+        sh.shards.push_back(std::make_unique<Shard>());
+        sh.shards.back()->sim_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (sh.shards.back()->sim_wake < 0) fds_ok = false;
+    }
+    sh.spectators.reset(new std::atomic<uint32_t>[(size_t)sh.worlds * kFormatCount]());
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    sh.net_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    sh.fan_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ep < 0 || sh.net_wake < 0 || sh.fan_wake < 0 || !fds_ok) {
+        std::perror("epoll/eventfd");
+        for (int fd : {ep, sh.net_wake, sh.fan_wake}) if (fd >= 0) ::close(fd);
+        for (const auto& sd : sh.shards) if (sd->sim_wake >= 0) ::close(sd->sim_wake);
+        if (usock >= 0) ::close(usock);
+        ::close(srv); return;
+    }
+    auto watch = [&](int fd, uint64_t tag, uint32_t extra = 0){ epoll_event ev{}; ev.events = EPOLLIN | EPOLLET | extra; ev.data.u64 = tag; return epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev); };
+    watch(srv, kTagListener); watch(sh.net_wake, kTagWake);
+    if (usock >= 0) { watch(usock, kTagUdp); sh.udp = true; }
+    g_stop.store(false); g_wake_fd.store(sh.net_wake);
+    if (sh.worlds > 1) std::fprintf(stderr, "[engine] listening on 127.0.0.1:%d (%u worlds on %d sim workers)\n", port, sh.worlds, workers);
+    else std::fprintf(stderr, "[engine] listening on 127.0.0.1:%d\n", port);
+
+    const double dt = (min_time_step > 0.0 ? min_time_step : (1.0/64.0));
+    std::vector<std::thread> sims;
+    for (int i = 0; i < workers; ++i) sims.emplace_back(sim_worker, std::ref(sh), (uint32_t)i, std::cref(worlds), dt, std::cref(tick));
+    std::thread fan(fanout_loop, std::ref(sh));
+
+    std::unordered_map<uint64_t, Client> clients; // keyed by connection id
+    std::unordered_map<uint64_t, uint64_t> udp_tokens; // UDP token -> connection id
+    uint64_t next_id = 1;
+    // Held in reserve for accepting (and closing) a connection when out of
+    // descriptors; otherwise it would sit in the backlog and, the listener
+    // being edge-triggered, stall every later accept
+    int spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    std::vector<uint8_t> pushed(sh.shards.size()); // events queued for each sim worker this pass
+    auto post = [&](SimEvent::Kind kind, const Client& c, tcp_protocol::ClientMsg* msg, bool dropped = false) {
+        SimEvent ev; ev.kind = kind; ev.world = c.world; ev.client = c.id; ev.dropped = dropped;
+        if (msg) { if (msg->trace) ev.t_recv = tcp_protocol::trace_clock(); ev.msg = std::move(*msg); }
+        sh.shard_of(c.world).events.push(std::move(ev)); pushed[c.world % sh.shards.size()] = 1;
+    };
+    uint64_t total_dropped_bytes = 0, total_dropped_frames = 0;
+    auto close_client = [&](uint64_t id, const char* why) {
+        auto it = clients.find(id); if (it == clients.end()) return;
+        const Client& c = it->second;
+        std::fprintf(stderr, "[engine] client disconnected (fd=%d, %s) sent=%llu dropped=%llu bytes in %llu frames udp_frames=%llu\n",
+                     c.fd, why, (unsigned long long)c.sent_bytes, (unsigned long long)c.out.dropped_bytes, (unsigned long long)c.out.dropped_frames,
+                     (unsigned long long)c.udp_frames);
+        if (c.lz_raw_bytes) std::fprintf(stderr, "[engine] client fd=%d compressed state %llu -> %llu bytes (%.1fx)\n", c.fd,
+                                         (unsigned long long)c.lz_raw_bytes, (unsigned long long)c.lz_bytes, (double)c.lz_raw_bytes / (double)c.lz_bytes);
+        if (c.udp_token) udp_tokens.erase(c.udp_token);
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        post(SimEvent::Disconnect, c, nullptr, true);
+        clients.erase(it);
+    };
+    // Compressed encodings of this pass by (message, dictionary): clients of
+    // one broadcast on the same dictionary share one. Entries hold both so
+    // their addresses stay unique until the cache is cleared.
+    struct LzEntry { std::shared_ptr<const std::string> raw, dict, frame; };
+    std::map<std::pair<const std::string*, const std::string*>, LzEntry> lz_cache;
+    auto lz_frame = [&](const std::shared_ptr<const std::string>& raw, const std::shared_ptr<const std::string>& dict) -> const std::shared_ptr<const std::string>& {
+        LzEntry& e = lz_cache[std::make_pair(raw.get(), dict.get())];
+        if (!e.raw) {
+            e.raw = raw; e.dict = dict;
+            std::string f = tcp_protocol::build_compressed_frame(*raw, dict.get());
+            if (!f.empty()) e.frame = std::make_shared<const std::string>(std::move(f));
+        }
+        return e.frame; // null: not worth it
+    };
+    // Clients with newly queued data this pass, flushed once after the batch
+    std::vector<uint64_t> dirty;
+    auto queue_to = [&](Client& c, std::shared_ptr<const std::string> data, bool state, bool compress = false) {
+        const uint64_t db = c.out.dropped_bytes, df = c.out.dropped_frames;
+        const bool lz = compress && c.lz_min && data->size() >= c.lz_min;
+        // State for a client with a live UDP channel skips the send queue.
+        // Datagrams may be lost, so they never use a dictionary.
+        bool sent = false;
+        if (state && c.udp_ready) {
+            const auto& f = lz ? lz_frame(data, nullptr) : nullptr;
+            sent = send_udp(usock, c, f ? *f : *data);
+            if (sent && f) { c.lz_raw_bytes += data->size(); c.lz_bytes += f->size(); }
+        }
+        if (!sent) {
+            if (!c.dirty) { c.dirty = true; dirty.push_back(c.id); }
+            std::shared_ptr<const std::string> f, dict;
+            if (lz) {
+                if (state) c.out.supersede(); // before picking the dictionary
+                if (c.lz_dict) dict = c.out.lz_dictionary();
+                f = lz_frame(data, dict);
+            }
+            if (f) { c.lz_raw_bytes += data->size(); c.lz_bytes += f->size(); c.out.push(f, state, std::move(data), std::move(dict)); }
+            else c.out.push(std::move(data), state);
+        }
+        total_dropped_bytes += c.out.dropped_bytes - db; total_dropped_frames += c.out.dropped_frames - df;
+    };
+    std::vector<epoll_event> events(256);
+
+    while (!g_stop.load()) {
+        int rv = epoll_wait(ep, events.data(), (int)events.size(), -1);
+        if (rv < 0) { if (errno == EINTR) continue; std::perror("epoll_wait"); break; }
+
+        for (int e = 0; e < rv; ++e) {
+            const uint64_t tag = events[e].data.u64;
+            if (tag == kTagWake) { drain_fd(sh.net_wake); continue; } // outbound is flushed below
+
+            // Hello datagrams: the sender's address becomes the client's UDP
+            // state destination (resent hellos may move it)
+            if (tag == kTagUdp) {
+                char dg[64];
+                while (true) {
+                    sockaddr_in from{}; socklen_t flen = sizeof(from);
+                    ssize_t n = ::recvfrom(usock, dg, sizeof(dg), 0, (sockaddr*)&from, &flen);
+                    if (n < 0) { if (errno == EINTR) continue; break; }
+                    uint64_t token = 0;
+                    if (!tcp_protocol::parse_udp_hello(dg, (size_t)n, &token)) continue;
+                    auto t = udp_tokens.find(token);
+                    if (t == udp_tokens.end()) continue;
+                    auto cit = clients.find(t->second);
+                    if (cit == clients.end()) continue;
+                    Client& c = cit->second;
+                    if (!c.udp_ready || c.udp_addr.sin_port != from.sin_port || c.udp_addr.sin_addr.s_addr != from.sin_addr.s_addr)
+                        std::fprintf(stderr, "[engine] client fd=%d state over udp (port %u)\n", c.fd, (unsigned)ntohs(from.sin_port));
+                    c.udp_addr = from; c.udp_ready = true;
+                }
+                continue;
+            }
+
+            // Accept every pending connection (edge-triggered: drain until EAGAIN)
+            if (tag == kTagListener) {
+                while (true) {
+                    sockaddr_in cli{}; socklen_t len = sizeof(cli);
+                    int fd = ::accept4(srv, (sockaddr*)&cli, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) {
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                        if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) continue;
+                        if ((errno == EMFILE || errno == ENFILE) && spare_fd >= 0) {
+                            std::perror("accept");
+                            ::close(spare_fd);
+                            fd = ::accept4(srv, nullptr, nullptr, SOCK_CLOEXEC);
+                            const int accept_errno = errno;
+                            if (fd >= 0) ::close(fd);
+                            spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            if (fd >= 0) { std::fprintf(stderr, "[engine] out of descriptors; refused a connection\n"); continue; }
+                            if (accept_errno == EAGAIN || accept_errno == EWOULDBLOCK) break;
+                            errno = accept_errno;
+                        }
+                        std::perror("accept");
+                        break;
+                    }
+                    const uint64_t id = next_id++;
+                    if (watch(fd, id, EPOLLOUT) < 0) { ::close(fd); continue; }
+                    Client c; c.id = id; c.fd = fd;
+                    std::fprintf(stderr, "[engine] client connected (fd=%d)\n", fd);
+                    post(SimEvent::Connect, c, nullptr); // world 0 until a join names another
+                    clients[id] = std::move(c);
+                }
+                continue;
+            }
+
+            auto cit = clients.find(tag);
+            if (cit == clients.end()) continue;
+            Client& client = cit->second;
+            // Socket writable again: resume the send queue
+            if ((events[e].events & EPOLLOUT) && !client.out.empty() && !flush(client)) { close_client(tag, "send failed"); continue; }
+            if (!(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+
+            // Read from a client until the socket is drained, parsing each
+            // chunk in place; everything that touches the world runs on the
+            // sim thread
+            const int fd = client.fd;
+            bool closed = false;
+            while (true) {
+                ssize_t n = ::recv(fd, client.in.prepare(4096), 4096, 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (n <= 0) { closed = true; break; }
+                client.in.commit((size_t)n);
+                std::string_view line;
+                LineFramer::Status st;
+                while ((st = client.in.next_line(line)) != LineFramer::kNone) {
+                    if (st == LineFramer::kTooLong) { queue_to(client, std::make_shared<const std::string>(tcp_protocol::build_reply("error", "line too long")), false); continue; }
+                    if (line.empty()) continue;
+                    tcp_protocol::ClientMsg msg; std::string perr;
+                    if (!tcp_protocol::parse_client_message(line.data(), msg, &perr)) { queue_to(client, std::make_shared<const std::string>(tcp_protocol::build_reply("error", perr.c_str())), false); continue; }
+                    // A join naming another world moves the connection there
+                    // as if it had just connected to it
+                    if (msg.type == tcp_protocol::ClientMsgType::Join && msg.session >= 0 && (uint32_t)msg.session != client.world) {
+                        if ((uint32_t)msg.session >= sh.worlds) { queue_to(client, std::make_shared<const std::string>(tcp_protocol::build_reply("error", "unknown session")), false); continue; }
+                        post(SimEvent::Disconnect, client, nullptr);
+                        client.world = (uint32_t)msg.session; client.format = kFormatJson;
+                        if (client.udp_token) { udp_tokens.erase(client.udp_token); client.udp_token = 0; client.udp_ready = false; }
+                        post(SimEvent::Connect, client, nullptr);
+                    }
+                    post(SimEvent::Message, client, &msg);
+                }
+            }
+            if (closed) { close_client(tag, "closed"); continue; }
+        }
+        for (size_t i = 0; i < pushed.size(); ++i) if (pushed[i]) { signal_fd(sh.shards[i]->sim_wake); pushed[i] = 0; }
+
+        // Queue replies and snapshots from the sim thread in order, then
+        // write each touched client once; a slow socket only delays itself
+        Outbound o;
+        for (auto& shard : sh.shards) while (shard->out.pop(o)) {
+            if (o.client == kBroadcast) { for (auto& kv : clients) if (kv.second.world == o.world && kv.second.format == o.format) queue_to(kv.second, o.line, o.state, o.compress); continue; }
+            auto it = clients.find(o.client);
+            if (it == clients.end() || it->second.world != o.world) continue;
+            if (o.set_format >= 0) it->second.format = (uint8_t)o.set_format;
+            if (o.set_udp) {
+                Client& c = it->second;
+                if (c.udp_token) udp_tokens.erase(c.udp_token);
+                c.udp_token = o.udp_token; c.udp_ready = false;
+                if (c.udp_token) udp_tokens[c.udp_token] = c.id;
+            }
+            if (o.set_lz) { Client& c = it->second; c.lz_min = o.lz_min; c.lz_dict = o.lz_dict; }
+            if (o.spectate) {
+                // The joined reply goes out ahead of the first fan-out state;
+                // from here on the fan-out thread owns the socket
+                Client& c = it->second;
+                if (o.line) c.out.push(std::move(o.line), false);
+                epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+                if (c.udp_token) udp_tokens.erase(c.udp_token);
+                std::fprintf(stderr, "[engine] client fd=%d is a spectator (delay %.1fs, rate %g/s)\n", c.fd, o.delay, o.rate);
+                Spectator sp; sp.client = std::move(c);
+                sp.client.format = o.format; sp.client.dirty = false; sp.client.udp_token = 0; sp.client.udp_ready = false;
+                sp.delay = o.delay; sp.period = o.rate > 0.0 ? 1.0 / o.rate : 0.0;
+                clients.erase(it);
+                sh.handoff.push(std::move(sp));
+                signal_fd(sh.fan_wake);
+                continue;
+            }
+            if (o.line) queue_to(it->second, std::move(o.line), o.state, o.compress);
+        }
+        lz_cache.clear();
+        size_t total_queued = 0;
+        for (uint64_t id : dirty) {
+            auto it = clients.find(id);
+            if (it == clients.end()) continue;
+            it->second.dirty = false;
+            if (!flush(it->second)) { close_client(id, "send failed"); continue; }
+            if (it->second.out.bytes > kMaxClientBacklog) close_client(id, "too slow");
         }
+        dirty.clear();
+        for (const auto& kv : clients) total_queued += kv.second.out.bytes;
+        sh.net_queued_bytes.store(total_queued);
+        sh.net_dropped_bytes.store(total_dropped_bytes); sh.net_dropped_frames.store(total_dropped_frames);
     }
 
-    for (const auto& c : clients) if (c.fd >= 0) ::close(c.fd);
+    g_wake_fd.store(-1);
+    sh.stop.store(true);
+    for (const auto& sd : sh.shards) signal_fd(sd->sim_wake);
+    signal_fd(sh.fan_wake);
+    for (auto& t : sims) t.join();
+    fan.join();
+    for (const auto& kv : clients) ::close(kv.second.fd);
+    for (const auto& sd : sh.shards) ::close(sd->sim_wake);
+    ::close(sh.net_wake); ::close(sh.fan_wake); ::close(ep);
+    if (spare_fd >= 0) ::close(spare_fd);
+    if (usock >= 0) ::close(usock);
     ::close(srv);
 }
@@ -9,22 +9,53 @@ class Ship;   // forward declare
 #include <string>
 #include <vector>
 
+#include "engine/plan.h"
+#include "stream_io/tick_scheduler.h"
+
+namespace tcp_protocol { struct ShipRecord; struct InterestHint; struct InterestSelection; struct StateStamp; }
+
 struct ServerCallbacks {
     std::function<void(double)> step_world_dt;    // step simulation by dt
     std::function<void()> apply_queued_commands;  // apply queued commands to world
     std::function<void(const struct Command&)> queue_command; // enqueue command
+    std::function<void(Ship*, std::vector<PlanStep>)> set_plan; // attach maneuver plan (empty cancels)
     std::function<void()> rebuild_uid_map;        // rebuild uid_to_ship
     std::function<void()> end_of_turn_cleanup;    // end-of-turn cleanup
     std::function<Ship*(uint64_t)> find_ship_by_uid; // resolve Ship* for a UID
-    std::function<std::string(bool)> build_state_json; // build state json line, include_all
+    std::function<std::string(bool, const tcp_protocol::StateStamp*)> build_state_json; // build state json line, include_all, stamp
+    std::function<std::string(bool, const tcp_protocol::StateStamp*)> build_state_frame; // binary state frame, include_all, stamp (optional)
+    std::function<void(std::vector<tcp_protocol::ShipRecord>&)> collect_ship_records; // quantized ships for delta frames (optional)
+    std::function<void()> update_interest;        // rebuild the area-of-interest index (optional)
+    std::function<void(const tcp_protocol::InterestHint&, bool, tcp_protocol::InterestSelection&)> select_interest; // hint, include_all (optional)
     std::function<std::string()> get_defs_hash;   // return current defs hash
+    std::function<std::vector<std::string>()> get_def_keys; // def keys in interned-id order
     std::function<std::vector<int>()> get_required_teams; // list of required teams
 };
 
-// Runs a TCP server on loopback at the given port, stepping the simulation
-// with min_time_step seconds while no client has a turn due, and pausing
-// stepping as soon as any client reaches its next_turn_time. A client ends
-// its turn by sending an end_turn message with a wait (seconds) until their
-// next turn is due again.
-// Blocks until the server socket is closed or a fatal error occurs.
-void run_engine_server(int port, double min_time_step, const ServerCallbacks& cb);
+constexpr double kDefaultResumeGrace = 10.0;
+
+// Runs a TCP server on loopback at the given port, stepping the simulation in
+// fixed min_time_step increments paced by a TickScheduler (see tick) while no
+// client has a turn due, and pausing stepping as soon as any client reaches
+// its next_turn_time. A client ends its turn by sending an end_turn message
+// with a wait (seconds) until their next turn is due again.
+// The calling thread does network I/O only; every ServerCallbacks function is
+// called from a simulation thread the server starts. State encodings,
+// transports and client roles are negotiated per join (see tcp_protocol.h).
+// A dropped player's session is held for kDefaultResumeGrace seconds.
+// Blocks until stop_engine_server() is called or a fatal error occurs.
+void run_engine_server(int port, double min_time_step, const ServerCallbacks& cb,
+                       const TickConfig& tick = TickConfig());
+
+// Hosts several independent worlds behind one listener. A join with
+// "session": N moves the connection to worlds[N] (connections start in world
+// 0); unknown sessions get an error reply. Worlds are spread over `workers`
+// sim threads (<= 0: one per hardware thread, never more than worlds), each
+// world with its own sessions, turn scheduling and TickScheduler. Callbacks
+// of a world are only ever called from its worker thread.
+void run_engine_server(int port, double min_time_step, const std::vector<ServerCallbacks>& worlds,
+                       const TickConfig& tick = TickConfig(), int workers = 0,
+                       double resume_grace = kDefaultResumeGrace);
+
+// Ask a running run_engine_server to return. Async-signal-safe.
+void stop_engine_server();
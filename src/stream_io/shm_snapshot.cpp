@@ -0,0 +1,134 @@
+// Seqlock-protected triple buffer of state frames in POSIX shared memory.
+
+#include "stream_io/shm_snapshot.h"
+#include "stream_io/state_frame.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tcp_protocol {
+
+namespace {
+
+struct ShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t reserved;
+    uint64_t slot_bytes;
+    std::atomic<uint64_t> latest;
+    std::atomic<uint64_t> overflow;
+    uint64_t pad[3];
+};
+
+struct ShmSlot {
+    std::atomic<uint64_t> lock;
+    uint64_t frame;
+    uint64_t bytes;
+    uint64_t pad[5];
+};
+
+static_assert(sizeof(ShmHeader) == 64 && sizeof(ShmSlot) == 64, "shm layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm atomics must be lock-free");
+
+inline ShmSlot* slot_at(char* base, uint64_t slot_bytes, uint64_t i) { return (ShmSlot*)(base + sizeof(ShmHeader) + i * (sizeof(ShmSlot) + slot_bytes)); }
+inline const ShmSlot* slot_at(const char* base, uint64_t slot_bytes, uint64_t i) { return (const ShmSlot*)(base + sizeof(ShmHeader) + i * (sizeof(ShmSlot) + slot_bytes)); }
+
+} // namespace
+
+ShmSnapshotWriter::~ShmSnapshotWriter()
+{
+    if (base_) { ::munmap(base_, size_); ::shm_unlink(name_.c_str()); }
+}
+
+bool ShmSnapshotWriter::create(const std::string& name, size_t slot_bytes)
+{
+    slot_bytes = (slot_bytes + 63) & ~(size_t)63;
+    const size_t size = sizeof(ShmHeader) + kShmSlots * (sizeof(ShmSlot) + slot_bytes);
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) { std::perror("shm_open"); return false; }
+    if (::ftruncate(fd, (off_t)size) < 0) { std::perror("ftruncate"); ::close(fd); ::shm_unlink(name.c_str()); return false; }
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { std::perror("mmap"); ::shm_unlink(name.c_str()); return false; }
+    // The object starts zeroed (ftruncate), which is a valid empty state
+    ShmHeader* h = (ShmHeader*)p;
+    h->slots = kShmSlots; h->slot_bytes = slot_bytes; h->version = kShmVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = kShmMagic;
+    name_ = name; base_ = (char*)p; size_ = size;
+    return true;
+}
+
+void ShmSnapshotWriter::publish(const char* frame, size_t n)
+{
+    if (!base_) return;
+    ShmHeader* h = (ShmHeader*)base_;
+    if (n > h->slot_bytes) { h->overflow.fetch_add(1, std::memory_order_relaxed); return; }
+    const uint64_t latest = h->latest.load(std::memory_order_relaxed);
+    const uint64_t i = latest ? ((latest & 3) + 1) % kShmSlots : 0;
+    ShmSlot* s = slot_at(base_, h->slot_bytes, i);
+    const uint64_t lock = s->lock.load(std::memory_order_relaxed);
+    s->lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy((char*)(s + 1), frame, n);
+    s->frame = ++frames_; s->bytes = n;
+    s->lock.store(lock + 2, std::memory_order_release);
+    h->latest.store((frames_ << 2) | i, std::memory_order_release);
+}
+
+bool ShmSnapshotReader::open(const std::string& name)
+{
+    close();
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) { std::perror("shm_open"); return false; }
+    struct stat st{};
+    if (::fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmHeader)) { ::close(fd); return false; }
+    void* p = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { std::perror("mmap"); return false; }
+    const ShmHeader* h = (const ShmHeader*)p;
+    const size_t need = sizeof(ShmHeader) + (size_t)h->slots * (sizeof(ShmSlot) + h->slot_bytes);
+    if (h->magic != kShmMagic || h->version != kShmVersion || h->slots != kShmSlots || need > (size_t)st.st_size) {
+        std::fprintf(stderr, "[shm] %s: unsupported layout\n", name.c_str());
+        ::munmap(p, (size_t)st.st_size);
+        return false;
+    }
+    base_ = (const char*)p; size_ = (size_t)st.st_size; last_frame_ = 0;
+    return true;
+}
+
+void ShmSnapshotReader::close()
+{
+    if (base_) ::munmap((void*)base_, size_);
+    base_ = nullptr; size_ = 0;
+}
+
+bool ShmSnapshotReader::read_latest(std::vector<NetObjectView>& out, std::vector<RegionSummary>* summaries_out,
+                                    StateStamp* stamp_out)
+{
+    if (!base_) return false;
+    const ShmHeader* h = (const ShmHeader*)base_;
+    const uint64_t latest = h->latest.load(std::memory_order_acquire);
+    if (latest == 0 || (latest >> 2) == last_frame_) return false;
+    if ((latest & 3) >= kShmSlots) return false; // only a corrupt writer gets here
+    const ShmSlot* s = slot_at(base_, h->slot_bytes, latest & 3);
+    const uint64_t lock = s->lock.load(std::memory_order_acquire);
+    if (lock & 1) return false;
+    const uint64_t n = s->bytes;
+    // Decoded in place; the frame is bounds-checked, so a concurrent
+    // overwrite yields at worst garbage that the lock check below discards
+    bool ok = n <= h->slot_bytes && parse_state_frame((const char*)(s + 1), (size_t)n, out, summaries_out, stamp_out);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->lock.load(std::memory_order_relaxed) != lock) return false;
+    last_frame_ = latest >> 2;
+    return ok;
+}
+
+} // namespace tcp_protocol
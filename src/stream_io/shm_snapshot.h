@@ -0,0 +1,85 @@
+// Shared-memory state transport for clients on the engine's host: the newest
+// full-world binary state frame, readable in place without socket I/O.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stream_io/tcp_protocol.h"
+
+namespace tcp_protocol {
+
+// Join capability (together with kCapBinaryState) asking for state through
+// shared memory. The joined reply then names the POSIX shm object as
+// "shm_name"; no state is streamed over TCP or UDP to such a client.
+constexpr const char* kCapShmState = "shm1";
+
+// Layout: a 64-byte header, then kShmSlots slots, each a 64-byte slot header
+// followed by slot_bytes of frame data (a kFrameKindState frame, as
+// build_state_frame encodes it).
+//   header: u32 magic, u32 version, u32 slot count, u32 reserved,
+//           u64 slot_bytes, u64 latest ((frame number << 2) | slot; 0: none),
+//           u64 frames too large for a slot
+//   slot:   u64 lock (seqlock: odd while being written), u64 frame number,
+//           u64 frame bytes
+// The writer always fills the slot after the latest one, so a reader of the
+// latest slot is only overtaken when it is two whole frames slow; it then sees
+// the lock change and retries with the newer frame.
+constexpr uint32_t kShmMagic = 0x4D434F46; // "FOCM"
+constexpr uint32_t kShmVersion = 1;
+constexpr uint32_t kShmSlots = 3;
+constexpr size_t kShmDefaultSlotBytes = 16u << 20;
+
+// Engine side: owns (and unlinks) the shm object.
+class ShmSnapshotWriter {
+public:
+    ShmSnapshotWriter() = default;
+    ShmSnapshotWriter(const ShmSnapshotWriter&) = delete;
+    ShmSnapshotWriter& operator=(const ShmSnapshotWriter&) = delete;
+    ~ShmSnapshotWriter();
+
+    // Create and map the object (name starts with '/'). Returns false and
+    // prints the reason on failure.
+    bool create(const std::string& name, size_t slot_bytes = kShmDefaultSlotBytes);
+    bool ready() const { return base_ != nullptr; }
+    const std::string& name() const { return name_; }
+
+    // Publish a frame as the newest snapshot. Frames larger than a slot are
+    // counted and skipped.
+    void publish(const char* frame, size_t n);
+
+private:
+    std::string name_;
+    char* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t frames_ = 0;
+};
+
+// Client side: maps the object read-only and decodes the newest snapshot
+// straight from the mapping.
+class ShmSnapshotReader {
+public:
+    ShmSnapshotReader() = default;
+    ShmSnapshotReader(const ShmSnapshotReader&) = delete;
+    ShmSnapshotReader& operator=(const ShmSnapshotReader&) = delete;
+    ~ShmSnapshotReader() { close(); }
+
+    bool open(const std::string& name);
+    void close();
+    bool is_open() const { return base_ != nullptr; }
+
+    // Decode the newest snapshot if one was published since the last
+    // successful read. Returns false when there is nothing new or the writer
+    // overtook the read (the next call picks up the newer frame).
+    bool read_latest(std::vector<NetObjectView>& out, std::vector<RegionSummary>* summaries_out = nullptr,
+                     StateStamp* stamp_out = nullptr);
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t last_frame_ = 0;
+};
+
+} // namespace tcp_protocol
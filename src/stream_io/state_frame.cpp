@@ -0,0 +1,243 @@
+// Binary state frame codec; no json-c, no allocation beyond the output buffer.
+
+#include "stream_io/state_frame.h"
+#include "stream_io/interest.h"
+
+#include "engine/object.h"
+#include "engine/object_def.h"
+#include "engine/ship.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace tcp_protocol {
+
+namespace {
+
+constexpr double kTwoPi = 6.28318530717958647692;
+constexpr int kPosShift = Object::FP_SHIFT - 3; // Q9 -> 1/8 px
+constexpr int kVelShift = Object::FP_SHIFT - 6; // Q9 -> 1/64 px/s
+constexpr double kPosScale = 8.0;
+constexpr double kVelScale = 64.0;
+
+inline void put_u16(unsigned char*& p, uint16_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p += 2; }
+inline void put_u32(unsigned char*& p, uint32_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24); p += 4; }
+inline void put_i8(unsigned char*& p, int v) { *p++ = (unsigned char)(int8_t)v; }
+
+inline uint16_t get_u16(const unsigned char*& p) { uint16_t v = (uint16_t)(p[0] | (p[1] << 8)); p += 2; return v; }
+inline uint32_t get_u32(const unsigned char*& p) { uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); p += 4; return v; }
+inline int32_t get_i32(const unsigned char*& p) { return (int32_t)get_u32(p); }
+inline int get_i8(const unsigned char*& p) { return (int)(int8_t)*p++; }
+inline uint16_t sat_u16(uint32_t v) { return v > 0xFFFF ? (uint16_t)0xFFFF : (uint16_t)v; }
+
+// Rounded arithmetic shift of a Q9 value down to a coarser fixed point, saturated to int32
+inline uint32_t quantize(int64_t v, int shift) {
+    int64_t q = (v + ((int64_t)1 << (shift - 1))) >> shift;
+    if (q > INT32_MAX) q = INT32_MAX; else if (q < INT32_MIN) q = INT32_MIN;
+    return (uint32_t)(int32_t)q;
+}
+
+inline uint16_t quantize_angle(double theta) {
+    double t = theta / kTwoPi; t -= std::floor(t);
+    return (uint16_t)((uint32_t)std::lround(t * 65536.0) & 0xFFFFu);
+}
+
+inline uint16_t def_id(const Object& o) { return o.def ? (uint16_t)o.def->id : (uint16_t)0xFFFF; }
+
+inline uint32_t f32_bits(double v) { float f = (float)v; uint32_t u; std::memcpy(&u, &f, 4); return u; }
+inline double f32_value(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+
+inline uint32_t quantize_px(double v) {
+    double q = std::floor(v * kPosScale + 0.5);
+    if (q > INT32_MAX) q = INT32_MAX; else if (q < INT32_MIN) q = INT32_MIN;
+    return (uint32_t)(int32_t)q;
+}
+
+ShipRecord ship_record(uint64_t uid, const Ship& s)
+{
+    ShipRecord r;
+    r.uid = (uint32_t)uid; r.def = def_id(s); r.team = (int8_t)s.team; r.throttle = (int8_t)s.throttle;
+    r.x = (int32_t)quantize(s.x, kPosShift); r.y = (int32_t)quantize(s.y, kPosShift);
+    r.vx = (int32_t)quantize(s.vx, kVelShift); r.vy = (int32_t)quantize(s.vy, kVelShift);
+    r.theta = quantize_angle(s.theta); r.delta_v = f32_bits(s.delta_v); r.acc = f32_bits(s.lin_acc);
+    return r;
+}
+
+void write_object_record(unsigned char*& p, const Object& o)
+{
+    put_u16(p, def_id(o)); put_i8(p, o.team); *p++ = 0;
+    put_u32(p, quantize(o.x, kPosShift)); put_u32(p, quantize(o.y, kPosShift));
+    put_u32(p, quantize(o.vx, kVelShift)); put_u32(p, quantize(o.vy, kVelShift));
+    put_u16(p, quantize_angle(o.theta)); put_u16(p, 0);
+}
+
+} // anonymous
+
+void collect_ship_records(const std::map<uint64_t, Ship*>& uid_to_ship, std::vector<ShipRecord>& out)
+{
+    out.clear(); out.reserve(uid_to_ship.size());
+    for (const auto& kv : uid_to_ship) {
+        const Ship* s = kv.second;
+        if (s) out.push_back(ship_record(kv.first, *s));
+    }
+}
+
+void collect_ship_records(const InterestSelection& sel, std::vector<ShipRecord>& out)
+{
+    out.clear(); out.reserve(sel.ships.size());
+    for (const auto& us : sel.ships) out.push_back(ship_record(us.first, *us.second));
+}
+
+void write_ship_record(unsigned char*& p, const ShipRecord& r)
+{
+    put_u32(p, r.uid); put_u16(p, r.def); put_i8(p, r.team); put_i8(p, r.throttle);
+    put_u32(p, (uint32_t)r.x); put_u32(p, (uint32_t)r.y); put_u32(p, (uint32_t)r.vx); put_u32(p, (uint32_t)r.vy);
+    put_u16(p, r.theta); put_u16(p, 0);
+    put_u32(p, r.delta_v); put_u32(p, r.acc);
+}
+
+ShipRecord read_ship_record(const unsigned char*& p)
+{
+    ShipRecord r;
+    r.uid = get_u32(p); r.def = get_u16(p); r.team = (int8_t)get_i8(p); r.throttle = (int8_t)get_i8(p);
+    r.x = get_i32(p); r.y = get_i32(p); r.vx = get_i32(p); r.vy = get_i32(p);
+    r.theta = get_u16(p); p += 2;
+    r.delta_v = get_u32(p); r.acc = get_u32(p);
+    return r;
+}
+
+void write_summary_record(unsigned char*& p, const RegionSummary& r)
+{
+    put_i8(p, r.team); *p++ = 0; put_u16(p, sat_u16(r.ships)); put_u16(p, sat_u16(r.objects)); put_u16(p, 0);
+    put_u32(p, quantize_px(r.x)); put_u32(p, quantize_px(r.y));
+}
+
+RegionSummary read_summary_record(const unsigned char*& p)
+{
+    RegionSummary r;
+    r.team = get_i8(p); p += 1; r.ships = get_u16(p); r.objects = get_u16(p); p += 2;
+    r.x = get_i32(p) / kPosScale; r.y = get_i32(p) / kPosScale;
+    return r;
+}
+
+void write_stamp_record(unsigned char*& p, const StateStamp& s)
+{
+    uint64_t t; std::memcpy(&t, &s.sim_time, 8);
+    put_u32(p, (uint32_t)s.tick); put_u32(p, (uint32_t)(s.tick >> 32));
+    put_u32(p, (uint32_t)t); put_u32(p, (uint32_t)(t >> 32));
+}
+
+StateStamp read_stamp_record(const unsigned char*& p)
+{
+    StateStamp s;
+    s.tick = get_u32(p); s.tick |= (uint64_t)get_u32(p) << 32;
+    uint64_t t = get_u32(p); t |= (uint64_t)get_u32(p) << 32; std::memcpy(&s.sim_time, &t, 8);
+    s.valid = true;
+    return s;
+}
+
+void ship_record_to_view(const ShipRecord& r, NetObjectView& v)
+{
+    v.is_ship = true;
+    v.uid = r.uid; v.def = (r.def == 0xFFFF) ? -1 : (int)r.def;
+    v.team = r.team; v.throttle = r.throttle;
+    v.x = r.x / kPosScale; v.y = r.y / kPosScale;
+    v.vx = r.vx / kVelScale; v.vy = r.vy / kVelScale;
+    v.theta = r.theta * (kTwoPi / 65536.0);
+    v.delta_v = f32_value(r.delta_v); v.acc = f32_value(r.acc);
+}
+
+std::string build_state_frame(const std::map<uint64_t, Ship*>& uid_to_ship,
+                              const std::vector<std::unique_ptr<Object>>& objs,
+                              bool include_all, const StateStamp* stamp)
+{
+    size_t ns = 0; for (const auto& kv : uid_to_ship) if (kv.second) ++ns;
+    size_t no = 0; if (include_all) for (const auto& up : objs) if (up) ++no;
+    if (ns > 0xFFFF) ns = 0xFFFF;
+    if (no > 0xFFFF) no = 0xFFFF;
+    const size_t payload = (stamp ? kFrameStampSize : 0) + ns * kFrameShipSize + no * kFrameObjectSize;
+
+    std::string out(kFrameHeaderSize + payload, '\0');
+    unsigned char* p = (unsigned char*)&out[0];
+    *p++ = kFrameMagic; *p++ = kStateFrameVersion; *p++ = kFrameKindState;
+    *p++ = (uint8_t)((include_all ? kFrameFlagAll : 0) | (stamp ? kFrameFlagStamp : 0));
+    put_u32(p, (uint32_t)payload); put_u16(p, (uint16_t)ns); put_u16(p, (uint16_t)no); put_u32(p, 0);
+    if (stamp) write_stamp_record(p, *stamp);
+
+    std::vector<ShipRecord> ships; collect_ship_records(uid_to_ship, ships);
+    for (size_t i = 0; i < ns; ++i) write_ship_record(p, ships[i]);
+    size_t n = 0;
+    if (include_all) {
+        for (const auto& up : objs) {
+            const Object* o = up.get();
+            if (!o) continue;
+            if (n++ == no) break;
+            write_object_record(p, *o);
+        }
+    }
+    return out;
+}
+
+std::string build_state_frame(const InterestSelection& sel, const StateStamp* stamp)
+{
+    const size_t ns = std::min<size_t>(sel.ships.size(), 0xFFFF);
+    const size_t no = sel.include_all ? std::min<size_t>(sel.objects.size(), 0xFFFF) : 0;
+    const size_t nr = std::min<size_t>(sel.summaries.size(), 0xFFFF);
+    const size_t payload = (stamp ? kFrameStampSize : 0) + ns * kFrameShipSize + no * kFrameObjectSize + nr * kFrameSummarySize;
+
+    std::string out(kFrameHeaderSize + payload, '\0');
+    unsigned char* p = (unsigned char*)&out[0];
+    *p++ = kFrameMagic; *p++ = kStateFrameVersion; *p++ = kFrameKindState;
+    *p++ = (uint8_t)((sel.include_all ? kFrameFlagAll : 0) | kFrameFlagSummary | (stamp ? kFrameFlagStamp : 0));
+    put_u32(p, (uint32_t)payload); put_u16(p, (uint16_t)ns); put_u16(p, (uint16_t)no); put_u16(p, (uint16_t)nr); put_u16(p, 0);
+    if (stamp) write_stamp_record(p, *stamp);
+
+    for (size_t i = 0; i < ns; ++i) write_ship_record(p, ship_record(sel.ships[i].first, *sel.ships[i].second));
+    for (size_t i = 0; i < no; ++i) write_object_record(p, *sel.objects[i]);
+    for (size_t i = 0; i < nr; ++i) write_summary_record(p, sel.summaries[i]);
+    return out;
+}
+
+size_t frame_length(const char* data, size_t n)
+{
+    if (n < 4) return 0;
+    const size_t header = ((unsigned char)data[2] == kFrameKindState) ? kFrameHeaderSize : kDeltaHeaderSize;
+    if (n < header) return 0;
+    const unsigned char* p = (const unsigned char*)data + 4;
+    size_t total = header + get_u32(p);
+    return n >= total ? total : 0;
+}
+
+bool parse_state_frame(const char* data, size_t n, std::vector<NetObjectView>& out_objects,
+                       std::vector<RegionSummary>* summaries_out, StateStamp* stamp_out)
+{
+    out_objects.clear(); if (summaries_out) summaries_out->clear(); if (stamp_out) *stamp_out = StateStamp();
+    if (n < kFrameHeaderSize) return false;
+    const unsigned char* p = (const unsigned char*)data;
+    if (p[0] != kFrameMagic || p[1] != kStateFrameVersion || p[2] != kFrameKindState) return false;
+    const bool all = (p[3] & kFrameFlagAll) != 0;
+    const bool summary = (p[3] & kFrameFlagSummary) != 0;
+    const size_t stamp = (p[3] & kFrameFlagStamp) ? kFrameStampSize : 0;
+    p += 4;
+    uint32_t payload = get_u32(p); size_t ns = get_u16(p); size_t no = get_u16(p); size_t nr = get_u16(p); p += 2;
+    if (!all) no = 0;
+    if (!summary) nr = 0;
+    if (n < kFrameHeaderSize + payload || payload < stamp + ns * kFrameShipSize + no * kFrameObjectSize + nr * kFrameSummarySize) return false;
+    if (stamp) { StateStamp st = read_stamp_record(p); if (stamp_out) *stamp_out = st; }
+
+    out_objects.resize(ns + no);
+    for (size_t i = 0; i < ns; ++i) ship_record_to_view(read_ship_record(p), out_objects[i]);
+    for (size_t i = 0; i < no; ++i) {
+        NetObjectView& v = out_objects[ns + i];
+        uint16_t def = get_u16(p); v.def = (def == 0xFFFF) ? -1 : (int)def;
+        v.team = get_i8(p); p += 1;
+        v.x = get_i32(p) / kPosScale; v.y = get_i32(p) / kPosScale;
+        v.vx = get_i32(p) / kVelScale; v.vy = get_i32(p) / kVelScale;
+        v.theta = get_u16(p) * (kTwoPi / 65536.0); p += 2;
+    }
+    if (summaries_out) { summaries_out->resize(nr); for (size_t i = 0; i < nr; ++i) (*summaries_out)[i] = read_summary_record(p); }
+    return true;
+}
+
+} // namespace tcp_protocol
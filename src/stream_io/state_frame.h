@@ -0,0 +1,104 @@
+// Versioned binary state frames: the compact alternative to JSON state lines.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stream_io/tcp_protocol.h"
+
+class Object;
+class Ship;
+
+namespace tcp_protocol {
+
+// Capability a client lists in join "caps" to receive state as binary frames;
+// the joined reply echoes it as "state_format" when the engine agrees.
+constexpr const char* kCapBinaryState = "bin1";
+
+// Frames share the TCP stream with JSON lines. The first byte tells them
+// apart: JSON lines start with '{', frames with kFrameMagic.
+//
+// Header (16 bytes, little endian):
+//   u8 magic, u8 version, u8 kind, u8 flags, u32 payload bytes after the header,
+//   u16 ship count, u16 object count, u16 summary count, u16 reserved (0)
+// Stamp (16 bytes, only with kFrameFlagStamp; first in the payload of every
+// kind): u64 tick, f64 sim_time (see StateStamp)
+// Ship record (36 bytes):
+//   u32 uid, u16 def, i8 team, i8 throttle, i32 x, i32 y, i32 vx, i32 vy,
+//   u16 theta, u16 reserved, f32 delta_v, f32 acc
+// Object record (24 bytes, only with kFrameFlagAll):
+//   u16 def, i8 team, u8 reserved, i32 x, i32 y, i32 vx, i32 vy, u16 theta, u16 reserved
+// Summary record (16 bytes, only with kFrameFlagSummary; follows the objects):
+//   i8 team, u8 reserved, u16 ships, u16 objects, u16 reserved, i32 x, i32 y
+// Positions are 1/8 px, velocities 1/64 px/s, theta 2*pi/65536 rad; def
+// 0xFFFF means none. Values outside the int32 range saturate.
+constexpr uint8_t kFrameMagic = 0xF5;
+constexpr uint8_t kStateFrameVersion = 1;
+constexpr size_t kFrameHeaderSize = 16;
+constexpr size_t kFrameShipSize = 36;
+constexpr size_t kFrameObjectSize = 24;
+constexpr size_t kFrameSummarySize = 16;
+constexpr size_t kFrameStampSize = 16;
+constexpr uint8_t kFrameKindState = 1;
+constexpr uint8_t kFrameKindKeyframe = 2; // see delta_frame.h
+constexpr uint8_t kFrameKindDelta = 3;    // see delta_frame.h
+constexpr uint8_t kFrameKindCompressed = 4; // see lz_frame.h
+constexpr size_t kDeltaHeaderSize = 32;   // header size of keyframe/delta kinds
+constexpr uint8_t kFrameFlagAll = 1;     // frame carries the objects section
+constexpr uint8_t kFrameFlagSummary = 2; // frame carries region summaries (area of interest)
+constexpr uint8_t kFrameFlagStamp = 4;   // frame carries the stamp section
+
+// Quantized ship state exactly as a ship record carries it.
+struct ShipRecord {
+    uint32_t uid = 0;
+    uint16_t def = 0xFFFF;
+    int8_t team = 0;
+    int8_t throttle = 0;
+    int32_t x = 0, y = 0;   // 1/8 px
+    int32_t vx = 0, vy = 0; // 1/64 px/s
+    uint16_t theta = 0;     // 2*pi/65536 rad
+    uint32_t delta_v = 0;   // float32 bits
+    uint32_t acc = 0;       // float32 bits
+};
+
+// Quantize every ship in uid_to_ship (uid order) into out.
+void collect_ship_records(const std::map<uint64_t, Ship*>& uid_to_ship, std::vector<ShipRecord>& out);
+// Same for the ships of one client's area of interest.
+void collect_ship_records(const InterestSelection& sel, std::vector<ShipRecord>& out);
+
+// Write/read one kFrameShipSize record at p, advancing p.
+void write_ship_record(unsigned char*& p, const ShipRecord& r);
+ShipRecord read_ship_record(const unsigned char*& p);
+
+// Write/read one kFrameSummarySize record at p, advancing p (counts saturate).
+void write_summary_record(unsigned char*& p, const RegionSummary& r);
+RegionSummary read_summary_record(const unsigned char*& p);
+
+// Write/read the kFrameStampSize stamp section at p, advancing p.
+void write_stamp_record(unsigned char*& p, const StateStamp& s);
+StateStamp read_stamp_record(const unsigned char*& p);
+
+// Expand a record into the view the UI consumes.
+void ship_record_to_view(const ShipRecord& r, NetObjectView& v);
+
+// Encode the same content as build_state_json into one binary frame.
+std::string build_state_frame(const std::map<uint64_t, Ship*>& uid_to_ship,
+                              const std::vector<std::unique_ptr<Object>>& objs,
+                              bool include_all, const StateStamp* stamp = nullptr);
+// Frame for one client's area of interest, with a summary section.
+std::string build_state_frame(const InterestSelection& sel, const StateStamp* stamp = nullptr);
+
+// Bytes of the complete frame (any kind) at the start of data, 0 while the
+// header or payload is still incomplete. Call only when data[0] == kFrameMagic.
+size_t frame_length(const char* data, size_t n);
+
+// Decode a complete state frame into the same views parse_state_objects fills.
+// Returns false on a bad header, unknown version/kind or truncated records.
+bool parse_state_frame(const char* data, size_t n, std::vector<NetObjectView>& out_objects,
+                       std::vector<RegionSummary>* summaries_out = nullptr, StateStamp* stamp_out = nullptr);
+
+} // namespace tcp_protocol
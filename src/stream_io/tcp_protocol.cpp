@@ -1,6 +1,9 @@
 // Implementation depends on json-c, but only in this translation unit.
 
 #include "stream_io/tcp_protocol.h"
+#include "stream_io/interest.h"
+#include "stream_io/json_reader.h"
+#include "stream_io/json_writer.h"
 
 #include "file_io/json_interface.h" // JsonDoc, JsonView helpers
 
@@ -9,6 +12,12 @@
 
 #include <json-c/json.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
 using std::string;
 
 namespace tcp_protocol {
@@ -19,56 +28,98 @@ static inline string json_stringify_and_nl(json_object* o){
     return line;
 }
 
-std::string build_state_json(const std::map<uint64_t, Ship*>& uid_to_ship,
-                             const std::vector<std::unique_ptr<Object>>& objs,
-                             const std::string& defs_hash,
-                             bool include_all)
+static void write_ship(JsonWriter& w, uint64_t uid, const Ship* s)
 {
-    json_object* root = json_object_new_object();
-    json_object_object_add(root, "type", json_object_new_string("state"));
-    if (!defs_hash.empty()) json_object_object_add(root, "defs_hash", json_object_new_string(defs_hash.c_str()));
+    w.begin_object();
+    w.field("uid", uid);
+    w.field("x", s->x_pixels()).field("y", s->y_pixels());
+    w.field("vx", (double)s->vx / (double)Object::FP_ONE).field("vy", (double)s->vy / (double)Object::FP_ONE);
+    w.field("theta", (double)s->theta);
+    w.field("team", s->team).field("throttle", s->throttle);
+    w.field("delta_v", s->delta_v).field("acc", s->lin_acc);
+    if (s->def) w.field("def", (int)s->def->id);
+    w.end_object();
+}
 
-    json_object* ships = json_object_new_array();
-    for (const auto& kv : uid_to_ship) {
-        uint64_t uid = kv.first; const Ship* s = kv.second;
-        if (!s) continue;
-        json_object* js = json_object_new_object();
-        json_object_object_add(js, "uid", json_object_new_int64((long long)uid));
-        json_object_object_add(js, "x", json_object_new_double(s->x_pixels()));
-        json_object_object_add(js, "y", json_object_new_double(s->y_pixels()));
-        json_object_object_add(js, "vx", json_object_new_double((double)s->vx / (double)Object::FP_ONE));
-        json_object_object_add(js, "vy", json_object_new_double((double)s->vy / (double)Object::FP_ONE));
-        json_object_object_add(js, "theta", json_object_new_double(s->theta));
-        json_object_object_add(js, "team", json_object_new_int(s->team));
-        json_object_object_add(js, "throttle", json_object_new_int(s->throttle));
-        json_object_object_add(js, "delta_v", json_object_new_double(s->delta_v));
-        json_object_object_add(js, "acc", json_object_new_double(s->lin_acc));
-        if (s->def && !s->def->key.empty()) json_object_object_add(js, "object", json_object_new_string(s->def->key.c_str()));
-        json_object_array_add(ships, js);
-    }
-    json_object_object_add(root, "ships", ships);
+static void write_object(JsonWriter& w, const Object* o)
+{
+    w.begin_object();
+    if (o->def) w.field("def", (int)o->def->id);
+    w.field("x", o->x_pixels()).field("y", o->y_pixels());
+    w.field("vx", (double)o->vx / (double)Object::FP_ONE).field("vy", (double)o->vy / (double)Object::FP_ONE);
+    w.field("theta", (double)o->theta);
+    w.field("team", o->team);
+    w.end_object();
+}
 
+static void begin_state(JsonWriter& w, const std::string& defs_hash, const StateStamp* stamp)
+{
+    w.begin_object();
+    w.field("type", "state");
+    if (stamp) w.field("tick", stamp->tick).field("sim_time", stamp->sim_time);
+    if (!defs_hash.empty()) w.field("defs_hash", defs_hash);
+}
+
+void write_state_json(std::string& out,
+                      const std::map<uint64_t, Ship*>& uid_to_ship,
+                      const std::vector<std::unique_ptr<Object>>& objs,
+                      const std::string& defs_hash,
+                      bool include_all, const StateStamp* stamp)
+{
+    JsonWriter w(out);
+    begin_state(w, defs_hash, stamp);
+    w.key("ships").begin_array();
+    for (const auto& kv : uid_to_ship) if (kv.second) write_ship(w, kv.first, kv.second);
+    w.end_array();
     if (include_all) {
-        json_object* arr = json_object_new_array();
-        for (const auto& up : objs) {
-            const Object* o = up.get(); if (!o) continue;
-            json_object* jo = json_object_new_object();
-            const char* t = (o->type == Object::SHIP ? "ship" : (o->type == Object::PLANET ? "planet" : (o->type == Object::PROJECTILE ? "projectile" : "body")));
-            json_object_object_add(jo, "type", json_object_new_string(t));
-            json_object_object_add(jo, "x", json_object_new_double(o->x_pixels()));
-            json_object_object_add(jo, "y", json_object_new_double(o->y_pixels()));
-            json_object_object_add(jo, "vx", json_object_new_double((double)o->vx / (double)Object::FP_ONE));
-            json_object_object_add(jo, "vy", json_object_new_double((double)o->vy / (double)Object::FP_ONE));
-            json_object_object_add(jo, "theta", json_object_new_double(o->theta));
-            json_object_object_add(jo, "team", json_object_new_int(o->team));
-            if (o->def && !o->def->key.empty()) json_object_object_add(jo, "object", json_object_new_string(o->def->key.c_str()));
-            json_object_array_add(arr, jo);
-        }
-        json_object_object_add(root, "objects", arr);
+        w.key("objects").begin_array();
+        for (const auto& up : objs) if (up) write_object(w, up.get());
+        w.end_array();
+    }
+    w.end_object();
+    w.newline();
+}
+
+void write_state_json(std::string& out, const InterestSelection& sel, const std::string& defs_hash,
+                      const StateStamp* stamp)
+{
+    JsonWriter w(out);
+    begin_state(w, defs_hash, stamp);
+    w.key("ships").begin_array();
+    for (const auto& us : sel.ships) write_ship(w, us.first, us.second);
+    w.end_array();
+    if (sel.include_all) {
+        w.key("objects").begin_array();
+        for (const Object* o : sel.objects) write_object(w, o);
+        w.end_array();
     }
+    w.key("summary").begin_array();
+    for (const RegionSummary& r : sel.summaries) {
+        w.begin_object();
+        w.field("team", r.team).field("x", r.x).field("y", r.y).field("ships", (uint64_t)r.ships);
+        if (r.objects) w.field("objects", (uint64_t)r.objects);
+        w.end_object();
+    }
+    w.end_array();
+    w.end_object();
+    w.newline();
+}
+
+std::string build_state_json(const std::map<uint64_t, Ship*>& uid_to_ship,
+                             const std::vector<std::unique_ptr<Object>>& objs,
+                             const std::string& defs_hash,
+                             bool include_all, const StateStamp* stamp)
+{
+    string out;
+    write_state_json(out, uid_to_ship, objs, defs_hash, include_all, stamp);
+    return out;
+}
 
-    string out = json_stringify_and_nl(root);
-    json_object_put(root);
+std::string build_state_json(const InterestSelection& sel, const std::string& defs_hash,
+                             const StateStamp* stamp)
+{
+    string out;
+    write_state_json(out, sel, defs_hash, stamp);
     return out;
 }
 
@@ -82,63 +133,235 @@ std::string build_reply(const char* type, const char* msg)
     return out;
 }
 
-std::string build_joined_reply(const std::string& defs_hash, const bool* match_ptr)
+std::string build_joined_reply(const JoinedReply& r)
 {
     json_object* o = json_object_new_object();
     json_object_object_add(o, "type", json_object_new_string("joined"));
     json_object_object_add(o, "msg", json_object_new_string("ok"));
-    if (!defs_hash.empty()) json_object_object_add(o, "defs_hash", json_object_new_string(defs_hash.c_str()));
-    if (match_ptr) json_object_object_add(o, "match", json_object_new_boolean(*match_ptr));
+    if (!r.defs_hash.empty()) json_object_object_add(o, "defs_hash", json_object_new_string(r.defs_hash.c_str()));
+    if (r.has_match) json_object_object_add(o, "match", json_object_new_boolean(r.match));
+    if (!r.def_keys.empty()) {
+        json_object* arr = json_object_new_array();
+        for (const auto& k : r.def_keys) json_object_array_add(arr, json_object_new_string(k.c_str()));
+        json_object_object_add(o, "defs", arr);
+    }
+    if (!r.state_format.empty()) json_object_object_add(o, "state_format", json_object_new_string(r.state_format.c_str()));
+    if (r.udp_token) json_object_object_add(o, "udp_token", json_object_new_int64((int64_t)r.udp_token));
+    if (!r.shm_name.empty()) json_object_object_add(o, "shm_name", json_object_new_string(r.shm_name.c_str()));
+    if (!r.compression.empty()) json_object_object_add(o, "compression", json_object_new_string(r.compression.c_str()));
+    if (r.resume_token) json_object_object_add(o, "resume_token", json_object_new_int64((int64_t)r.resume_token));
+    if (r.resumed) {
+        json_object_object_add(o, "resumed", json_object_new_boolean(1));
+        json_object* arr = json_object_new_array();
+        for (const auto& c : r.pending) json_object_array_add(arr, json_object_new_string(c.c_str()));
+        json_object_object_add(o, "pending", arr);
+    }
     string out = json_stringify_and_nl(o);
     json_object_put(o);
     return out;
 }
 
-bool parse_client_message(const std::string& line, ClientMsg& out, std::string* err)
+std::string build_tick_status(const TickStatus& ts)
 {
-    out = ClientMsg{};
-    JsonDoc doc(json_tokener_parse(line.c_str()));
-    if (!doc.valid()) { if (err) *err = "bad json"; return false; }
-    JsonView root(doc.get());
-    if (!root.is_object()) { if (err) *err = "bad json"; return false; }
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("tick_status"));
+    // JSON has no infinity; max speed is spelled out
+    if (std::isinf(ts.scale)) json_object_object_add(o, "scale", json_object_new_string("max"));
+    else json_object_object_add(o, "scale", json_object_new_double(ts.scale));
+    json_object_object_add(o, "tick_rate", json_object_new_double(ts.tick_rate));
+    json_object_object_add(o, "sim_time", json_object_new_double(ts.sim_time));
+    json_object_object_add(o, "ticks", json_object_new_int64((int64_t)ts.ticks));
+    json_object_object_add(o, "steps", json_object_new_int64((int64_t)ts.steps));
+    json_object_object_add(o, "catchup_overruns", json_object_new_int64((int64_t)ts.catchup_overruns));
+    json_object_object_add(o, "work_overruns", json_object_new_int64((int64_t)ts.work_overruns));
+    json_object_object_add(o, "dropped_sim_time", json_object_new_double(ts.dropped_sim_time));
+    json_object_object_add(o, "jitter_avg_ms", json_object_new_double(ts.jitter_avg_ms));
+    json_object_object_add(o, "jitter_max_ms", json_object_new_double(ts.jitter_max_ms));
+    json_object_object_add(o, "dropped_snapshots", json_object_new_int64((int64_t)ts.dropped_snapshots));
+    json_object_object_add(o, "net_queued_bytes", json_object_new_int64((int64_t)ts.net_queued_bytes));
+    json_object_object_add(o, "net_dropped_bytes", json_object_new_int64((int64_t)ts.net_dropped_bytes));
+    json_object_object_add(o, "net_dropped_frames", json_object_new_int64((int64_t)ts.net_dropped_frames));
+    string out = json_stringify_and_nl(o);
+    json_object_put(o);
+    return out;
+}
+
+double trace_clock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string build_trace(const CmdTrace& tr)
+{
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("trace"));
+    json_object_object_add(o, "id", json_object_new_int64((int64_t)tr.id));
+    json_object_object_add(o, "t_send", json_object_new_double(tr.t_send));
+    json_object_object_add(o, "t_recv", json_object_new_double(tr.t_recv));
+    json_object_object_add(o, "t_queued", json_object_new_double(tr.t_queued));
+    json_object_object_add(o, "t_applied", json_object_new_double(tr.t_applied));
+    json_object_object_add(o, "t_broadcast", json_object_new_double(tr.t_broadcast));
+    json_object_object_add(o, "applied_tick", json_object_new_int64((int64_t)tr.applied_tick));
+    json_object_object_add(o, "broadcast_tick", json_object_new_int64((int64_t)tr.broadcast_tick));
+    string out = json_stringify_and_nl(o);
+    json_object_put(o);
+    return out;
+}
 
-    std::string type;
-    if (!root.get_string("type", type)) { if (err) *err = "missing type"; return false; }
+// Members of the client message schemas, collected in one pass over the
+// line and interpreted once "type" is known (it may come in any position)
+namespace {
+struct ClientFields {
+    JsonReader::Value type, defs_hash, team, caps, scope, cmd, uid, value, theta, cancel, steps, scale, seq, x, y, r, wait, t, role, delay, rate, max_bps, session, compress_min, trace, t_send, resume;
 
-    if (type == "join") {
+    void set(std::string_view k, const JsonReader::Value& v) {
+        static const struct { std::string_view name; JsonReader::Value ClientFields::* field; } kFields[] = {
+            {"type", &ClientFields::type}, {"uid", &ClientFields::uid}, {"cmd", &ClientFields::cmd},
+            {"value", &ClientFields::value}, {"theta", &ClientFields::theta}, {"wait", &ClientFields::wait},
+            {"seq", &ClientFields::seq}, {"x", &ClientFields::x}, {"y", &ClientFields::y}, {"r", &ClientFields::r},
+            {"team", &ClientFields::team}, {"defs_hash", &ClientFields::defs_hash}, {"caps", &ClientFields::caps},
+            {"scope", &ClientFields::scope}, {"cancel", &ClientFields::cancel}, {"steps", &ClientFields::steps},
+            {"scale", &ClientFields::scale}, {"t", &ClientFields::t}, {"role", &ClientFields::role},
+            {"delay", &ClientFields::delay}, {"rate", &ClientFields::rate},
+            {"session", &ClientFields::session}, {"max_bps", &ClientFields::max_bps},
+            {"compress_min", &ClientFields::compress_min}, {"trace", &ClientFields::trace}, {"t_send", &ClientFields::t_send},
+            {"resume", &ClientFields::resume},
+        };
+        for (const auto& f : kFields) if (f.name == k) { this->*f.field = v; return; }
+    }
+};
+} // namespace
+
+// Name and argument of a cmd message or plan step
+static bool read_cmd(const JsonReader::Value& name, const JsonReader::Value& value, const JsonReader::Value& theta,
+                     ClientCmd& cmd, std::string* err)
+{
+    if (!name.get(cmd.name)) { if (err) *err = "missing cmd"; return false; }
+    if (cmd.name == "THROTTLE") {
+        if (!value.get(cmd.value)) { if (err) *err = "missing value"; return false; }
+    } else if (cmd.name == "HEADING" || cmd.name == "FIRE") {
+        if (!theta.get(cmd.theta)) { if (err) *err = "missing theta"; return false; }
+    } else {
+        if (err) *err = "unknown cmd";
+        return false;
+    }
+    return true;
+}
+
+bool parse_client_message(const char* line, ClientMsg& out, std::string* err)
+{
+    out = ClientMsg{};
+    ClientFields f;
+    JsonReader rd(line, line + std::strlen(line));
+    if (!rd.object([&](std::string_view k, const JsonReader::Value& v) { f.set(k, v); }) || !rd.at_end()) {
+        if (err) *err = "bad json";
+        return false;
+    }
+    if (!f.type.is_string()) { if (err) *err = "missing type"; return false; }
+
+    if (f.type.equals("cmd")) {
+        out.type = ClientMsgType::Cmd;
+        // uids are read exactly; older clients may still send them as doubles
+        if (!f.uid.present()) { if (err) *err = "missing uid"; return false; }
+        if (!f.uid.get(out.cmd.uid)) { if (err) *err = "bad uid"; return false; }
+        if (f.trace.present()) {
+            int64_t id = 0;
+            if (!f.trace.get(id) || id < 0 || id > (int64_t)std::numeric_limits<uint32_t>::max() || !f.t_send.get(out.t_send)) { if (err) *err = "bad trace"; return false; }
+            out.trace = (uint32_t)id;
+        }
+        return read_cmd(f.cmd, f.value, f.theta, out.cmd, err);
+    }
+    if (f.type.equals("end_turn")) {
+        out.type = ClientMsgType::EndTurn;
+        (void)f.wait.get(out.wait);
+        return true;
+    }
+    if (f.type.equals("state_ack")) {
+        out.type = ClientMsgType::StateAck;
+        int64_t seq = 0;
+        if (!f.seq.get(seq)) { if (err) *err = "missing seq"; return false; }
+        if (seq < 0 || seq > (int64_t)std::numeric_limits<uint32_t>::max()) { if (err) *err = "bad seq"; return false; }
+        out.seq = (uint32_t)seq;
+        return true;
+    }
+    if (f.type.equals("view")) {
+        out.type = ClientMsgType::View;
+        if (!f.x.get(out.view_x) || !f.y.get(out.view_y)) { if (err) *err = "missing x/y"; return false; }
+        if (f.r.present() && !f.r.get(out.view_r)) { if (err) *err = "bad view"; return false; }
+        if (!std::isfinite(out.view_x) || !std::isfinite(out.view_y) || !std::isfinite(out.view_r)) { if (err) *err = "bad view"; return false; }
+        return true;
+    }
+    if (f.type.equals("join")) {
         out.type = ClientMsgType::Join;
-        (void)root.get_string("defs_hash", out.defs_hash);
-        JsonView t; if (root.get_view("team", t)) out.team = json_object_get_int(t.p);
+        (void)f.defs_hash.get(out.defs_hash);
+        if (f.team.present()) {
+            int64_t team = -1;
+            if (!f.team.get(team) || team < std::numeric_limits<int>::min() || team > std::numeric_limits<int>::max()) { if (err) *err = "bad team"; return false; }
+            out.team = (int)team;
+        }
+        if (f.session.present()) {
+            int64_t session = -1;
+            if (!f.session.get(session) || session < 0 || session > std::numeric_limits<int>::max()) { if (err) *err = "bad session"; return false; }
+            out.session = (int)session;
+        }
+        if (f.caps.kind == JsonReader::kArray) {
+            JsonReader caps(f.caps.begin, f.caps.end);
+            caps.array([&](const JsonReader::Value& c) { std::string s; if (c.get(s)) out.caps.push_back(std::move(s)); });
+        }
+        if ((f.rate.present() && !f.rate.get(out.rate)) || (f.max_bps.present() && !f.max_bps.get(out.max_bps)) ||
+            !std::isfinite(out.rate) || !std::isfinite(out.max_bps)) { if (err) *err = "bad rate"; return false; }
+        if (f.compress_min.present()) {
+            int64_t n = 0;
+            if (!f.compress_min.get(n) || n < 0 || n > (int64_t)std::numeric_limits<uint32_t>::max()) { if (err) *err = "bad compress_min"; return false; }
+            out.compress_min = (uint32_t)n;
+        }
+        if (f.resume.present() && (!f.resume.get(out.resume) || out.resume == 0)) { if (err) *err = "bad resume"; return false; }
+        if (f.role.present() && !f.role.equals("player")) {
+            if (!f.role.equals("spectator")) { if (err) *err = "unknown role"; return false; }
+            out.spectator = true;
+            if ((f.delay.present() && !f.delay.get(out.delay)) || !(out.delay >= 0.0) || !std::isfinite(out.delay)) { if (err) *err = "bad spectator options"; return false; }
+        }
         return true;
     }
-    if (type == "state_req") {
+    if (f.type.equals("state_req")) {
         out.type = ClientMsgType::StateReq;
-        (void)root.get_string("scope", out.scope);
+        (void)f.scope.get(out.scope);
         return true;
     }
-    if (type == "cmd") {
-        out.type = ClientMsgType::Cmd;
-        if (!root.get_string("cmd", out.cmd.name)) { if (err) *err = "missing cmd"; return false; }
-        // uid can be int or double in prior protocol; always read as double then cast.
-        JsonView vuid; if (!root.get_view("uid", vuid)) { if (err) *err = "missing uid"; return false; }
-        out.cmd.uid = (uint64_t)json_object_get_double(vuid.p);
-        if (out.cmd.name == "THROTTLE") {
-            if (!root.get_view("value", vuid)) { if (err) *err = "missing value"; return false; }
-            out.cmd.value = json_object_get_double(vuid.p);
-        } else if (out.cmd.name == "HEADING" || out.cmd.name == "FIRE") {
-            if (!root.get_view("theta", vuid)) { if (err) *err = "missing theta"; return false; }
-            out.cmd.theta = json_object_get_double(vuid.p);
-        } else {
-            if (err) *err = "unknown cmd";
+    if (f.type.equals("plan")) {
+        out.type = ClientMsgType::Plan;
+        if (!f.uid.present()) { if (err) *err = "missing uid"; return false; }
+        if (!f.uid.get(out.cmd.uid)) { if (err) *err = "bad uid"; return false; }
+        const bool cancel = f.cancel.kind == JsonReader::kTrue;
+        if (cancel || !f.steps.present()) return true;
+        if (f.steps.kind != JsonReader::kArray) { if (err) *err = "bad steps"; return false; }
+        bool ok = true;
+        JsonReader steps(f.steps.begin, f.steps.end);
+        steps.array([&](const JsonReader::Value& it) {
+            if (!ok) return;
+            if (out.plan.size() >= kMaxPlanSteps) { if (err) *err = "plan too long"; ok = false; return; }
+            ClientFields sf;
+            JsonReader step(it.begin, it.end);
+            ClientPlanStep st;
+            if (it.kind != JsonReader::kObject || !step.object([&](std::string_view k, const JsonReader::Value& v) { sf.set(k, v); })
+                || !sf.t.get(st.t) || !std::isfinite((float)st.t) || !sf.cmd.is_string()) { if (err) *err = "bad plan step"; ok = false; return; }
+            if (!read_cmd(sf.cmd, sf.value, sf.theta, st.cmd, err)) { ok = false; return; }
+            out.plan.push_back(std::move(st));
+        });
+        return ok;
+    }
+    if (f.type.equals("time_scale")) {
+        out.type = ClientMsgType::TimeScale;
+        if (!f.scale.present()) return true; // query only
+        if (f.scale.is_string()) {
+            if (!f.scale.equals("max")) { if (err) *err = "bad scale"; return false; }
+            out.scale = std::numeric_limits<double>::infinity();
+        } else if (!f.scale.get(out.scale) || !(out.scale >= 0.0)) {
+            if (err) { *err = "bad scale"; }
             return false;
         }
         return true;
     }
-    if (type == "end_turn") {
-        out.type = ClientMsgType::EndTurn;
-        JsonView v; if (root.get_view("wait", v)) out.wait = json_object_get_double(v.p);
-        return true;
-    }
 
     out.type = ClientMsgType::Unknown;
     if (err) *err = "unknown type";
@@ -147,13 +370,23 @@ bool parse_client_message(const std::string& line, ClientMsg& out, std::string*
 
 // -------------------- Client-side builders --------------------
 
-std::string build_join(const char* name, const char* defs_hash_opt, int team)
+std::string build_join(const JoinRequest& j)
 {
     json_object* o = json_object_new_object();
     json_object_object_add(o, "type", json_object_new_string("join"));
-    if (name) json_object_object_add(o, "name", json_object_new_string(name));
-    if (defs_hash_opt && defs_hash_opt[0]) json_object_object_add(o, "defs_hash", json_object_new_string(defs_hash_opt));
-    json_object_object_add(o, "team", json_object_new_int(team));
+    if (!j.name.empty()) json_object_object_add(o, "name", json_object_new_string(j.name.c_str()));
+    if (!j.defs_hash.empty()) json_object_object_add(o, "defs_hash", json_object_new_string(j.defs_hash.c_str()));
+    json_object_object_add(o, "team", json_object_new_int(j.team));
+    if (j.session >= 0) json_object_object_add(o, "session", json_object_new_int(j.session));
+    if (j.rate > 0.0) json_object_object_add(o, "rate", json_object_new_double(j.rate));
+    if (j.max_bps > 0.0) json_object_object_add(o, "max_bps", json_object_new_double(j.max_bps));
+    if (j.compress_min > 0) json_object_object_add(o, "compress_min", json_object_new_int64((int64_t)j.compress_min));
+    if (j.resume_token) json_object_object_add(o, "resume", json_object_new_int64((int64_t)j.resume_token));
+    if (!j.caps.empty()) {
+        json_object* arr = json_object_new_array();
+        for (const auto& c : j.caps) json_object_array_add(arr, json_object_new_string(c.c_str()));
+        json_object_object_add(o, "caps", arr);
+    }
     string out = json_stringify_and_nl(o); json_object_put(o); return out;
 }
 
@@ -165,7 +398,7 @@ std::string build_state_req(const char* scope)
     string out = json_stringify_and_nl(o); json_object_put(o); return out;
 }
 
-std::string build_cmd(const char* cmd, uint64_t uid, double value_or_theta, bool is_theta)
+std::string build_cmd(const char* cmd, uint64_t uid, double value_or_theta, bool is_theta, uint32_t trace, double t_send)
 {
     json_object* o = json_object_new_object();
     json_object_object_add(o, "type", json_object_new_string("cmd"));
@@ -173,6 +406,10 @@ std::string build_cmd(const char* cmd, uint64_t uid, double value_or_theta, bool
     json_object_object_add(o, "uid", json_object_new_int64((long long)uid));
     if (is_theta) json_object_object_add(o, "theta", json_object_new_double(value_or_theta));
     else json_object_object_add(o, "value", json_object_new_double(value_or_theta));
+    if (trace) {
+        json_object_object_add(o, "trace", json_object_new_int64((int64_t)trace));
+        json_object_object_add(o, "t_send", json_object_new_double(t_send));
+    }
     string out = json_stringify_and_nl(o); json_object_put(o); return out;
 }
 
@@ -184,14 +421,79 @@ std::string build_end_turn(double wait_seconds)
     string out = json_stringify_and_nl(o); json_object_put(o); return out;
 }
 
-bool parse_state_objects(const std::string& line, std::vector<NetObjectView>& out_objects, std::string* defs_hash_out)
+std::string build_plan(uint64_t uid, const std::vector<ClientPlanStep>& steps)
+{
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("plan"));
+    json_object_object_add(o, "uid", json_object_new_int64((long long)uid));
+    if (steps.empty()) json_object_object_add(o, "cancel", json_object_new_boolean(1));
+    json_object* arr = json_object_new_array();
+    for (const auto& st : steps) {
+        json_object* js = json_object_new_object();
+        json_object_object_add(js, "t", json_object_new_double(st.t));
+        json_object_object_add(js, "cmd", json_object_new_string(st.cmd.name.c_str()));
+        if (st.cmd.name == "THROTTLE") json_object_object_add(js, "value", json_object_new_double(st.cmd.value));
+        else json_object_object_add(js, "theta", json_object_new_double(st.cmd.theta));
+        json_object_array_add(arr, js);
+    }
+    json_object_object_add(o, "steps", arr);
+    string out = json_stringify_and_nl(o); json_object_put(o); return out;
+}
+
+std::string build_time_scale(double scale)
+{
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("time_scale"));
+    if (std::isinf(scale)) json_object_object_add(o, "scale", json_object_new_string("max"));
+    else if (scale >= 0.0) json_object_object_add(o, "scale", json_object_new_double(scale));
+    string out = json_stringify_and_nl(o); json_object_put(o); return out;
+}
+
+std::string build_state_ack(uint32_t seq)
 {
-    out_objects.clear(); if (defs_hash_out) defs_hash_out->clear();
-    JsonDoc doc(json_tokener_parse(line.c_str())); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("state_ack"));
+    json_object_object_add(o, "seq", json_object_new_int64((int64_t)seq));
+    string out = json_stringify_and_nl(o); json_object_put(o); return out;
+}
+
+std::string build_view(double x, double y, double r)
+{
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("view"));
+    json_object_object_add(o, "x", json_object_new_double(x));
+    json_object_object_add(o, "y", json_object_new_double(y));
+    json_object_object_add(o, "r", json_object_new_double(r));
+    string out = json_stringify_and_nl(o); json_object_put(o); return out;
+}
+
+std::string build_spectate(double delay, double rate, const std::vector<std::string>* caps)
+{
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "type", json_object_new_string("join"));
+    json_object_object_add(o, "role", json_object_new_string("spectator"));
+    if (delay > 0.0) json_object_object_add(o, "delay", json_object_new_double(delay));
+    if (rate > 0.0) json_object_object_add(o, "rate", json_object_new_double(rate));
+    if (caps && !caps->empty()) {
+        json_object* arr = json_object_new_array();
+        for (const auto& c : *caps) json_object_array_add(arr, json_object_new_string(c.c_str()));
+        json_object_object_add(o, "caps", arr);
+    }
+    string out = json_stringify_and_nl(o); json_object_put(o); return out;
+}
+
+bool parse_state_objects(const char* line, std::vector<NetObjectView>& out_objects, std::string* defs_hash_out,
+                         std::vector<RegionSummary>* summaries_out, StateStamp* stamp_out)
+{
+    out_objects.clear(); if (defs_hash_out) defs_hash_out->clear(); if (summaries_out) summaries_out->clear();
+    if (stamp_out) *stamp_out = StateStamp();
+    JsonDoc doc(json_tokener_parse(line)); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
     std::string type; if (!root.get_string("type", type)) return false; if (type != "state") return false;
     if (defs_hash_out) (void)root.get_string("defs_hash", *defs_hash_out);
+    int64_t tick = 0;
+    if (stamp_out && root.get_int64("tick", tick) && root.get_double("sim_time", stamp_out->sim_time)) { stamp_out->tick = (uint64_t)tick; stamp_out->valid = true; }
 
-    auto parse_items = [&](json_object* arr, const char* force_type){
+    auto parse_items = [&](json_object* arr, bool ships){
         if (!arr || !json_object_is_type(arr, json_type_array)) return;
         size_t n = json_object_array_length(arr);
         out_objects.reserve(out_objects.size() + n);
@@ -199,8 +501,9 @@ bool parse_state_objects(const std::string& line, std::vector<NetObjectView>& ou
             json_object* it = json_object_array_get_idx(arr, i);
             if (!it || !json_object_is_type(it, json_type_object)) continue;
             NetObjectView o{}; json_object* v=nullptr;
-            if (force_type) o.type = force_type; else if (json_object_object_get_ex(it, "type", &v) && json_object_is_type(v, json_type_string)) o.type = json_object_get_string(v); else o.type = "ship";
-            if (json_object_object_get_ex(it, "object", &v) && json_object_is_type(v, json_type_string)) o.object_key = json_object_get_string(v);
+            o.is_ship = ships;
+            if (json_object_object_get_ex(it, "def", &v)) o.def = json_object_get_int(v);
+            else if (json_object_object_get_ex(it, "object", &v) && json_object_is_type(v, json_type_string)) o.object_key = json_object_get_string(v);
             if (json_object_object_get_ex(it, "uid", &v)) o.uid = (uint64_t)json_object_get_int64(v);
             if (json_object_object_get_ex(it, "team", &v)) o.team = json_object_get_int(v);
             if (json_object_object_get_ex(it, "throttle", &v)) o.throttle = json_object_get_int(v);
@@ -216,20 +519,71 @@ bool parse_state_objects(const std::string& line, std::vector<NetObjectView>& ou
     };
 
     json_object* jships=nullptr; json_object* jobjs=nullptr;
-    if (json_object_object_get_ex(root.p, "ships", &jships)) parse_items(jships, "ship");
-    if (json_object_object_get_ex(root.p, "objects", &jobjs)) parse_items(jobjs, nullptr);
+    if (json_object_object_get_ex(root.p, "ships", &jships)) parse_items(jships, true);
+    if (json_object_object_get_ex(root.p, "objects", &jobjs)) parse_items(jobjs, false);
+    JsonView sum; if (summaries_out && root.get_view("summary", sum) && sum.is_array()) {
+        size_t n = sum.length(); summaries_out->reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            JsonView it = sum.index(i); if (!it.is_object()) continue;
+            RegionSummary r; double d = 0.0;
+            JsonView v; if (it.get_view("team", v)) r.team = json_object_get_int(v.p);
+            (void)it.get_double("x", r.x); (void)it.get_double("y", r.y);
+            if (it.get_double("ships", d)) r.ships = (uint32_t)d;
+            if (it.get_double("objects", d)) r.objects = (uint32_t)d;
+            summaries_out->push_back(r);
+        }
+    }
     return true;
 }
 
-bool parse_joined(const std::string& line, std::string* defs_hash_out, bool* has_match_out, bool* match_out)
+bool parse_joined(const char* line, JoinedReply& out)
 {
-    if (defs_hash_out) defs_hash_out->clear();
-    if (has_match_out) *has_match_out=false;
-    if (match_out) *match_out=false;
-    JsonDoc doc(json_tokener_parse(line.c_str())); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
+    out = JoinedReply();
+    JsonDoc doc(json_tokener_parse(line)); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
     std::string type; if (!root.get_string("type", type)) return false; if (type != "joined") return false;
-    if (defs_hash_out) (void)root.get_string("defs_hash", *defs_hash_out);
-    JsonView v; if (root.get_view("match", v)) { if (has_match_out) *has_match_out=true; if (match_out) *match_out = json_object_get_boolean(v.p); }
+    (void)root.get_string("defs_hash", out.defs_hash);
+    JsonView v; if (root.get_view("match", v)) { out.has_match = true; out.match = json_object_get_boolean(v.p); }
+    JsonView defs; if (root.get_view("defs", defs) && defs.is_array()) {
+        size_t n = defs.length(); out.def_keys.reserve(n);
+        for (size_t i = 0; i < n; ++i) { JsonView k = defs.index(i); out.def_keys.push_back(json_object_is_type(k.p, json_type_string) ? json_object_get_string(k.p) : ""); }
+    }
+    (void)root.get_string("state_format", out.state_format);
+    int64_t token = 0; if (root.get_int64("udp_token", token)) out.udp_token = (uint64_t)token;
+    (void)root.get_string("shm_name", out.shm_name);
+    (void)root.get_string("compression", out.compression);
+    int64_t resume = 0; if (root.get_int64("resume_token", resume)) out.resume_token = (uint64_t)resume;
+    (void)root.get_bool("resumed", out.resumed);
+    JsonView pending; if (root.get_view("pending", pending) && pending.is_array()) {
+        size_t n = pending.length();
+        for (size_t i = 0; i < n; ++i) { JsonView c = pending.index(i); if (json_object_is_type(c.p, json_type_string)) out.pending.push_back(json_object_get_string(c.p)); }
+    }
+    return true;
+}
+
+bool parse_trace(const char* line, CmdTrace& out)
+{
+    out = CmdTrace();
+    JsonDoc doc(json_tokener_parse(line)); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
+    std::string type; if (!root.get_string("type", type)) return false; if (type != "trace") return false;
+    int64_t id = 0, applied = 0, broadcast = 0;
+    if (!root.get_int64("id", id)) return false;
+    out.id = (uint32_t)id;
+    (void)root.get_double("t_send", out.t_send); (void)root.get_double("t_recv", out.t_recv);
+    (void)root.get_double("t_queued", out.t_queued); (void)root.get_double("t_applied", out.t_applied);
+    (void)root.get_double("t_broadcast", out.t_broadcast);
+    if (root.get_int64("applied_tick", applied)) out.applied_tick = (uint64_t)applied;
+    if (root.get_int64("broadcast_tick", broadcast)) out.broadcast_tick = (uint64_t)broadcast;
+    return true;
+}
+
+bool parse_reply(const char* line, std::string* type_out, std::string* msg_out)
+{
+    if (type_out) type_out->clear();
+    if (msg_out) msg_out->clear();
+    JsonDoc doc(json_tokener_parse(line)); if (!doc.valid()) return false; JsonView root(doc.get()); if (!root.is_object()) return false;
+    std::string type; if (!root.get_string("type", type)) return false; if (type != "ack" && type != "error") return false;
+    if (type_out) *type_out = type;
+    if (msg_out) (void)root.get_string("msg", *msg_out);
     return true;
 }
 
@@ -15,7 +15,7 @@ class Ship;
 
 namespace tcp_protocol {
 
-enum class ClientMsgType { Unknown, Join, StateReq, Cmd, EndTurn };
+enum class ClientMsgType { Unknown, Join, StateReq, Cmd, EndTurn, Plan, TimeScale, StateAck, View };
 
 struct ClientCmd {
     std::string name;    // "THROTTLE", "HEADING", "FIRE"
@@ -24,43 +24,193 @@ struct ClientCmd {
     double theta = 0.0;  // for HEADING/FIRE
 };
 
+struct ClientPlanStep {
+    double t = 0.0;      // seconds after the plan is attached
+    ClientCmd cmd;       // name + value/theta; uid unused
+};
+
+// Upper bound on steps accepted in one plan message.
+constexpr size_t kMaxPlanSteps = 1024;
+
 struct ClientMsg {
     ClientMsgType type = ClientMsgType::Unknown;
     std::string scope;       // for state_req
     std::string defs_hash;   // for join
-    ClientCmd cmd;           // for cmd
+    ClientCmd cmd;           // for cmd; plan uses cmd.uid
+    std::vector<ClientPlanStep> plan; // for plan (empty cancels)
     double wait = 0.0;       // for end_turn (seconds)
     int team = -1;           // for join
+    int session = -1;        // for join: hosted world to play in (-1: the connection's current one)
+    std::vector<std::string> caps; // for join: optional capabilities (e.g. binary state)
+    bool spectator = false;  // for join: role "spectator" (read-only, never has a turn)
+    double delay = 0.0;      // for spectator join: seconds behind live
+    double rate = 0.0;       // for join: states per second (<= 0: every broadcast)
+    double max_bps = 0.0;    // for join: state bytes per second at most (<= 0: no cap)
+    uint32_t compress_min = 0; // for join: smallest state message to compress (0: engine default)
+    uint64_t resume = 0;     // for join: resume token of a dropped session to take over (0: none)
+    double scale = -1.0;     // for time_scale: < 0 only queries (setting needs a team), infinity is "max"
+    uint32_t seq = 0;        // for state_ack: last keyframe/delta frame decoded
+    uint32_t trace = 0;      // for cmd: latency trace id (0: not traced)
+    double t_send = 0.0;     // for cmd: trace_clock() when the client sent it
+    double view_x = 0.0, view_y = 0.0, view_r = 0.0; // for view: camera circle (r <= 0 clears)
+};
+
+// Server pacing report sent in reply to time_scale messages.
+struct TickStatus {
+    double scale = 1.0;              // applied time scale (infinity = max speed)
+    double tick_rate = 0.0;          // timer wakeups per wall second
+    double sim_time = 0.0;           // seconds simulated
+    uint64_t ticks = 0;
+    uint64_t steps = 0;
+    uint64_t catchup_overruns = 0;   // wakeups that hit the catch-up bound
+    uint64_t work_overruns = 0;      // wakeups whose steps outlasted the period
+    double dropped_sim_time = 0.0;   // sim seconds skipped by the catch-up bound
+    double jitter_avg_ms = 0.0;
+    double jitter_max_ms = 0.0;
+    uint64_t dropped_snapshots = 0;  // snapshots the full sim->net ring held back
+    uint64_t net_queued_bytes = 0;   // bytes waiting in client send queues
+    uint64_t net_dropped_bytes = 0;  // superseded state frames dropped for slow clients
+    uint64_t net_dropped_frames = 0;
+};
+
+// Aggregate of objects a client's state left out (area of interest), per
+// coarse region and team. Sent as "summary" entries / frame summary records.
+struct RegionSummary {
+    int team = 0;
+    double x = 0.0, y = 0.0; // centroid, world px
+    uint32_t ships = 0;
+    uint32_t objects = 0;    // non-ship objects (only when objects are requested)
+};
+
+struct InterestSelection; // see interest.h
+
+// Simulation clock of one state message: the world's step counter and sim
+// time when the state was taken. Clients order and interpolate snapshots by
+// it. Sent as "tick"/"sim_time" fields or a frame stamp section.
+struct StateStamp {
+    uint64_t tick = 0;
+    double sim_time = 0.0;
+    bool valid = false; // parsers: the message carried a stamp
 };
 
 // Build a JSON line (newline-terminated) describing current state.
 // include_all: if true, include non-ship objects in an "objects" array.
+// stamp (optional) adds "tick" and "sim_time".
 std::string build_state_json(const std::map<uint64_t, Ship*>& uid_to_ship,
                              const std::vector<std::unique_ptr<Object>>& objs,
                              const std::string& defs_hash,
-                             bool include_all);
+                             bool include_all, const StateStamp* stamp = nullptr);
+
+// Same line for one client's area of interest, plus a "summary" array.
+std::string build_state_json(const InterestSelection& sel, const std::string& defs_hash,
+                             const StateStamp* stamp = nullptr);
+
+// Streaming forms of the two above: append the line to out without building
+// a JSON object graph. Reusing out keeps encoding allocation-free.
+void write_state_json(std::string& out,
+                      const std::map<uint64_t, Ship*>& uid_to_ship,
+                      const std::vector<std::unique_ptr<Object>>& objs,
+                      const std::string& defs_hash,
+                      bool include_all, const StateStamp* stamp = nullptr);
+void write_state_json(std::string& out, const InterestSelection& sel, const std::string& defs_hash,
+                      const StateStamp* stamp = nullptr);
 
 // Build a small reply {"type": type, "msg": msg}\n
 std::string build_reply(const char* type, const char* msg);
 
-// Build a joined reply; if match_ptr is non-null, include {"match": <bool>}.
-std::string build_joined_reply(const std::string& defs_hash, const bool* match_ptr);
+// Engine reply to a join. Empty strings, zero tokens and empty lists are
+// left out of the line (and read back that way).
+struct JoinedReply {
+    std::string defs_hash;
+    bool has_match = false;        // "match" sent: whether the client's defs_hash matched
+    bool match = false;
+    std::vector<std::string> def_keys; // object def keys in interned-id order ("defs");
+                                       // state messages then identify definitions by id only
+    std::string state_format;      // accepted binary state capability
+    uint64_t udp_token = 0;        // grants the UDP state channel (udp_state.h)
+    std::string shm_name;          // grants the shared-memory one (shm_snapshot.h)
+    std::string compression;       // accepted lz_frame.h capability
+    uint64_t resume_token = 0;     // lets a later join take the session over after a drop
+    bool resumed = false;          // this join did take one over
+    std::vector<std::string> pending; // with resumed: commands acked before the drop
+                                      // that still wait for an end of turn
+};
+
+// Build a {"type":"joined", ...} line.
+std::string build_joined_reply(const JoinedReply& r);
 
-// Parse a client JSON line into a typed message. Returns false on parse/validation error.
-bool parse_client_message(const std::string& line, ClientMsg& out, std::string* err = nullptr);
+// Build a {"type":"tick_status", ...} line.
+std::string build_tick_status(const TickStatus& ts);
+
+// Parse a client JSON line (NUL-terminated) into a typed message. Returns
+// false on parse/validation error.
+bool parse_client_message(const char* line, ClientMsg& out, std::string* err = nullptr);
+inline bool parse_client_message(const std::string& line, ClientMsg& out, std::string* err = nullptr) { return parse_client_message(line.c_str(), out, err); }
 
 // UI/client-side helpers -------------------------------------------------
 
+// Timestamps of one traced command (see build_cmd): seconds on trace_clock()
+// and the engine's tick count when it was applied and first broadcast after.
+struct CmdTrace {
+    uint32_t id = 0;
+    double t_send = 0.0;      // client wrote the line
+    double t_recv = 0.0;      // engine network thread parsed it
+    double t_queued = 0.0;    // sim thread queued the command
+    double t_applied = 0.0;   // sim thread applied the queued commands (end of turn)
+    double t_broadcast = 0.0; // first state after that was handed to the network thread
+    uint64_t applied_tick = 0;
+    uint64_t broadcast_tick = 0;
+};
+
+// Monotonic clock shared by the processes of one host (CLOCK_MONOTONIC
+// seconds), so client and engine timestamps compare directly; the engine
+// only listens on loopback.
+double trace_clock();
+
+// Build a {"type":"trace", ...} line, sent after the state that first shows a
+// traced command.
+std::string build_trace(const CmdTrace& tr);
+bool parse_trace(const char* line, CmdTrace& out);
+
+// Player join request (build_join).
+struct JoinRequest {
+    std::string name;
+    std::string defs_hash;         // optional; the reply says whether it matched
+    int team = -1;                 // team to claim (< 0: none)
+    std::vector<std::string> caps; // optional capabilities (kCap* constants)
+    int session = -1;              // >= 0 picks a hosted world on a multi-session engine
+    double rate = 0.0;             // > 0: at most this many states per second
+    double max_bps = 0.0;          // > 0: at most this many state bytes per second
+    uint32_t compress_min = 0;     // > 0: smallest state message compressed (lz_frame.h)
+    uint64_t resume_token = 0;     // from an earlier joined reply: take over that session,
+                                   // team and turn included, if the engine still holds it
+};
+
 // Builders for client->engine requests
-std::string build_join(const char* name, const char* defs_hash_opt, int team);
+// Paced joins (rate, max_bps) get the newest state on that schedule.
+std::string build_join(const JoinRequest& j);
 std::string build_state_req(const char* scope);
-std::string build_cmd(const char* cmd, uint64_t uid, double value_or_theta, bool is_theta);
+// trace > 0 asks the engine for a trace reply carrying t_send (trace_clock()).
+std::string build_cmd(const char* cmd, uint64_t uid, double value_or_theta, bool is_theta, uint32_t trace = 0, double t_send = 0.0);
 std::string build_end_turn(double wait_seconds);
+// Attach a maneuver plan to a ship; an empty step list cancels its plan.
+std::string build_plan(uint64_t uid, const std::vector<ClientPlanStep>& steps);
+// Set the server time scale (0 pauses, infinity = max speed); scale < 0 only
+// asks for a tick_status reply.
+std::string build_time_scale(double scale);
+// Acknowledge a decoded keyframe/delta frame so the server can delta against it.
+std::string build_state_ack(uint32_t seq);
+// Camera hint for area-of-interest filtering: world circle the client shows.
+std::string build_view(double x, double y, double r);
+// Join as a read-only spectator, delay seconds behind live, at most rate
+// states per second (<= 0: every broadcast).
+std::string build_spectate(double delay, double rate, const std::vector<std::string>* caps = nullptr);
 
 // Parsed object view used by UI when reading state messages
 struct NetObjectView {
-    std::string type;       // ship/planet/projectile/body
-    std::string object_key; // def key
+    int def = -1;           // interned def id (see JoinedReply def_keys); -1 if absent
+    std::string object_key; // def key; only sent by engines predating def ids
+    bool is_ship = false;   // listed in "ships"
     uint64_t uid = 0;       // ships only
     int team = 0;
     int throttle = 0;       // ships only
@@ -71,10 +221,20 @@ struct NetObjectView {
     double acc = 0;
 };
 
-// Parse a single JSON line with type=="state"; fills objects and optional defs_hash.
-bool parse_state_objects(const std::string& line, std::vector<NetObjectView>& out_objects, std::string* defs_hash_out = nullptr);
-
-// Parse a single JSON line with type=="joined"; returns defs_hash and optional match flag if present.
-bool parse_joined(const std::string& line, std::string* defs_hash_out, bool* has_match_out, bool* match_out);
+// Parse a single JSON line with type=="state"; fills objects, optional defs_hash,
+// region summaries and stamp.
+bool parse_state_objects(const char* line, std::vector<NetObjectView>& out_objects, std::string* defs_hash_out = nullptr,
+                         std::vector<RegionSummary>* summaries_out = nullptr, StateStamp* stamp_out = nullptr);
+inline bool parse_state_objects(const std::string& line, std::vector<NetObjectView>& out_objects, std::string* defs_hash_out = nullptr,
+                                std::vector<RegionSummary>* summaries_out = nullptr, StateStamp* stamp_out = nullptr)
+{ return parse_state_objects(line.c_str(), out_objects, defs_hash_out, summaries_out, stamp_out); }
+
+// Parse a single JSON line with type=="joined" (build_joined_reply).
+bool parse_joined(const char* line, JoinedReply& out);
+inline bool parse_joined(const std::string& line, JoinedReply& out) { return parse_joined(line.c_str(), out); }
+
+// Parse a {"type":"ack"|"error","msg":...} reply (build_reply); other types
+// return false.
+bool parse_reply(const char* line, std::string* type_out, std::string* msg_out = nullptr);
 
 } // namespace tcp_protocol
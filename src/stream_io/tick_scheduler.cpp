@@ -0,0 +1,77 @@
+#include "stream_io/tick_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+TickScheduler::TickScheduler (double dt, const TickConfig& cfg)
+  : dt_(dt > 0.0 ? dt : 1.0/64.0),
+    period_(cfg.tick_rate > 0.0 ? 1.0 / cfg.tick_rate : dt_),
+    scale_(0.0),
+    max_scale_(cfg.max_time_scale > 0.0 ? cfg.max_time_scale : 1.0),
+    max_catchup_(cfg.max_catchup_steps > 0 ? cfg.max_catchup_steps : 1)
+{
+    set_time_scale(cfg.time_scale);
+}
+
+double
+TickScheduler::set_time_scale (double scale)
+{
+    if (!(scale > 0.0)) scale_ = 0.0; // also catches NaN
+    else if (std::isinf(scale)) scale_ = scale;
+    else scale_ = std::min(scale, max_scale_);
+    return scale_;
+}
+
+void
+TickScheduler::reset (double now)
+{
+    acc_ = 0.0;
+    last_ = now;
+}
+
+int
+TickScheduler::on_tick (double now)
+{
+    if (last_ < 0.0) last_ = now;
+    double elapsed = now - last_;
+    last_ = now;
+    if (elapsed > 0.0) {
+        double dev = std::fabs(elapsed - period_);
+        st_.jitter_sum += dev; st_.jitter_max = std::max(st_.jitter_max, dev); ++st_.jitter_samples;
+    }
+    ++st_.ticks;
+    last_steps_ = 0;
+    if (scale_ <= 0.0) return 0;
+
+    int n;
+    if (std::isinf(scale_)) {
+        n = max_catchup_; // max speed: the whole budget, no debt carried
+    } else {
+        acc_ += elapsed * scale_;
+        double owed = std::floor(acc_ / dt_);
+        if (owed > (double)max_catchup_) {
+            // Too far behind: run the budget and forget the rest
+            st_.dropped_sim_time += (owed - (double)max_catchup_) * dt_;
+            ++st_.catchup_overruns;
+            acc_ -= owed * dt_;
+            n = max_catchup_;
+        } else {
+            n = (int)owed;
+            acc_ -= owed * dt_;
+        }
+    }
+    st_.steps += (uint64_t)n;
+    last_steps_ = n;
+    return n;
+}
+
+void
+TickScheduler::record_work (int steps_run, double seconds)
+{
+    const int unrun = last_steps_ - std::max(0, std::min(steps_run, last_steps_));
+    st_.steps -= (uint64_t)unrun;
+    if (!std::isinf(scale_)) acc_ += unrun * dt_;
+    last_steps_ = 0;
+    st_.max_work = std::max(st_.max_work, seconds);
+    if (seconds > period_) ++st_.work_overruns;
+}
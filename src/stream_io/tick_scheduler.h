@@ -0,0 +1,65 @@
+// Fixed-rate tick pacing for the engine server: time scale, bounded catch-up, overrun stats.
+#pragma once
+
+#include <cstdint>
+
+struct TickConfig {
+    double tick_rate = 0.0;        // timer wakeups per wall second; <= 0 means one per sim step (1/dt)
+    double time_scale = 1.0;       // initial sim seconds per wall second (0 pauses)
+    double max_time_scale = 8.0;   // largest finite scale a client may request
+    int max_catchup_steps = 32;    // substeps run in one wakeup at most
+};
+
+// Turns wall-clock time into a whole number of fixed sim steps per timer
+// wakeup. Sim time owed accumulates at time_scale; when more than
+// max_catchup_steps are owed the excess is dropped and counted as an overrun
+// instead of spiralling. An infinite scale ("max speed") runs the full
+// catch-up budget every wakeup.
+class TickScheduler {
+public:
+    struct Stats {
+        uint64_t ticks = 0;             // timer wakeups that ran
+        uint64_t steps = 0;             // sim steps taken
+        uint64_t catchup_overruns = 0;  // wakeups that hit max_catchup_steps
+        uint64_t work_overruns = 0;     // wakeups whose steps took longer than the period
+        double dropped_sim_time = 0.0;  // sim seconds discarded by the catch-up bound
+        double max_work = 0.0;          // longest step work in one wakeup (wall seconds)
+        double jitter_sum = 0.0;        // |wakeup interval - period|, summed
+        double jitter_max = 0.0;
+        uint64_t jitter_samples = 0;
+    };
+
+    TickScheduler (double dt, const TickConfig& cfg);
+
+    double dt () const { return dt_; }
+    double period () const { return period_; }
+    double tick_rate () const { return 1.0 / period_; }
+    double time_scale () const { return scale_; }
+    bool paused () const { return scale_ <= 0.0; }
+
+    // Clamp to [0, max_time_scale] (infinity allowed) and apply; returns the applied scale.
+    double set_time_scale (double scale);
+
+    // Restart pacing at wall time now (seconds), e.g. after a pause.
+    void reset (double now);
+
+    // Number of sim steps to run for a wakeup at wall time now.
+    int on_tick (double now);
+
+    // Report how many of the last wakeup's steps ran (fewer when a turn
+    // came due; the rest stay owed) and how long they took (wall seconds).
+    void record_work (int steps_run, double seconds);
+
+    const Stats& stats () const { return st_; }
+
+private:
+    double dt_;
+    double period_;
+    double scale_;
+    double max_scale_;
+    int max_catchup_;
+    double acc_ = 0.0;   // sim seconds owed
+    double last_ = -1.0; // wall time of the previous wakeup; < 0 before the first
+    int last_steps_ = 0; // steps on_tick returned for that wakeup
+    Stats st_;
+};
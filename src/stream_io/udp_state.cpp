@@ -0,0 +1,83 @@
+// UDP state datagram framing shared by the engine server and the UI.
+
+#include "stream_io/udp_state.h"
+
+#include <cstring>
+
+namespace tcp_protocol {
+
+namespace {
+
+inline void put_u16(unsigned char*& p, uint16_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p += 2; }
+inline void put_u32(unsigned char*& p, uint32_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24); p += 4; }
+inline uint16_t get_u16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+inline uint32_t get_u32(const unsigned char* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Serial number order, so seq may wrap
+inline bool seq_after(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+
+} // namespace
+
+size_t udp_fragment_count(size_t frame_bytes)
+{
+    return frame_bytes == 0 ? 1 : (frame_bytes + kUdpFragmentPayload - 1) / kUdpFragmentPayload;
+}
+
+void write_udp_header(unsigned char* out, uint8_t kind, uint16_t index, uint16_t count, uint32_t seq)
+{
+    unsigned char* p = out;
+    *p++ = kUdpMagic; *p++ = kind;
+    put_u16(p, index); put_u16(p, count); put_u16(p, 0);
+    put_u32(p, seq);
+}
+
+std::string build_udp_hello(uint64_t token)
+{
+    std::string out(kUdpHeaderSize + 8, '\0');
+    unsigned char* p = (unsigned char*)&out[0];
+    write_udp_header(p, kUdpKindHello, 0, 0, 0);
+    p += kUdpHeaderSize;
+    put_u32(p, (uint32_t)token); put_u32(p, (uint32_t)(token >> 32));
+    return out;
+}
+
+bool parse_udp_hello(const char* data, size_t n, uint64_t* token_out)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    if (n != kUdpHeaderSize + 8 || p[0] != kUdpMagic || p[1] != kUdpKindHello) return false;
+    if (token_out) *token_out = (uint64_t)get_u32(p + kUdpHeaderSize) | ((uint64_t)get_u32(p + kUdpHeaderSize + 4) << 32);
+    return true;
+}
+
+bool UdpReassembler::add(const char* data, size_t n)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    if (n < kUdpHeaderSize || p[0] != kUdpMagic || p[1] != kUdpKindState) return false;
+    const uint16_t index = get_u16(p + 2), count = get_u16(p + 4);
+    const uint32_t seq = get_u32(p + 8);
+    const size_t payload = n - kUdpHeaderSize;
+    if (count == 0 || index >= count || count > kUdpMaxFragments || payload > kUdpFragmentPayload) return false;
+    if (index + 1 < count && payload != kUdpFragmentPayload) return false;
+    if (have_done_ && !seq_after(seq, done_seq_)) return false; // stale
+    if (building_ && seq != seq_) {
+        if (!seq_after(seq, seq_)) return false; // late fragment of an older frame
+        building_ = false;                       // newer frame started: give up on this one
+    }
+    if (!building_) {
+        if (have_done_) lost_ += (uint32_t)(seq - done_seq_ - 1); // includes abandoned frames
+        building_ = true; seq_ = seq; count_ = count; got_ = 0; last_size_ = 0;
+        have_.assign(count, 0);
+        buf_.resize((size_t)count * kUdpFragmentPayload);
+    }
+    if (count != count_ || have_[index]) return false;
+    have_[index] = 1; ++got_;
+    std::memcpy(&buf_[(size_t)index * kUdpFragmentPayload], p + kUdpHeaderSize, payload);
+    if (index + 1 == count) last_size_ = payload;
+    if (got_ < count_) return false;
+
+    frame_.assign(buf_.data(), (size_t)(count_ - 1) * kUdpFragmentPayload + last_size_);
+    building_ = false; have_done_ = true; done_seq_ = seq_;
+    return true;
+}
+
+} // namespace tcp_protocol
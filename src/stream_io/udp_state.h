@@ -0,0 +1,67 @@
+// Unreliable UDP channel for state frames, alongside the TCP connection that
+// keeps carrying commands, replies and acks.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tcp_protocol {
+
+// Join capability (together with kCapBinaryState) asking for state frames
+// over UDP. The joined reply then carries "udp_token"; the client sends
+// hello datagrams with it to the engine's UDP port (the TCP port number)
+// until the first state datagram arrives. Until then state stays on TCP.
+constexpr const char* kCapUdpState = "udp1";
+
+// Datagram header (kUdpHeaderSize bytes, little endian):
+//   u8 magic, u8 kind, u16 fragment index, u16 fragment count, u16 reserved,
+//   u32 seq
+// kUdpKindHello (client -> engine): followed by the u64 token; index, count
+// and seq are 0.
+// kUdpKindState (engine -> client): fragment index of count of one state
+// frame, byte for byte what TCP would carry (binary or keyframe/delta). seq
+// counts frames per client; a newer seq supersedes an incomplete older one.
+constexpr uint8_t kUdpMagic = 0xF6;
+constexpr uint8_t kUdpKindHello = 1;
+constexpr uint8_t kUdpKindState = 2;
+constexpr size_t kUdpHeaderSize = 12;
+// Fragment payload; keeps datagrams under common path MTUs
+constexpr size_t kUdpFragmentPayload = 1200;
+// Frames needing more fragments than this go over TCP instead
+constexpr size_t kUdpMaxFragments = 4096;
+
+size_t udp_fragment_count(size_t frame_bytes);
+void write_udp_header(unsigned char* out, uint8_t kind, uint16_t index, uint16_t count, uint32_t seq);
+
+std::string build_udp_hello(uint64_t token);
+bool parse_udp_hello(const char* data, size_t n, uint64_t* token_out);
+
+// Client side: reassembles state frames from fragments, keeping only the
+// newest. Late fragments of older frames and fragments of frames older than
+// the last completed one are ignored.
+class UdpReassembler {
+public:
+    // Returns true when the datagram completed a frame (see frame()).
+    bool add(const char* data, size_t n);
+
+    const std::string& frame() const { return frame_; }
+    uint32_t seq() const { return done_seq_; }
+    uint64_t lost_frames() const { return lost_; }
+
+private:
+    bool have_done_ = false;
+    uint32_t done_seq_ = 0;  // last completed frame
+    bool building_ = false;
+    uint32_t seq_ = 0;       // frame being reassembled
+    uint16_t count_ = 0;
+    uint16_t got_ = 0;
+    size_t last_size_ = 0;   // payload of the final fragment, once seen
+    std::vector<uint8_t> have_;
+    std::string buf_;
+    std::string frame_;
+    uint64_t lost_ = 0;      // frames skipped or abandoned incomplete
+};
+
+} // namespace tcp_protocol
@@ -11,6 +11,7 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -27,6 +28,12 @@
 #include "file_io/json_interface.h"
 #include "file_io/hash_utils.h"
 #include "stream_io/tcp_protocol.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/delta_frame.h"
+#include "stream_io/line_framer.h"
+#include "stream_io/udp_state.h"
+#include "stream_io/shm_snapshot.h"
+#include "stream_io/lz_frame.h"
 
 #include "file_io/config_loader.h"
 #include "file_io/object_loader.h"
@@ -48,8 +55,8 @@ static SDL_Color color_of(const std::string& name) {
 }
 
 struct ObjectView {
-    std::string type;       // "ship", "planet", "projectile", "body"
-    std::string object_key; // object definition key
+    const ObjectDefinition* def = nullptr; // local definition (resolved via interned id)
+    Object::Type kind = Object::BODY;      // from def; SHIP for entries in "ships"
     uint64_t uid = 0;       // ships may have a uid; others 0
     int team = 0;
     int throttle = 0;       // ships only
@@ -62,70 +69,330 @@ struct ObjectView {
 
 struct WorldView {
     std::vector<ObjectView> objects;
+    std::vector<tcp_protocol::RegionSummary> summaries; // left out of our area of interest
+    tcp_protocol::StateStamp stamp;                     // engine clock of the state, if sent
+};
+
+// Latency of traced commands (net.trace), split where the time goes between
+// a keypress and the first state that shows it; L shows the histograms
+struct LatencyTrace {
+    static constexpr int kBins = 18;       // bin i: below 0.05 * 2^i ms (the last is open)
+    static constexpr size_t kRecent = 512; // newest samples, for percentiles
+    struct Segment {
+        uint32_t bins[kBins] = {};
+        std::vector<double> recent;
+        size_t next = 0;
+        void add(double ms) {
+            int b = 0; while (b < kBins - 1 && ms >= 0.05 * (double)(1u << b)) ++b;
+            ++bins[b];
+            if (recent.size() < kRecent) recent.push_back(ms); else recent[next] = ms;
+            next = (next + 1) % kRecent;
+        }
+        double percentile(double p) const {
+            if (recent.empty()) return 0.0;
+            std::vector<double> v = recent;
+            const size_t k = std::min(v.size() - 1, (size_t)(p * (double)(v.size() - 1) + 0.5));
+            std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+            return v[k];
+        }
+    };
+    enum { kNetIn, kQueue, kApply, kBroadcast, kNetOut, kTotal, kSegments };
+    static constexpr const char* kNames[kSegments] = {"client->engine", "engine queue", "until applied", "until broadcast", "engine->client", "total"};
+    Segment seg[kSegments];
+    bool enabled = false, shown = false;
+    uint32_t next_id = 1;
+    uint64_t samples = 0, ticks = 0; // ticks between apply and broadcast, summed
+
+    // Id for the next command sent; 0 (untraced) when tracing is off
+    uint32_t take_id() { if (!enabled) return 0; const uint32_t id = next_id++; if (!next_id) next_id = 1; return id; }
+    void add(const tcp_protocol::CmdTrace& tr, double now) {
+        seg[kNetIn].add(1e3 * (tr.t_recv - tr.t_send));
+        seg[kQueue].add(1e3 * (tr.t_queued - tr.t_recv));
+        seg[kApply].add(1e3 * (tr.t_applied - tr.t_queued));
+        seg[kBroadcast].add(1e3 * (tr.t_broadcast - tr.t_applied));
+        seg[kNetOut].add(1e3 * (now - tr.t_broadcast));
+        seg[kTotal].add(1e3 * (now - tr.t_send));
+        ++samples; ticks += tr.broadcast_tick - tr.applied_tick;
+    }
 };
 
 // hash_file_fnv1a64 provided by file_io/hash_utils.h
 
-static int connect_loopback(int port) {
+static int connect_loopback(int port, bool report = true) {
     int fd = ::socket(AF_INET, SOCK_STREAM, 0);
     if (fd < 0) { std::perror("socket"); return -1; }
     sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); addr.sin_port = htons((uint16_t)port);
-    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("connect"); ::close(fd); return -1; }
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { if (report) std::perror("connect"); ::close(fd); return -1; }
     int flags = fcntl(fd, F_GETFL, 0); if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
     return fd;
 }
 
 static inline void send_line(int fd, const std::string& s) { (void)::send(fd, s.c_str(), s.size(), 0); }
 
-static void send_join(int fd, const char* defs_hash) { send_line(fd, tcp_protocol::build_join("ui", defs_hash, 0)); }
+static void send_join(int fd, const char* defs_hash, const GameConfig& cfg, uint64_t resume_token = 0) {
+    tcp_protocol::JoinRequest j;
+    j.name = "ui"; if (defs_hash) j.defs_hash = defs_hash; j.team = 0;
+    j.caps = {tcp_protocol::kCapBinaryState, tcp_protocol::kCapDeltaState}; // JSON remains the fallback
+    if (cfg.net_udp_state) j.caps.push_back(tcp_protocol::kCapUdpState);
+    if (cfg.net_shm_state) j.caps.push_back(tcp_protocol::kCapShmState);
+    if (cfg.net_compress) j.caps.push_back(cfg.net_compress_dict ? tcp_protocol::kCapLzDict : tcp_protocol::kCapLzState);
+    j.rate = cfg.net_state_rate; j.max_bps = cfg.net_state_max_bps;
+    j.compress_min = cfg.net_compress_min > 0 ? (uint32_t)cfg.net_compress_min : 0;
+    j.resume_token = resume_token;
+    send_line(fd, tcp_protocol::build_join(j));
+}
 static void request_state(int fd, const char* scope) { send_line(fd, tcp_protocol::build_state_req(scope)); }
-static void send_cmd(int fd, const char* cmd, uint64_t uid, double value_or_theta, bool is_theta) { send_line(fd, tcp_protocol::build_cmd(cmd, uid, value_or_theta, is_theta)); }
+static void send_cmd(int fd, const char* cmd, uint64_t uid, double value_or_theta, bool is_theta, LatencyTrace& trace) {
+    const uint32_t id = trace.take_id();
+    send_line(fd, tcp_protocol::build_cmd(cmd, uid, value_or_theta, is_theta, id, id ? tcp_protocol::trace_clock() : 0.0));
+}
 static void send_end_turn(int fd) { send_line(fd, tcp_protocol::build_end_turn(1.0)); }
 
-// helper removed; we parse directly where needed
+// Maps the engine's interned def ids to local definitions. Built once from the
+// joined reply; when defs_hash matches, the local id table is used as is.
+struct RemoteDefs {
+    const std::map<std::string, ObjectDefinition>* local = nullptr;
+    std::string local_hash;
+    std::vector<const ObjectDefinition*> by_id;
+
+    void on_joined(const std::string& remote_hash, const std::vector<std::string>& keys) {
+        if (!remote_hash.empty() && remote_hash == local_hash) { by_id = object_defs_by_id(*local); return; }
+        by_id.assign(keys.size(), nullptr);
+        for (size_t i = 0; i < keys.size(); ++i) { auto it = local->find(keys[i]); if (it != local->end()) by_id[i] = &it->second; }
+    }
+    const ObjectDefinition* resolve(const tcp_protocol::NetObjectView& o) const {
+        if (o.def >= 0) return (size_t)o.def < by_id.size() ? by_id[(size_t)o.def] : nullptr;
+        if (o.object_key.empty()) return nullptr;
+        auto it = local->find(o.object_key); // legacy engines send keys
+        return it != local->end() ? &it->second : nullptr;
+    }
+};
+
+static void enqueue_state(const std::vector<tcp_protocol::NetObjectView>& objs, std::vector<tcp_protocol::RegionSummary>& summaries, const tcp_protocol::StateStamp& stamp,
+                          std::deque<WorldView>& queue, const RemoteDefs& rdefs) {
+    WorldView frame; frame.objects.reserve(objs.size());
+    for (const auto& it : objs) {
+        ObjectView o{}; o.def = rdefs.resolve(it); o.kind = it.is_ship ? Object::SHIP : (o.def ? o.def->kind : Object::BODY); o.uid = it.uid; o.team = it.team; o.throttle = it.throttle; o.x = it.x; o.y = it.y; o.vx = it.vx; o.vy = it.vy; o.theta = it.theta; o.delta_v = it.delta_v; o.acc = it.acc; frame.objects.push_back(o);
+    }
+    frame.summaries.swap(summaries);
+    frame.stamp = stamp;
+    queue.push_back(std::move(frame));
+}
+
+// Stamped states waiting to be shown, oldest first. The render clock runs at
+// the observed sim rate interp_delay wall seconds behind the newest state and
+// is steered toward that target (snapping when a second or more off), so ships
+// move smoothly between states however unevenly they arrive.
+struct InterpBuffer {
+    double delay = 0.1;  // wall seconds; <= 0 shows every state as it comes
+    std::deque<WorldView> snaps;
+    bool started = false;
+    double clock = 0.0;  // sim time being shown
+    double rate = 1.0;   // sim seconds per wall second, smoothed
+    double last_wall = -1.0;
+    std::unordered_map<uint64_t, const ObjectView*> by_uid; // scratch
+
+    void push(WorldView&& v, double wall) {
+        if (!snaps.empty()) {
+            const double newest = snaps.back().stamp.sim_time;
+            if (v.stamp.sim_time < newest - 1.0) { snaps.clear(); started = false; } // world restarted or switched
+            else if (v.stamp.sim_time <= newest) { if (v.stamp.sim_time == newest) snaps.back() = std::move(v); return; }
+            else {
+                // Gaps over half a second are pauses (turns), not the sim rate
+                const double dw = wall - last_wall;
+                if (dw > 1e-3 && dw < 0.5) rate += 0.2 * ((v.stamp.sim_time - newest) / dw - rate);
+            }
+        }
+        last_wall = wall;
+        snaps.push_back(std::move(v));
+        while (snaps.size() > 64) snaps.pop_front();
+    }
+
+    // Advance the clock by wall_dt and write the state at it into out
+    bool sample(double wall_dt, WorldView& out) {
+        if (snaps.empty()) return false;
+        const double newest = snaps.back().stamp.sim_time;
+        const double target = newest - delay * rate;
+        if (!started || std::fabs(target - clock) > std::max(rate, 1e-3)) { clock = target; started = true; }
+        else clock += wall_dt * rate + (target - clock) * std::min(1.0, 2.0 * wall_dt);
+        clock = std::min(clock, newest);
+        while (snaps.size() > 1 && snaps[1].stamp.sim_time <= clock) snaps.pop_front();
+        const WorldView& a = snaps.front();
+        if (snaps.size() == 1 || clock <= a.stamp.sim_time) { out = a; return true; }
+        const WorldView& b = snaps[1];
+        const double t = (clock - a.stamp.sim_time) / (b.stamp.sim_time - a.stamp.sim_time);
+        // Membership and non-ship objects come from the nearer state; ships
+        // present in both are interpolated
+        const WorldView& near = (t < 0.5) ? a : b;
+        const WorldView& far = (t < 0.5) ? b : a;
+        out = near;
+        by_uid.clear();
+        for (const auto& o : far.objects) if (o.kind == Object::SHIP) by_uid[o.uid] = &o;
+        for (auto& o : out.objects) {
+            if (o.kind != Object::SHIP) continue;
+            auto it = by_uid.find(o.uid); if (it == by_uid.end()) continue;
+            const ObjectView& pa = (t < 0.5) ? o : *it->second;
+            const ObjectView& pb = (t < 0.5) ? *it->second : o;
+            double dth = std::remainder(pb.theta - pa.theta, 2.0 * M_PI);
+            o.x = pa.x + (pb.x - pa.x) * t; o.y = pa.y + (pb.y - pa.y) * t;
+            o.vx = pa.vx + (pb.vx - pa.vx) * t; o.vy = pa.vy + (pb.vy - pa.vy) * t;
+            o.theta = pa.theta + dth * t;
+        }
+        out.stamp.sim_time = clock;
+        return true;
+    }
+};
+
+// UDP state channel: opened when the joined reply grants a token; hellos
+// are resent until the first state datagram arrives
+struct UdpChannel {
+    int port = 0;
+    int fd = -1;
+    uint64_t token = 0;
+    bool active = false;
+    Uint32 last_hello = 0;
+    tcp_protocol::UdpReassembler rx;
+    tcp_protocol::LzDecoder lz; // datagrams have their own compression stream
+
+    void open(uint64_t t) {
+        close(); token = t;
+        fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) { std::perror("socket udp"); return; }
+        int sz = 1 << 20; setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+        sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); addr.sin_port = htons((uint16_t)port);
+        if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { std::perror("connect udp"); close(); }
+    }
+    void close() { if (fd >= 0) ::close(fd); fd = -1; token = 0; active = false; last_hello = 0; rx = tcp_protocol::UdpReassembler(); lz = tcp_protocol::LzDecoder(); }
+};
+
+// Decode one binary state frame; keyframes and deltas are acked so the engine
+// can use them as baselines. Compressed frames hold a JSON state line or
+// another frame.
+static void handle_state_frame(int fd, const char* data, size_t len, std::deque<WorldView>& queue, RemoteDefs& rdefs, tcp_protocol::DeltaDecoder& deltas,
+                               tcp_protocol::LzDecoder& lz, std::vector<tcp_protocol::NetObjectView>& objs, std::vector<tcp_protocol::RegionSummary>& sums) {
+    const unsigned char kind = (unsigned char)data[2];
+    if (kind == tcp_protocol::kFrameKindCompressed) {
+        std::string raw;
+        if (!lz.decode(data, len, raw) || raw.empty()) return;
+        if ((unsigned char)raw[0] != tcp_protocol::kFrameMagic) {
+            tcp_protocol::StateStamp stamp;
+            if (tcp_protocol::parse_state_objects(raw, objs, nullptr, &sums, &stamp)) enqueue_state(objs, sums, stamp, queue, rdefs);
+        } else if (raw.size() >= 4 && (unsigned char)raw[2] != tcp_protocol::kFrameKindCompressed && tcp_protocol::frame_length(raw.data(), raw.size()) == raw.size()) {
+            handle_state_frame(fd, raw.data(), raw.size(), queue, rdefs, deltas, lz, objs, sums);
+        }
+        return;
+    }
+    if (kind == tcp_protocol::kFrameKindKeyframe || kind == tcp_protocol::kFrameKindDelta) {
+        uint32_t seq = 0;
+        tcp_protocol::StateStamp stamp;
+        if (deltas.decode(data, len, objs, &seq, &sums, &stamp)) { enqueue_state(objs, sums, stamp, queue, rdefs); send_line(fd, tcp_protocol::build_state_ack(seq)); }
+    } else {
+        tcp_protocol::StateStamp stamp;
+        if (tcp_protocol::parse_state_frame(data, len, objs, &sums, &stamp)) enqueue_state(objs, sums, stamp, queue, rdefs);
+    }
+}
 
-static void net_poll_and_enqueue(int fd, std::string& buf, std::deque<std::vector<ObjectView>>& queue) {
-    char tmp[4096];
+// Returns false once the engine connection is closed or broken (whatever
+// arrived before is still handled). resume_token keeps the engine's latest.
+static bool net_poll_and_enqueue(int fd, LineFramer& in, std::deque<WorldView>& queue, RemoteDefs& rdefs, tcp_protocol::DeltaDecoder& deltas, UdpChannel& udp,
+                                 tcp_protocol::ShmSnapshotReader& shm, tcp_protocol::LzDecoder& lz, LatencyTrace& trace, uint64_t& resume_token) {
+    bool alive = true;
     while (true) {
-        ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
-        if (n <= 0) break;
-        buf.append(tmp, tmp + n);
+        ssize_t n = ::recv(fd, in.prepare(65536), 65536, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) { alive = false; break; }
+        if (n < 0) break;
+        in.commit((size_t)n);
     }
-    size_t pos;
-    while ((pos = buf.find('\n')) != std::string::npos) {
-        std::string line = buf.substr(0, pos);
-        buf.erase(0, pos + 1);
+    std::vector<tcp_protocol::NetObjectView> objs;
+    std::vector<tcp_protocol::RegionSummary> sums;
+    tcp_protocol::StateStamp stamp;
+    while (true) {
+        // Binary state frames and JSON lines share the stream; the first byte tells them apart
+        std::string_view head = in.pending();
+        if (head.empty()) break;
+        if ((unsigned char)head[0] == tcp_protocol::kFrameMagic) {
+            size_t len = tcp_protocol::frame_length(head.data(), head.size());
+            if (len == 0) break; // incomplete
+            handle_state_frame(fd, head.data(), len, queue, rdefs, deltas, lz, objs, sums);
+            in.consume(len);
+            continue;
+        }
+        std::string_view line;
+        LineFramer::Status st = in.next_line(line);
+        if (st == LineFramer::kNone) break;
+        if (st == LineFramer::kTooLong) { std::fprintf(stderr, "[ui] dropped overlong line from engine\n"); continue; }
         if (line.empty()) continue;
-        std::string defs_hash; bool has_match=false; bool match=false; bool handled=false;
-        std::vector<tcp_protocol::NetObjectView> tmp;
-        if (tcp_protocol::parse_state_objects(line, tmp, &defs_hash)) {
-            WorldView vtmp; vtmp.objects.reserve(tmp.size());
-            for (const auto& it : tmp) {
-                ObjectView o{}; o.type = it.type; o.object_key = it.object_key; o.uid = it.uid; o.team = it.team; o.throttle = it.throttle; o.x = it.x; o.y = it.y; o.vx = it.vx; o.vy = it.vy; o.theta = it.theta; o.delta_v = it.delta_v; o.acc = it.acc; vtmp.objects.push_back(std::move(o));
+        std::string defs_hash;
+        tcp_protocol::JoinedReply joined;
+        tcp_protocol::CmdTrace tr;
+        if (tcp_protocol::parse_state_objects(line.data(), objs, &defs_hash, &sums, &stamp)) {
+            enqueue_state(objs, sums, stamp, queue, rdefs);
+        } else if (tcp_protocol::parse_trace(line.data(), tr)) {
+            trace.add(tr, tcp_protocol::trace_clock());
+        } else if (tcp_protocol::parse_joined(line.data(), joined)) {
+            // A resume attempt the engine no longer held starts over: fetch
+            // the whole world as on the first join
+            if (resume_token && !joined.resumed) request_state(fd, "all");
+            resume_token = joined.resume_token;
+            rdefs.on_joined(joined.defs_hash, joined.def_keys);
+            if (joined.udp_token) udp.open(joined.udp_token); else udp.close();
+            if (joined.shm_name.empty() || !shm.open(joined.shm_name)) shm.close();
+            std::fprintf(stderr, "[ui] joined engine; defs_hash=%s%s%s defs=%zu state=%s%s%s%s\n",
+                         !joined.defs_hash.empty()?joined.defs_hash.c_str():"<none>",
+                         joined.has_match?" match=":"",
+                         joined.has_match?(joined.match?"true":"false"):"",
+                         rdefs.by_id.size(),
+                         joined.state_format.empty() ? "json" : joined.state_format.c_str(),
+                         joined.udp_token ? " over udp" : shm.is_open() ? " via shared memory" : "",
+                         joined.compression.empty() ? "" : " compression=", joined.compression.c_str());
+            if (joined.resumed) {
+                std::string names;
+                for (const auto& c : joined.pending) { if (!names.empty()) names += ", "; names += c; }
+                std::fprintf(stderr, "[ui] resumed session; %zu command(s) still queued%s%s\n", joined.pending.size(), names.empty() ? "" : ": ", names.c_str());
             }
-            queue.push_back(std::move(vtmp.objects));
-            handled = true;
-        } else if (tcp_protocol::parse_joined(line, &defs_hash, &has_match, &match)) {
-            std::fprintf(stderr, "[ui] joined engine; defs_hash=%s%s%s\n",
-                         !defs_hash.empty()?defs_hash.c_str():"<none>",
-                         has_match?" match=":"",
-                         has_match?(match?"true":"false"):"");
-            handled = true;
         }
-        (void)handled;
     }
+
+    // Shared memory: the newest snapshot, decoded in place
+    if (shm.is_open()) {
+        if (shm.read_latest(objs, &sums, &stamp)) enqueue_state(objs, sums, stamp, queue, rdefs);
+        while (queue.size() > 1) queue.pop_front();
+        return alive;
+    }
+
+    // Lost or late datagrams never hold up newer state: only the newest
+    // complete frame is shown, so display latency stays bounded under loss
+    if (udp.fd < 0) return alive;
+    char dg[2048];
+    while (true) {
+        ssize_t n = ::recv(udp.fd, dg, sizeof(dg), 0);
+        if (n < 0) break;
+        udp.active = true;
+        if (!udp.rx.add(dg, (size_t)n)) continue;
+        const std::string& f = udp.rx.frame();
+        if (f.size() >= tcp_protocol::kFrameHeaderSize && (unsigned char)f[0] == tcp_protocol::kFrameMagic && tcp_protocol::frame_length(f.data(), f.size()) == f.size())
+            handle_state_frame(fd, f.data(), f.size(), queue, rdefs, deltas, udp.lz, objs, sums);
+    }
+    if (udp.active) { while (queue.size() > 1) queue.pop_front(); return alive; }
+    const Uint32 now = SDL_GetTicks();
+    if (udp.last_hello == 0 || now - udp.last_hello >= 200) {
+        const std::string hello = tcp_protocol::build_udp_hello(udp.token);
+        (void)::send(udp.fd, hello.data(), hello.size(), 0);
+        udp.last_hello = now ? now : 1;
+    }
+    return alive;
 }
 
 static uint64_t pick_initial_selected(const WorldView& view) {
     if (view.objects.empty()) return 0;
-    for (const auto& s : view.objects) if (s.type == "ship" && s.team == 0) return s.uid;
-    for (const auto& s : view.objects) if (s.type == "ship") return s.uid;
+    for (const auto& s : view.objects) if (s.kind == Object::SHIP && s.team == 0) return s.uid;
+    for (const auto& s : view.objects) if (s.kind == Object::SHIP) return s.uid;
     return 0;
 }
 
 static ObjectView* find_ship(WorldView& v, uint64_t uid) {
     for (auto& s : v.objects) {
-        if (s.uid == uid && s.type == "ship") return &s;
+        if (s.uid == uid && s.kind == Object::SHIP) return &s;
     }
     return nullptr;
 }
@@ -282,10 +549,16 @@ int main(int argc, char** argv) {
         return 1;
     }
     std::string defs_hash = hash_file_fnv1a64(objects_path);
+    RemoteDefs rdefs; rdefs.local = &object_defs; rdefs.local_hash = defs_hash;
+    tcp_protocol::DeltaDecoder deltas;
+    tcp_protocol::LzDecoder lz;
+    rdefs.by_id = object_defs_by_id(object_defs); // until the engine sends its table
 
     int fd = connect_loopback(port);
     if (fd < 0) return 1;
-    send_join(fd, defs_hash.c_str());
+    UdpChannel udp; udp.port = port;
+    tcp_protocol::ShmSnapshotReader shm;
+    send_join(fd, defs_hash.c_str(), cfg);
     request_state(fd, "all");
 
     if (SDL_Init(SDL_INIT_VIDEO) != 0) { std::fprintf(stderr, "SDL_Init: %s\n", SDL_GetError()); return 1; }
@@ -296,9 +569,12 @@ int main(int argc, char** argv) {
 
     Camera cam; cam.screen_w = uicfg.window_w; cam.screen_h = uicfg.window_h; cam.zoom = 1.0f; cam.cx = 0.0f; cam.cy = 0.0f;
     WorldView view; std::string nb; uint64_t selected = 0;
-    std::deque<std::vector<ObjectView>> frame_queue;
-    // Texture cache by object key
-    std::map<std::string, SDL_Texture*> tex_cache;
+    std::deque<WorldView> frame_queue;
+    InterpBuffer interp; interp.delay = uicfg.interp_delay;
+    LatencyTrace trace; trace.enabled = cfg.net_trace;
+    // Texture cache by local interned def id (load attempted once per def)
+    std::vector<SDL_Texture*> tex_cache(object_defs.size(), nullptr);
+    std::vector<char> tex_tried(object_defs.size(), 0);
     // HUD panel setup (font + colors from config/ui.json if present)
     TTF_Init();
     TTF_Font* hud_font = nullptr;
@@ -358,13 +634,14 @@ int main(int argc, char** argv) {
             // Compute strings with unit conversions
             char line[160]; int ty = y + style.pad;
             int panel_h = style.pad + 4*18 + style.pad; // add acc line
-            if (ov.type == std::string("ship")) panel_h += 18; // extra line for throttle/dv/theta
+            if (ov.kind == Object::SHIP) panel_h += 18; // extra line for throttle/dv/theta
             SDL_Rect r{ x, y, style.width, panel_h };
             SDL_SetRenderDrawColor(ren, style.bg.r, style.bg.g, style.bg.b, style.bg.a); SDL_RenderFillRect(ren, &r);
             SDL_SetRenderDrawColor(ren, style.border.r, style.border.g, style.border.b, style.border.a); SDL_RenderDrawRect(ren, &r);
 
+            static const char* const kind_names[] = { "ship", "body", "planet", "projectile" };
             std::snprintf(line, sizeof(line), "type=%s key=%s team=%d uid=%llu",
-                          ov.type.c_str(), ov.object_key.c_str(), ov.team, (unsigned long long)ov.uid);
+                          kind_names[ov.kind], ov.def ? ov.def->key.c_str() : "", ov.team, (unsigned long long)ov.uid);
             draw_text(x + style.pad, ty, line); ty += 18;
             double x_km = ov.x / 1000.0, y_km = ov.y / 1000.0;
             std::snprintf(line, sizeof(line), "x=%.2f km   y=%.2f km", x_km, y_km);
@@ -374,7 +651,7 @@ int main(int argc, char** argv) {
             draw_text(x + style.pad, ty, line); ty += 18;
             std::snprintf(line, sizeof(line), "acc=%.3f px/s^2", ov.acc);
             draw_text(x + style.pad, ty, line); ty += 18;
-            if (ov.type == std::string("ship")) {
+            if (ov.kind == Object::SHIP) {
                 double dv_kms = ov.delta_v / 1000.0;
                 std::snprintf(line, sizeof(line), "\xCE\x94v=%.3f km/s   \xCE\xB8=%.3f rad   thr=%d", dv_kms, ov.theta, ov.throttle);
                 draw_text(x + style.pad, ty, line); ty += 18;
@@ -383,6 +660,37 @@ int main(int argc, char** argv) {
     } hud;
     hud.ren = ren; hud.font = hud_font; hud.style = { hud_bg, hud_border, hud_text, hud_pad, hud_width };
 
+    // Latency panel: p50/p90/p99 of the recent traced commands per segment,
+    // over a log2 histogram of all of them (bars from 0.05 ms up)
+    auto draw_latency = [&](int x, int bottom) {
+        const int pad = hud.style.pad, bar_h = 20, bar_w = 10, row_h = 18 + bar_h + 6;
+        const int w = std::max(hud.style.width, 2 * pad + LatencyTrace::kBins * bar_w);
+        const int h = 2 * pad + 18 + LatencyTrace::kSegments * row_h;
+        const int y = bottom - h;
+        SDL_Rect r{ x, y, w, h };
+        SDL_SetRenderDrawColor(ren, hud.style.bg.r, hud.style.bg.g, hud.style.bg.b, hud.style.bg.a); SDL_RenderFillRect(ren, &r);
+        SDL_SetRenderDrawColor(ren, hud.style.border.r, hud.style.border.g, hud.style.border.b, hud.style.border.a); SDL_RenderDrawRect(ren, &r);
+        char line[160]; int ty = y + pad;
+        if (!trace.enabled) std::snprintf(line, sizeof(line), "command latency: tracing off (net.trace)");
+        else std::snprintf(line, sizeof(line), "command latency: %llu traced, %.1f ticks applied->broadcast",
+                           (unsigned long long)trace.samples, trace.samples ? (double)trace.ticks / (double)trace.samples : 0.0);
+        hud.draw_text(x + pad, ty, line); ty += 18;
+        for (int k = 0; k < LatencyTrace::kSegments; ++k) {
+            const LatencyTrace::Segment& sg = trace.seg[k];
+            std::snprintf(line, sizeof(line), "%s: p50 %.2f  p90 %.2f  p99 %.2f ms", LatencyTrace::kNames[k], sg.percentile(0.5), sg.percentile(0.9), sg.percentile(0.99));
+            hud.draw_text(x + pad, ty, line); ty += 18;
+            const uint32_t most = *std::max_element(std::begin(sg.bins), std::end(sg.bins));
+            SDL_SetRenderDrawColor(ren, hud.style.text.r, hud.style.text.g, hud.style.text.b, 200);
+            for (int b = 0; b < LatencyTrace::kBins; ++b) {
+                if (!sg.bins[b]) continue;
+                const int bh = std::max(1, (int)std::lround((double)bar_h * sg.bins[b] / most));
+                SDL_Rect br{ x + pad + b * bar_w, ty + bar_h - bh, bar_w - 2, bh };
+                SDL_RenderFillRect(ren, &br);
+            }
+            ty += bar_h + 6;
+        }
+    };
+
     // Optional boot sequence before connecting (skippable by any key press)
     if (!display_boot(ren, hud_font, hud_text, uicfg.window_w, uicfg.window_h)) {
         // User chose to exit
@@ -394,9 +702,8 @@ int main(int argc, char** argv) {
     }
 
     // Object radius lookup (world px) with fallback
-    auto radius_for = [&](const std::string& key) -> double {
-        auto it = object_defs.find(key);
-        if (it != object_defs.end() && it->second.radius > 0.0) return it->second.radius;
+    auto radius_for = [&](const ObjectDefinition* def) -> double {
+        if (def && def->radius > 0.0) return def->radius;
         return 16.0; // fallback radius in world pixels
     };
 
@@ -424,7 +731,7 @@ int main(int argc, char** argv) {
         MenuButton b; b.key = key; b.text_tmpl = it->second.text;
         if (key == "end_turn") b.on_click = [&](){ send_end_turn(fd); };
         else if (key == "quit") b.on_click = [&](){ SDL_Event e; e.type = SDL_QUIT; SDL_PushEvent(&e); };
-        else if (key == "fire") b.on_click = [&](){ if (auto* sv = find_ship(view, selected)) { int mx,my; SDL_GetMouseState(&mx,&my); float wx,wy; screen_to_world(cam,mx,my,wx,wy); double th = std::atan2((double)wy - sv->y, (double)wx - sv->x); send_cmd(fd, "FIRE", selected, th, true); } };
+        else if (key == "fire") b.on_click = [&](){ if (auto* sv = find_ship(view, selected)) { int mx,my; SDL_GetMouseState(&mx,&my); float wx,wy; screen_to_world(cam,mx,my,wx,wy); double th = std::atan2((double)wy - sv->y, (double)wx - sv->x); send_cmd(fd, "FIRE", selected, th, true, trace); } };
         else if (key == "next_ship") b.on_click = [&](){ /* TODO: next ship */ };
         else if (key == "previous_ship") b.on_click = [&](){ /* TODO: previous ship */ };
         else if (key == "save") b.on_click = [&](){ std::fprintf(stderr, "[ui] save not implemented yet\n"); };
@@ -434,7 +741,7 @@ int main(int argc, char** argv) {
     else { add_button_by_key("end_turn"); add_button_by_key("quit"); }
 
     bool running = true;
-    std::string buf;
+    LineFramer in(64u << 20); // full-world JSON states can run to megabytes
     int fps = (uicfg.fps_cap > 0 ? uicfg.fps_cap : 60);
     double frame_dt = 1.0 / (double)fps;
     Uint32 last_ticks = SDL_GetTicks();
@@ -444,8 +751,8 @@ int main(int argc, char** argv) {
         int best_uid = 0; double best_d2 = 0.0;
         double cx, cy; screen_to_world(cam, mx, my, (float&)cx, (float&)cy);
         for (const auto& s : view.objects) {
-            if (s.type != std::string("ship")) continue;
-            double R = radius_for(s.object_key);
+            if (s.kind != Object::SHIP) continue;
+            double R = radius_for(s.def);
             double d2 = (s.x - cx)*(s.x - cx) + (s.y - cy)*(s.y - cy);
             if (d2 <= R*R) {
                 if (!best_uid || d2 < best_d2) { best_uid = s.uid; best_d2 = d2; }
@@ -455,19 +762,58 @@ int main(int argc, char** argv) {
         if (best_uid) selected = best_uid;
     };
 
+    // Camera hint for the engine's area-of-interest filter, resent when the
+    // view moves or zooms by a quarter of its radius (at most every 100 ms)
+    double hint_x = 0.0, hint_y = 0.0, hint_r = 0.0; Uint32 hint_ticks = 0;
+    auto send_view_hint = [&](Uint32 now_ticks){
+        double r = 0.5 * std::hypot((double)cam.screen_w, (double)cam.screen_h) / cam.zoom;
+        bool moved = std::hypot(cam.cx - hint_x, cam.cy - hint_y) > 0.25 * hint_r || std::fabs(r - hint_r) > 0.25 * hint_r;
+        if (!moved || now_ticks - hint_ticks < 100) return;
+        send_line(fd, tcp_protocol::build_view(cam.cx, cam.cy, r));
+        hint_x = cam.cx; hint_y = cam.cy; hint_r = r; hint_ticks = now_ticks;
+    };
+
     auto theta_to_mouse = [&](const ObjectView& s){ int mx,my; SDL_GetMouseState(&mx,&my); float wx,wy; screen_to_world(cam,mx,my,wx,wy); return std::atan2((double)wy - s.y, (double)wx - s.x); };
 
+    // A lost engine connection is retried every 500 ms; the join carries the
+    // resume token so the engine hands back the held session and catches up
+    // with one keyframe instead of a full-world JSON state
+    uint64_t resume_token = 0; Uint32 reconnect_ticks = 0;
+    auto reconnect = [&](Uint32 now_ticks){
+        if (now_ticks - reconnect_ticks < 500) return;
+        reconnect_ticks = now_ticks;
+        fd = connect_loopback(port, false);
+        if (fd < 0) return;
+        in = LineFramer(64u << 20); deltas = tcp_protocol::DeltaDecoder(); lz = tcp_protocol::LzDecoder();
+        send_join(fd, defs_hash.c_str(), cfg, resume_token);
+        if (!resume_token) request_state(fd, "all");
+        hint_r = 0.0; // resend the view hint
+        std::fprintf(stderr, "[ui] reconnected to engine%s\n", resume_token ? "; resuming session" : "");
+    };
+
     while (running) {
-        net_poll_and_enqueue(fd, buf, frame_queue);
+        if (fd < 0) reconnect(SDL_GetTicks());
+        if (fd >= 0 && !net_poll_and_enqueue(fd, in, frame_queue, rdefs, deltas, udp, shm, lz, trace, resume_token)) {
+            std::fprintf(stderr, "[ui] lost engine connection; reconnecting\n");
+            ::close(fd); fd = -1; udp.close(); shm.close();
+            reconnect_ticks = SDL_GetTicks();
+        }
         // Update current view at most once per frame_dt
         Uint32 now = SDL_GetTicks();
         double dt = (now - last_ticks) / 1000.0;
         last_ticks = now;
         accum += dt;
+        // Stamped states are interpolated; unstamped ones (older engines)
+        // are shown in arrival order, one per frame_dt
+        if (interp.delay > 0.0) {
+            while (!frame_queue.empty() && frame_queue.front().stamp.valid) { interp.push(std::move(frame_queue.front()), now / 1000.0); frame_queue.pop_front(); }
+            if (!interp.snaps.empty() && frame_queue.empty()) { interp.sample(dt, view); accum = 0.0; }
+        }
         if (accum + 1e-6 >= frame_dt && !frame_queue.empty()) {
             accum -= frame_dt;
-            view.objects = std::move(frame_queue.front());
+            view = std::move(frame_queue.front());
             frame_queue.pop_front();
+            interp.snaps.clear(); interp.started = false;
         }
         if (selected == 0) selected = pick_initial_selected(view);
 
@@ -481,12 +827,13 @@ int main(int argc, char** argv) {
             }
             if (e.type == SDL_KEYDOWN) {
                 if (e.key.keysym.sym == SDLK_RETURN || e.key.keysym.sym == SDLK_e) { send_end_turn(fd); }
+                if (e.key.keysym.sym == SDLK_l) trace.shown = !trace.shown;
                 if (selected) {
                     ObjectView* sv = find_ship(view, selected);
                     if (sv) {
-                        if (e.key.keysym.sym == SDLK_t) { int new_thr = sv->throttle ? 0 : 1; send_cmd(fd, "THROTTLE", selected, (double)new_thr, false); }
-                        if (e.key.keysym.sym == SDLK_h) { double th = theta_to_mouse(*sv); send_cmd(fd, "HEADING", selected, th, true); }
-                        if (e.key.keysym.sym == SDLK_f) { double th = theta_to_mouse(*sv); send_cmd(fd, "FIRE", selected, th, true); }
+                        if (e.key.keysym.sym == SDLK_t) { int new_thr = sv->throttle ? 0 : 1; send_cmd(fd, "THROTTLE", selected, (double)new_thr, false, trace); }
+                        if (e.key.keysym.sym == SDLK_h) { double th = theta_to_mouse(*sv); send_cmd(fd, "HEADING", selected, th, true, trace); }
+                        if (e.key.keysym.sym == SDLK_f) { double th = theta_to_mouse(*sv); send_cmd(fd, "FIRE", selected, th, true, trace); }
                     }
                 }
             }
@@ -494,6 +841,7 @@ int main(int argc, char** argv) {
 
         // Center camera on selected ship if any
         if (auto* sv = find_ship(view, selected)) { cam.cx = (float)sv->x; cam.cy = (float)sv->y; }
+        send_view_hint(now);
 
         SDL_SetRenderDrawColor(ren, 10, 12, 16, 255);
         SDL_RenderClear(ren);
@@ -501,15 +849,10 @@ int main(int argc, char** argv) {
             int sx, sy; world_to_screen(cam, (float)s.x, (float)s.y, sx, sy);
             SDL_Texture* tex = nullptr;
             double scale = 1.0;
-            if (!s.object_key.empty()) {
-                auto it = tex_cache.find(s.object_key);
-                if (it == tex_cache.end()) {
-                    auto defit = object_defs.find(s.object_key);
-                    if (defit != object_defs.end() && !defit->second.image.empty()) {
-                        SDL_Texture* t = IMG_LoadTexture(ren, defit->second.image.c_str());
-                        if (t) { tex_cache[s.object_key] = t; tex = t; scale = defit->second.rescale; }
-                    }
-                } else { tex = it->second; auto defit2 = object_defs.find(s.object_key); if (defit2 != object_defs.end()) scale = defit2->second.rescale; }
+            if (s.def && s.def->id < tex_cache.size()) {
+                const ObjectDefId id = s.def->id;
+                if (!tex_tried[id]) { tex_tried[id] = 1; if (!s.def->image.empty()) tex_cache[id] = IMG_LoadTexture(ren, s.def->image.c_str()); }
+                tex = tex_cache[id]; scale = s.def->rescale;
             }
             if (tex) {
                 int tw=0, th=0; SDL_QueryTexture(tex, nullptr, nullptr, &tw, &th);
@@ -522,7 +865,7 @@ int main(int argc, char** argv) {
                 SDL_Point center{ dw/2, dh/2 };
                 SDL_RenderCopyEx(ren, tex, nullptr, &dst, deg, &center, SDL_FLIP_NONE);
             } else {
-                int R = (int)std::lround(radius_for(s.object_key) * cam.zoom);
+                int R = (int)std::lround(radius_for(s.def) * cam.zoom);
                 if (R < 2) R = 2;
                 SDL_SetRenderDrawColor(ren, s.team==0?120:200, s.team==0?220:140, s.team==0?255:140, 255);
                 draw_circle_filled(ren, sx, sy, R);
@@ -533,27 +876,35 @@ int main(int argc, char** argv) {
                 SDL_RenderDrawLine(ren, sx, sy, hx, hy);
             }
             // Atmosphere overlay for planets
-            if (s.type == std::string("planet")) {
-                auto it = object_defs.find(s.object_key);
-                if (it != object_defs.end() && it->second.atmosphere_depth > 0.0) {
-                    double atmo_r_world = it->second.radius + it->second.atmosphere_depth;
+            if (s.kind == Object::PLANET) {
+                if (s.def && s.def->atmosphere_depth > 0.0) {
+                    double atmo_r_world = s.def->radius + s.def->atmosphere_depth;
                     int Ra = (int)std::lround(atmo_r_world * cam.zoom);
                     SDL_SetRenderDrawColor(ren, atmosphere_color.r, atmosphere_color.g, atmosphere_color.b, atmosphere_color.a);
                     draw_circle_outline_clipped(ren, sx, sy, Ra, cam.screen_w, cam.screen_h);
                 }
             }
-            if (s.uid == selected) { SDL_SetRenderDrawColor(ren, 255, 220, 120, 255); int selR = (int)std::lround(radius_for(s.object_key) * cam.zoom) + 4; draw_circle_outline(ren, sx, sy, selR); }
+            if (s.uid == selected) { SDL_SetRenderDrawColor(ren, 255, 220, 120, 255); int selR = (int)std::lround(radius_for(s.def) * cam.zoom) + 4; draw_circle_outline(ren, sx, sy, selR); }
+        }
+        // Region summaries: a ring per left-out group, growing with its size
+        for (const auto& r : view.summaries) {
+            int sx, sy; world_to_screen(cam, (float)r.x, (float)r.y, sx, sy);
+            int R = 6 + (int)std::lround(2.0 * std::log2(1.0 + r.ships + r.objects));
+            SDL_SetRenderDrawColor(ren, r.team==0?120:200, r.team==0?220:140, r.team==0?255:140, 160);
+            draw_circle_outline_clipped(ren, sx, sy, R, cam.screen_w, cam.screen_h);
         }
         if (auto* sv = find_ship(view, selected)) { hud.draw(*sv, 10, 10); }
+        if (trace.shown) draw_latency(10, uicfg.window_h - 10);
         menu.draw(ren, hud_font);
 
         SDL_RenderPresent(ren);
     }
 
     // Cleanup textures
-    for (auto& kv : tex_cache) if (kv.second) SDL_DestroyTexture(kv.second);
+    for (auto* t : tex_cache) if (t) SDL_DestroyTexture(t);
     if (hud_font) TTF_CloseFont(hud_font);
     TTF_Quit();
+    udp.close();
     ::close(fd);
     SDL_Quit();
     return 0;
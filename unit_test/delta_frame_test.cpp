@@ -0,0 +1,126 @@
+// Keyframe/delta frames: round trips, the ship cap and malformed frames.
+
+#include "test.h"
+
+#include "stream_io/delta_frame.h"
+#include "stream_io/tcp_protocol.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using tcp_protocol::DeltaDecoder;
+using tcp_protocol::NetObjectView;
+using tcp_protocol::ShipRecord;
+using tcp_protocol::StateSnapshot;
+
+namespace {
+
+std::vector<ShipRecord> ships(uint32_t first, size_t n) {
+    std::vector<ShipRecord> out(n);
+    for (size_t i = 0; i < n; ++i) {
+        ShipRecord& r = out[i];
+        r.uid = first + (uint32_t)i; r.def = (uint16_t)(i % 3); r.team = (int8_t)(i % 2);
+        r.x = (int32_t)(i * 800); r.y = -(int32_t)i * 400; r.vx = 640; r.vy = 0; r.theta = (uint16_t)(i * 1000);
+    }
+    return out;
+}
+
+// Decoded views equal the records, field for field
+bool same(const std::vector<NetObjectView>& got, const std::vector<ShipRecord>& want) {
+    if (got.size() != want.size()) return false;
+    for (size_t i = 0; i < want.size(); ++i) {
+        NetObjectView v; tcp_protocol::ship_record_to_view(want[i], v);
+        const NetObjectView& g = got[i];
+        if (g.uid != v.uid || g.def != v.def || g.team != v.team || g.throttle != v.throttle
+            || g.x != v.x || g.y != v.y || g.vx != v.vx || g.vy != v.vy || g.theta != v.theta) return false;
+    }
+    return true;
+}
+
+StateSnapshot snapshot(uint32_t seq, double sim_time, const std::vector<ShipRecord>& ships) {
+    StateSnapshot s; s.seq = seq; s.sim_time = sim_time;
+    s.ships = std::make_shared<const std::vector<ShipRecord>>(ships);
+    return s;
+}
+
+} // namespace
+
+TEST(delta_keyframe_round_trips) {
+    const std::vector<ShipRecord> cur = ships(1, 50);
+    const std::string k = tcp_protocol::build_keyframe(7, 1.5, cur);
+    DeltaDecoder dec; std::vector<NetObjectView> got; uint32_t seq = 0;
+    CHECK(dec.decode(k.data(), k.size(), got, &seq));
+    CHECK(seq == 7 && same(got, cur));
+}
+
+TEST(delta_frame_round_trips_spawn_despawn_change) {
+    const std::vector<ShipRecord> base = ships(1, 50);
+    DeltaDecoder dec; std::vector<NetObjectView> got; uint32_t seq = 0;
+    const std::string k = tcp_protocol::build_keyframe(1, 1.0, base);
+    CHECK(dec.decode(k.data(), k.size(), got, &seq));
+
+    // uid 1..10 leave, 100..104 arrive, every third ship turns and one stops
+    std::vector<ShipRecord> cur(base.begin() + 10, base.end());
+    for (size_t i = 0; i < cur.size(); ++i) {
+        cur[i].x += 640 / 8; // moved as predicted over one second
+        if (i % 3 == 0) cur[i].theta += 500;
+    }
+    cur[5].vx = 0; cur[5].throttle = 100;
+    for (const ShipRecord& r : ships(100, 5)) cur.push_back(r);
+    std::vector<ShipRecord> recon;
+    const std::string d = tcp_protocol::build_delta_frame(2, 2.0, snapshot(1, 1.0, base), cur, recon);
+    CHECK(d.size() < k.size());
+    CHECK(dec.decode(d.data(), d.size(), got, &seq));
+    CHECK(seq == 2 && same(got, recon) && same(got, cur));
+}
+
+TEST(delta_frames_cap_ships_with_the_baseline) {
+    std::vector<ShipRecord> cur = ships(1, tcp_protocol::kMaxFrameShips + 10);
+    DeltaDecoder dec; std::vector<NetObjectView> got; uint32_t seq = 0;
+    const std::string k = tcp_protocol::build_keyframe(1, 1.0, cur);
+    CHECK(dec.decode(k.data(), k.size(), got, &seq) && got.size() == tcp_protocol::kMaxFrameShips);
+
+    tcp_protocol::cap_frame_ships(cur);
+    CHECK(cur.size() == tcp_protocol::kMaxFrameShips && same(got, cur));
+    // Against that baseline, a delta replacing every ship still fits the counts
+    const std::vector<ShipRecord> next = ships(1000000, tcp_protocol::kMaxFrameShips + 10);
+    std::vector<ShipRecord> recon;
+    const std::string d = tcp_protocol::build_delta_frame(2, 1.0, snapshot(1, 1.0, cur), next, recon);
+    CHECK(recon.size() == tcp_protocol::kMaxFrameShips);
+    CHECK(dec.decode(d.data(), d.size(), got, &seq) && seq == 2 && same(got, recon));
+}
+
+TEST(delta_decoder_rejects_malformed_frames) {
+    const std::vector<ShipRecord> base = ships(1, 4);
+    const std::string k = tcp_protocol::build_keyframe(1, 1.0, base);
+    DeltaDecoder dec; std::vector<NetObjectView> got; uint32_t seq = 0;
+    for (size_t n = 0; n < k.size(); ++n) CHECK(!dec.decode(k.data(), n, got, &seq));
+    std::string bad = k; bad[0] = 0;
+    CHECK(!dec.decode(bad.data(), bad.size(), got, &seq));
+    bad = k; bad[2] = 9; // unknown kind
+    CHECK(!dec.decode(bad.data(), bad.size(), got, &seq));
+    bad = k; bad[24] = 5; // more ships than the payload holds
+    CHECK(!dec.decode(bad.data(), bad.size(), got, &seq));
+
+    // A delta on a baseline the decoder never saw waits for a keyframe
+    std::vector<ShipRecord> recon;
+    const std::string d = tcp_protocol::build_delta_frame(3, 2.0, snapshot(2, 1.0, base), base, recon);
+    CHECK(!dec.decode(d.data(), d.size(), got, &seq));
+    CHECK(dec.decode(k.data(), k.size(), got, &seq) && seq == 1);
+}
+
+TEST(delta_decoder_keeps_the_baseline_in_use) {
+    // A client whose acks lag keeps getting deltas against its last
+    // acknowledged frame, however many frames come after it
+    const std::vector<ShipRecord> base = ships(1, 4);
+    DeltaDecoder dec; std::vector<NetObjectView> got; uint32_t seq = 0;
+    const std::string k = tcp_protocol::build_keyframe(1, 1.0, base);
+    CHECK(dec.decode(k.data(), k.size(), got, &seq));
+    const StateSnapshot snap = snapshot(1, 1.0, base);
+    for (uint32_t s = 2; s < 4 * tcp_protocol::kDeltaHistory; ++s) {
+        std::vector<ShipRecord> recon;
+        const std::string d = tcp_protocol::build_delta_frame(s, 1.0, snap, base, recon);
+        CHECK(dec.decode(d.data(), d.size(), got, &seq) && seq == s && same(got, base));
+    }
+}
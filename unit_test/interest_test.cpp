@@ -0,0 +1,108 @@
+// InterestIndex: which objects a hint selects and how the rest is summarized.
+
+#include "test.h"
+
+#include "engine/object.h"
+#include "engine/object_def.h"
+#include "engine/initial_state.h"
+#include "engine/ship.h"
+#include "stream_io/interest.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+using tcp_protocol::InterestHint;
+using tcp_protocol::InterestIndex;
+using tcp_protocol::InterestSelection;
+
+namespace {
+
+InitialState at(float x, float y, int team) {
+    InitialState s; s.x = x; s.y = y; s.team = team;
+    s.has_x = s.has_y = s.has_vx = s.has_vy = s.has_theta = s.has_ang_vel = true;
+    return s;
+}
+
+// A small world: ships of team 0 and 1 near the origin and far away, a rock
+// next to the team 0 ship and one far off, and a planet further still
+struct World {
+    ObjectDefinition ship_def, rock_def, planet_def;
+    std::vector<std::unique_ptr<Object>> objs;
+    std::map<uint64_t, Ship*> uid_to_ship;
+
+    World() {
+        ship_def.key = "ship"; ship_def.kind = Object::SHIP;
+        rock_def.key = "rock"; rock_def.kind = Object::BODY;
+        planet_def.key = "planet"; planet_def.kind = Object::PLANET;
+        add_ship(1, 0.0f, 0.0f, 0);
+        add_ship(2, 50.0f, 0.0f, 1);
+        add_ship(3, 5000.0f, 0.0f, 1);
+        add_ship(4, 5010.0f, 0.0f, 1);
+        add(rock_def, 0.0f, 80.0f);
+        add(rock_def, -3000.0f, 0.0f);
+        add(planet_def, 90000.0f, 90000.0f);
+    }
+    void add_ship(uint64_t uid, float x, float y, int team) {
+        auto s = std::make_unique<Ship>(ship_def, at(x, y, team));
+        s->team = team;
+        uid_to_ship[uid] = s.get();
+        objs.push_back(std::move(s));
+    }
+    void add(const ObjectDefinition& d, float x, float y) { objs.push_back(std::make_unique<Object>(d, at(x, y, 0))); }
+};
+
+} // namespace
+
+TEST(interest_team_selects_ships_near_its_own) {
+    World w;
+    InterestIndex idx(100.0);
+    idx.build(w.uid_to_ship, w.objs);
+    InterestHint h; h.team = 0;
+    InterestSelection sel;
+    idx.select(h, false, sel);
+    CHECK(sel.ships.size() == 2 && sel.ships[0].first == 1 && sel.ships[1].first == 2);
+    CHECK(sel.objects.empty());
+    // The two far team 1 ships share one summary
+    CHECK(sel.summaries.size() == 1);
+    if (!sel.summaries.empty()) {
+        const tcp_protocol::RegionSummary& s = sel.summaries[0];
+        CHECK(s.team == 1 && s.ships == 2 && s.objects == 0 && s.x == 5005.0 && s.y == 0.0);
+    }
+}
+
+TEST(interest_include_all_adds_nearby_objects_and_planets) {
+    World w;
+    InterestIndex idx(100.0);
+    idx.build(w.uid_to_ship, w.objs);
+    InterestHint h; h.team = 0;
+    InterestSelection sel;
+    idx.select(h, true, sel);
+    // Nearby: both ships and the rock at (0, 80); the planet always
+    CHECK(sel.include_all && sel.ships.size() == 2);
+    int ships = 0, rocks = 0, planets = 0;
+    for (const Object* o : sel.objects) {
+        if (o->type == Object::SHIP) ++ships; else if (o->type == Object::PLANET) ++planets; else ++rocks;
+    }
+    CHECK(ships == 2 && rocks == 1 && planets == 1);
+    // The far rock is summarized on its own; far ships are counted once
+    uint32_t left_ships = 0, left_objects = 0;
+    for (const auto& s : sel.summaries) { left_ships += s.ships; left_objects += s.objects; }
+    CHECK(left_ships == 2 && left_objects == 1);
+}
+
+TEST(interest_view_circle_and_repeated_selects) {
+    World w;
+    InterestIndex idx(100.0);
+    idx.build(w.uid_to_ship, w.objs);
+    InterestHint view; view.has_view = true; view.view_x = 5000.0; view.view_y = 0.0; view.view_r = 20.0;
+    InterestSelection sel;
+    idx.select(view, false, sel);
+    CHECK(sel.ships.size() == 2 && sel.ships[0].first == 3 && sel.ships[1].first == 4);
+    // Earlier marks do not leak into the next selection
+    InterestHint none;
+    idx.select(none, false, sel);
+    CHECK(sel.ships.empty() && !sel.summaries.empty());
+    idx.select(view, false, sel);
+    CHECK(sel.ships.size() == 2);
+}
@@ -0,0 +1,81 @@
+// JsonReader: values, exact integers, escapes and malformed input.
+
+#include "test.h"
+
+#include "stream_io/json_reader.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool read(const std::string& text, JsonReader::Value& v) {
+    JsonReader r(text.data(), text.data() + text.size());
+    return r.value(v) && r.at_end();
+}
+
+} // namespace
+
+TEST(json_reader_object_members) {
+    const std::string text = " {\"a\": 1, \"b\" : [true, null, \"x\"], \"c\":{\"d\":-2.5e1}} ";
+    JsonReader r(text.data(), text.data() + text.size());
+    std::vector<std::string> keys; JsonReader::Value b, c;
+    CHECK(r.object([&](std::string_view k, const JsonReader::Value& v) {
+        keys.emplace_back(k);
+        if (k == "b") b = v; else if (k == "c") c = v;
+    }));
+    CHECK(r.at_end());
+    CHECK((keys == std::vector<std::string>{"a", "b", "c"}));
+    CHECK(b.kind == JsonReader::kArray && c.kind == JsonReader::kObject);
+
+    std::vector<JsonReader::Kind> kinds;
+    JsonReader arr(b.begin, b.end);
+    CHECK(arr.array([&](const JsonReader::Value& v) { kinds.push_back(v.kind); }));
+    CHECK((kinds == std::vector<JsonReader::Kind>{JsonReader::kTrue, JsonReader::kNull, JsonReader::kString}));
+
+    double d = 0.0;
+    JsonReader inner(c.begin, c.end);
+    CHECK(inner.object([&](std::string_view, const JsonReader::Value& v) { (void)v.get(d); }) && d == -25.0);
+}
+
+TEST(json_reader_integers_are_exact) {
+    JsonReader::Value v; int64_t i = 0; uint64_t u = 0; double d = 0.0;
+    CHECK(read("9007199254740993", v) && v.integral && v.get(i) && i == 9007199254740993LL);
+    CHECK(read("18446744073709551615", v) && v.get(u) && u == 18446744073709551615ULL);
+    CHECK(!v.get(i)); // out of int64 range
+    CHECK(read("-1", v) && !v.get(u) && v.get(i) && i == -1);
+    CHECK(read("2.9", v) && !v.integral && v.get(i) && i == 2); // truncated
+    CHECK(read("1e400", v) && !v.get(d)); // out of double range
+    CHECK(read("\"7\"", v) && !v.get(i)); // wrong kind
+}
+
+TEST(json_reader_strings_and_escapes) {
+    JsonReader::Value v; std::string s;
+    CHECK(read("\"plain\"", v) && !v.escaped && v.equals("plain") && v.get(s) && s == "plain");
+    CHECK(read("\"a\\\"b\\\\c\\/d\\n\"", v) && v.escaped && v.get(s) && s == "a\"b\\c/d\n");
+    CHECK(v.equals("a\"b\\c/d\n"));
+    CHECK(read("\"\\u00e9\\u20ac\\ud83d\\ude00\"", v) && v.get(s) && s == "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+}
+
+TEST(json_reader_rejects_malformed_input) {
+    const char* bad[] = {
+        "", "{", "[1,", "[1 2]", "{\"a\" 1}", "{\"a\":}", "{a:1}", "{\"a\":1,}", "[1,]",
+        "01", "-", "1.", ".5", "1e", "+1", "tru", "nul", "\"open", "\"bad \\x escape\"",
+        "\"\\u12\"", "\"tab\tinside\"", "{\"a\":1}}",
+    };
+    for (const char* text : bad) {
+        JsonReader::Value v;
+        const bool ok = read(text, v);
+        if (ok) std::fprintf(stderr, "accepted: %s\n", text);
+        CHECK(!ok);
+    }
+}
+
+TEST(json_reader_nesting_limit) {
+    std::string deep(64, '['), deeper(65, '[');
+    deep += std::string(64, ']'); deeper += std::string(65, ']');
+    JsonReader::Value v;
+    CHECK(read(deep, v));
+    CHECK(!read(deeper, v));
+}
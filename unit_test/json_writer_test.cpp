@@ -0,0 +1,50 @@
+// JsonWriter: exact output, separators, escapes and number spelling.
+
+#include "test.h"
+
+#include "stream_io/json_reader.h"
+#include "stream_io/json_writer.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+TEST(json_writer_nested_containers) {
+    std::string out;
+    JsonWriter w(out);
+    w.begin_object().field("type", "state").key("ships").begin_array();
+    w.begin_object().field("uid", (uint64_t)7).field("team", -1).end_object();
+    w.begin_object().end_object();
+    w.end_array().key("empty").begin_array().end_array().field("x", 1.5).end_object().newline();
+    CHECK(out == "{\"type\":\"state\",\"ships\":[{\"uid\":7,\"team\":-1},{}],\"empty\":[],\"x\":1.5}\n");
+}
+
+TEST(json_writer_appends_to_the_buffer) {
+    std::string out = "prefix ";
+    JsonWriter(out).begin_array().value(1).value(2).end_array();
+    CHECK(out == "prefix [1,2]");
+}
+
+TEST(json_writer_numbers) {
+    std::string out;
+    JsonWriter w(out);
+    w.begin_array().value(1.0).value(-0.25).value(1e21).value(std::numeric_limits<double>::infinity())
+     .value(std::nan("")).value((int64_t)INT64_MIN).value((uint64_t)UINT64_MAX).end_array();
+    CHECK(out == "[1.0,-0.25,1e+21,null,null,-9223372036854775808,18446744073709551615]");
+
+    // Shortest spelling still reads back to the same double
+    const double vals[] = {0.1, 1.0 / 3.0, 123456.789, -2.5e-300, 6.02214076e23};
+    for (double v : vals) {
+        std::string s; JsonWriter(s).value(v);
+        JsonReader r(s.data(), s.data() + s.size()); JsonReader::Value jv; double back = 0.0;
+        CHECK(r.value(jv) && jv.get(back) && back == v);
+    }
+}
+
+TEST(json_writer_escapes_strings) {
+    std::string out;
+    JsonWriter(out).value("a\"b\\c\nd\x01" "e/");
+    CHECK(out == "\"a\\\"b\\\\c\\nd\\u0001e/\"");
+    JsonReader r(out.data(), out.data() + out.size()); JsonReader::Value v; std::string back;
+    CHECK(r.value(v) && v.get(back) && back == "a\"b\\c\nd\x01" "e/");
+}
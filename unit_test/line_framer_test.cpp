@@ -0,0 +1,78 @@
+// LineFramer: lines split across reads, overlong lines and binary frames.
+
+#include "test.h"
+
+#include "stream_io/line_framer.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+void feed(LineFramer& f, const std::string& bytes) {
+    char* p = f.prepare(bytes.size());
+    std::memcpy(p, bytes.data(), bytes.size());
+    f.commit(bytes.size());
+}
+
+// Every line available now, with "!" standing for a kTooLong report
+std::vector<std::string> drain(LineFramer& f) {
+    std::vector<std::string> got;
+    std::string_view line;
+    while (true) {
+        const LineFramer::Status st = f.next_line(line);
+        if (st == LineFramer::kNone) return got;
+        got.push_back(st == LineFramer::kLine ? std::string(line) : std::string("!"));
+    }
+}
+
+} // namespace
+
+TEST(line_framer_splits_and_joins_reads) {
+    LineFramer f(64);
+    feed(f, "first\nsec");
+    CHECK((drain(f) == std::vector<std::string>{"first"}));
+    feed(f, "ond\n\nthird\n");
+    CHECK((drain(f) == std::vector<std::string>{"second", "", "third"}));
+    CHECK(f.pending().empty());
+}
+
+TEST(line_framer_byte_at_a_time) {
+    LineFramer f(64);
+    const std::string text = "{\"type\":\"end_turn\"}\n{\"type\":\"state_ack\",\"seq\":3}\n";
+    std::vector<std::string> got;
+    for (char c : text) { feed(f, std::string(1, c)); for (auto& l : drain(f)) got.push_back(l); }
+    CHECK((got == std::vector<std::string>{"{\"type\":\"end_turn\"}", "{\"type\":\"state_ack\",\"seq\":3}"}));
+}
+
+TEST(line_framer_lines_are_c_strings) {
+    LineFramer f(64);
+    feed(f, "abc\ndef\n");
+    std::string_view line;
+    CHECK(f.next_line(line) == LineFramer::kLine && std::strcmp(line.data(), "abc") == 0);
+}
+
+TEST(line_framer_drops_overlong_lines_once) {
+    LineFramer f(8);
+    feed(f, "short\n0123456789");
+    CHECK((drain(f) == std::vector<std::string>{"short", "!"}));
+    // The rest of the dropped line is skipped without another report
+    feed(f, std::string(100, 'x'));
+    CHECK(drain(f).empty());
+    feed(f, "yy\nok\n");
+    CHECK((drain(f) == std::vector<std::string>{"ok"}));
+    // A complete overlong line in one read
+    feed(f, "0123456789\nfine\n");
+    CHECK((drain(f) == std::vector<std::string>{"!", "fine"}));
+}
+
+TEST(line_framer_consume_binary_prefix) {
+    LineFramer f(64);
+    feed(f, std::string("\xF5\x01\n\x02", 4) + "line\n");
+    CHECK(f.pending().size() == 9);
+    f.consume(4); // a length-prefixed frame that happens to hold a '\n'
+    CHECK((drain(f) == std::vector<std::string>{"line"}));
+    f.consume(10); // more than is buffered
+    CHECK(f.pending().empty());
+}
@@ -0,0 +1,113 @@
+// Compressed frames: round trips with and without a dictionary, lost
+// dictionaries and malformed payloads.
+
+#include "test.h"
+
+#include "stream_io/lz_frame.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using tcp_protocol::LzDecoder;
+
+namespace {
+
+// A state-like line that compresses well and differs a little per n
+std::string state_line(int n) {
+    std::string s = "{\"type\":\"state\",\"tick\":" + std::to_string(n) + ",\"ships\":[";
+    for (int i = 0; i < 60; ++i) s += "{\"uid\":" + std::to_string(i) + ",\"x\":" + std::to_string(i * 100 + n) + ",\"y\":-5},";
+    s += "{}]}\n";
+    return s;
+}
+
+// Bytes that do not compress
+std::string noise(size_t n) {
+    std::string s(n, '\0');
+    uint32_t x = 2463534242u;
+    for (char& c : s) { x ^= x << 13; x ^= x >> 17; x ^= x << 5; c = (char)x; }
+    return s;
+}
+
+void set_u32(std::string& f, size_t at, uint32_t v) { for (int i = 0; i < 4; ++i) f[at + i] = (char)(v >> (8 * i)); }
+
+} // namespace
+
+TEST(lz_round_trips_with_and_without_dictionary) {
+    const std::string a = state_line(1), b = state_line(2);
+    std::string c, back;
+    CHECK(tcp_protocol::lz_compress(a.data(), a.size(), nullptr, 0, c));
+    CHECK(c.size() < a.size());
+    CHECK(tcp_protocol::lz_decompress(c.data(), c.size(), nullptr, 0, a.size(), back) && back == a);
+    std::string cd;
+    CHECK(tcp_protocol::lz_compress(b.data(), b.size(), a.data(), a.size(), cd));
+    CHECK(cd.size() < c.size()); // the previous line is most of this one
+    CHECK(tcp_protocol::lz_decompress(cd.data(), cd.size(), a.data(), a.size(), b.size(), back) && back == b);
+    // Without the dictionary its matches point before the start
+    CHECK(!tcp_protocol::lz_decompress(cd.data(), cd.size(), nullptr, 0, b.size(), back));
+}
+
+TEST(lz_leaves_incompressible_input) {
+    const std::string s = noise(4096);
+    std::string out = "kept";
+    CHECK(!tcp_protocol::lz_compress(s.data(), s.size(), nullptr, 0, out));
+    CHECK(out == "kept");
+    CHECK(tcp_protocol::build_compressed_frame(s, nullptr).empty());
+}
+
+TEST(lz_frame_chain_round_trips) {
+    LzDecoder dec;
+    std::string prev, raw;
+    for (int i = 0; i < 5; ++i) {
+        const std::string line = state_line(i);
+        const std::string f = tcp_protocol::build_compressed_frame(line, prev.empty() ? nullptr : &prev);
+        CHECK(!f.empty());
+        CHECK(tcp_protocol::frame_length(f.data(), f.size()) == f.size());
+        CHECK(dec.decode(f.data(), f.size(), raw) && raw == line);
+        prev = line;
+    }
+}
+
+TEST(lz_frame_needs_its_dictionary) {
+    const std::string a = state_line(1), b = state_line(2), c = state_line(3);
+    const std::string fa = tcp_protocol::build_compressed_frame(a, nullptr);
+    const std::string fb = tcp_protocol::build_compressed_frame(b, &a);
+    const std::string fc = tcp_protocol::build_compressed_frame(c, &b);
+    LzDecoder dec; std::string raw;
+    CHECK(!dec.decode(fb.data(), fb.size(), raw)); // never had a
+    CHECK(dec.decode(fa.data(), fa.size(), raw));
+    CHECK(!dec.decode(fc.data(), fc.size(), raw)); // b was lost
+    // A failed frame leaves the dictionary as it was
+    CHECK(dec.decode(fb.data(), fb.size(), raw) && raw == b);
+    CHECK(dec.decode(fc.data(), fc.size(), raw) && raw == c);
+}
+
+TEST(lz_frame_rejects_malformed) {
+    const std::string line = state_line(7);
+    const std::string f = tcp_protocol::build_compressed_frame(line, nullptr);
+    std::string raw;
+    for (size_t n = 0; n < f.size(); ++n) {
+        LzDecoder dec;
+        CHECK(tcp_protocol::frame_length(f.data(), n) == 0);
+        CHECK(!dec.decode(f.data(), n, raw));
+    }
+    // Payload size, raw size and hash that disagree with the payload
+    const size_t kPayload = 4, kRaw = 8, kHash = 12;
+    const uint32_t payload = (uint32_t)(f.size() - tcp_protocol::kDeltaHeaderSize);
+    std::string bad = f; set_u32(bad, kPayload, payload - 1);
+    { LzDecoder dec; CHECK(!dec.decode(bad.data(), bad.size(), raw)); }
+    bad = f; set_u32(bad, kRaw, (uint32_t)line.size() + 1);
+    { LzDecoder dec; CHECK(!dec.decode(bad.data(), bad.size(), raw)); }
+    bad = f; set_u32(bad, kRaw, 0xFFFFFFFFu); // refused before allocating
+    { LzDecoder dec; CHECK(!dec.decode(bad.data(), bad.size(), raw)); }
+    bad = f; set_u32(bad, kHash, tcp_protocol::lz_hash(line.data(), line.size()) ^ 1);
+    { LzDecoder dec; CHECK(!dec.decode(bad.data(), bad.size(), raw)); }
+    bad = f; bad[2] = (char)tcp_protocol::kFrameKindState;
+    { LzDecoder dec; CHECK(!dec.decode(bad.data(), bad.size(), raw)); }
+    // Every single-byte corruption of the payload is caught
+    for (size_t i = tcp_protocol::kDeltaHeaderSize; i < f.size(); ++i) {
+        bad = f; bad[i] = (char)(bad[i] ^ 0x5A);
+        LzDecoder dec;
+        CHECK(!dec.decode(bad.data(), bad.size(), raw));
+    }
+}
@@ -0,0 +1,108 @@
+// SendQueue: superseding state messages and the compressed dictionary chain.
+
+#include "test.h"
+
+#include "stream_io/lz_frame.h"
+#include "stream_io/send_queue.h"
+
+#include <memory>
+#include <string>
+
+using tcp_protocol::SendQueue;
+
+namespace {
+
+using Msg = std::shared_ptr<const std::string>;
+
+Msg text(const std::string& s) { return std::make_shared<const std::string>(s); }
+
+// A state-like line that compresses well and differs a little per n
+std::string state_line(int n) {
+    std::string s = "{\"type\":\"state\",\"ships\":[";
+    for (int i = 0; i < 40; ++i) s += "{\"uid\":" + std::to_string(i) + ",\"x\":" + std::to_string(i * 100 + n) + ",\"y\":0},";
+    s += "{}]}\n";
+    return s;
+}
+
+// Queue msg as the server does for a kCapLzDict client
+void queue_compressed(SendQueue& q, const std::string& msg, bool state) {
+    if (state) q.supersede();
+    Msg raw = text(msg);
+    Msg dict = q.lz_dictionary();
+    std::string f = tcp_protocol::build_compressed_frame(*raw, dict.get());
+    if (f.empty()) q.push(raw, state);
+    else q.push(text(f), state, raw, dict);
+}
+
+// Write the whole queue, decoding compressed messages in order; returns the
+// raw messages received, or stops at the first one that does not decode
+std::vector<std::string> drain(SendQueue& q, tcp_protocol::LzDecoder& dec, bool* ok) {
+    std::vector<std::string> got;
+    *ok = true;
+    while (!q.empty()) {
+        const tcp_protocol::Pending& m = q.msgs.front();
+        std::string raw = *m.data;
+        if (m.raw && !dec.decode(m.data->data(), m.data->size(), raw)) { *ok = false; return got; }
+        got.push_back(raw);
+        q.written(m.data->size());
+    }
+    return got;
+}
+
+} // namespace
+
+TEST(send_queue_newer_state_supersedes_unsent) {
+    SendQueue q;
+    q.push(text("reply\n"), false);
+    q.push(text("state 1\n"), true);
+    q.push(text("state 2\n"), true);
+    CHECK(q.msgs.size() == 2);
+    CHECK(*q.msgs[1].data == "state 2\n");
+    CHECK(q.dropped_frames == 1 && q.dropped_bytes == 8);
+    CHECK(q.bytes == 6 + 8);
+}
+
+TEST(send_queue_keeps_started_state) {
+    SendQueue q;
+    q.push(text("state 1\n"), true);
+    q.written(3);
+    q.push(text("state 2\n"), true);
+    CHECK(q.msgs.size() == 2);
+    CHECK(q.front_off == 3);
+    CHECK(q.bytes == 5 + 8);
+    q.written(5);
+    CHECK(q.msgs.size() == 1 && q.front_off == 0);
+}
+
+TEST(send_queue_reply_between_state_frames_round_trips) {
+    // A reply compressed against an unsent state frame keeps that frame
+    // alive when the next state frame arrives
+    SendQueue q;
+    tcp_protocol::LzDecoder dec;
+    const std::string s1 = state_line(1), reply = state_line(2), s2 = state_line(3);
+    queue_compressed(q, s1, true);
+    queue_compressed(q, reply, false);
+    queue_compressed(q, s2, true);
+    CHECK(q.dropped_frames == 0);
+    bool ok = false;
+    const std::vector<std::string> got = drain(q, dec, &ok);
+    CHECK(ok);
+    CHECK(got.size() == 3 && got[0] == s1 && got[1] == reply && got[2] == s2);
+    CHECK(q.lz_sent && *q.lz_sent == s2);
+}
+
+TEST(send_queue_drops_state_no_one_depends_on) {
+    SendQueue q;
+    tcp_protocol::LzDecoder dec;
+    queue_compressed(q, state_line(1), true);
+    queue_compressed(q, state_line(2), true);
+    queue_compressed(q, state_line(3), true);
+    CHECK(q.msgs.size() == 1 && q.dropped_frames == 2);
+    bool ok = false;
+    const std::vector<std::string> got = drain(q, dec, &ok);
+    CHECK(ok && got.size() == 1 && got[0] == state_line(3));
+    // The chain continues from what was written
+    queue_compressed(q, state_line(4), true);
+    CHECK(q.msgs.size() == 1 && q.msgs[0].dict == q.lz_sent);
+    CHECK(drain(q, dec, &ok).size() == 1 && ok);
+}
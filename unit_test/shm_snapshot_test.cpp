@@ -0,0 +1,97 @@
+// ShmSnapshotReader: newest-frame reads and a corrupt or foreign mapping.
+
+#include "test.h"
+
+#include "stream_io/interest.h"
+#include "stream_io/shm_snapshot.h"
+#include "stream_io/state_frame.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using tcp_protocol::ShmSnapshotReader;
+using tcp_protocol::ShmSnapshotWriter;
+
+namespace {
+
+std::string shm_name(const char* what) { return "/focm_test." + std::to_string((long)::getpid()) + "." + what; }
+
+// A frame told apart by its one summary's ship count
+std::string frame(uint32_t ships) {
+    tcp_protocol::InterestSelection sel;
+    tcp_protocol::RegionSummary s; s.team = 1; s.x = 10.0; s.y = -20.0; s.ships = ships;
+    sel.summaries.push_back(s);
+    return tcp_protocol::build_state_frame(sel);
+}
+
+// ships of the summary read, or -1 when nothing was read
+long read_ships(ShmSnapshotReader& r) {
+    std::vector<tcp_protocol::NetObjectView> objs; std::vector<tcp_protocol::RegionSummary> sums;
+    if (!r.read_latest(objs, &sums) || sums.size() != 1) return -1;
+    return (long)sums[0].ships;
+}
+
+// Writable view of the object, as a buggy or hostile writer would have it
+struct RawMapping {
+    char* p = nullptr; size_t n = 0;
+    RawMapping(const std::string& name, size_t size) : n(size) {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd >= 0) { void* m = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); ::close(fd); if (m != MAP_FAILED) p = (char*)m; }
+    }
+    ~RawMapping() { if (p) ::munmap(p, n); }
+};
+
+} // namespace
+
+TEST(shm_reader_gets_the_newest_frame_once) {
+    ShmSnapshotWriter w;
+    CHECK(w.create(shm_name("newest"), 4096));
+    ShmSnapshotReader r;
+    CHECK(r.open(w.name()));
+    CHECK(read_ships(r) == -1); // nothing published yet
+    w.publish(frame(1).data(), frame(1).size());
+    CHECK(read_ships(r) == 1);
+    CHECK(read_ships(r) == -1); // nothing new
+    for (uint32_t i = 2; i <= 6; ++i) w.publish(frame(i).data(), frame(i).size());
+    CHECK(read_ships(r) == 6);
+    // Too large for a slot: counted and skipped, the previous frame stays
+    const std::string big(8192, 'x');
+    w.publish(big.data(), big.size());
+    CHECK(read_ships(r) == -1);
+    w.publish(frame(7).data(), frame(7).size());
+    CHECK(read_ships(r) == 7);
+}
+
+TEST(shm_reader_rejects_bad_contents) {
+    ShmSnapshotWriter w;
+    CHECK(w.create(shm_name("bad"), 4096));
+    ShmSnapshotReader r;
+    CHECK(r.open(w.name()));
+    // Bytes that are not a state frame decode to nothing
+    const std::string junk = "not a frame";
+    w.publish(junk.data(), junk.size());
+    CHECK(read_ships(r) == -1);
+
+    w.publish(frame(3).data(), frame(3).size());
+    RawMapping raw(w.name(), 64 + 3 * (64 + 4096));
+    CHECK(raw.p != nullptr);
+    if (!raw.p) return;
+    uint64_t latest; std::memcpy(&latest, raw.p + 24, 8);
+    // A slot index past the slot count
+    const uint64_t bad_slot = (latest & ~(uint64_t)3) + (1 << 2) + 3;
+    std::memcpy(raw.p + 24, &bad_slot, 8);
+    CHECK(read_ships(r) == -1);
+    std::memcpy(raw.p + 24, &latest, 8);
+    CHECK(read_ships(r) == 3);
+
+    // A mapping with a foreign layout does not open
+    std::memset(raw.p, 0, 4);
+    ShmSnapshotReader other;
+    CHECK(!other.open(w.name()));
+    CHECK(!other.open(shm_name("missing")));
+}
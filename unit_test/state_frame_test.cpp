@@ -0,0 +1,101 @@
+// State stamps: frame and JSON round trips, unstamped and malformed frames.
+
+#include "test.h"
+
+#include "stream_io/interest.h"
+#include "stream_io/state_frame.h"
+#include "stream_io/tcp_protocol.h"
+
+#include <string>
+#include <vector>
+
+using tcp_protocol::NetObjectView;
+using tcp_protocol::RegionSummary;
+using tcp_protocol::StateStamp;
+
+namespace {
+
+tcp_protocol::InterestSelection selection() {
+    tcp_protocol::InterestSelection sel;
+    RegionSummary s; s.team = 2; s.x = 1024.0; s.y = -512.0; s.ships = 3; s.objects = 4;
+    sel.summaries.push_back(s);
+    return sel;
+}
+
+// A stamp past 32 bits of ticks, with a sim_time that is not a round number
+StateStamp stamp() { return StateStamp{(1ull << 40) + 5, 17179869184.078125, true}; }
+
+bool parse(const std::string& f, StateStamp& st, std::vector<RegionSummary>& sums) {
+    std::vector<NetObjectView> objs;
+    return tcp_protocol::parse_state_frame(f.data(), f.size(), objs, &sums, &st);
+}
+
+} // namespace
+
+TEST(stamp_record_round_trips) {
+    unsigned char buf[tcp_protocol::kFrameStampSize];
+    unsigned char* w = buf;
+    tcp_protocol::write_stamp_record(w, stamp());
+    CHECK(w == buf + sizeof(buf));
+    const unsigned char* r = buf;
+    const StateStamp got = tcp_protocol::read_stamp_record(r);
+    CHECK(r == buf + sizeof(buf));
+    CHECK(got.valid && got.tick == stamp().tick && got.sim_time == stamp().sim_time);
+}
+
+TEST(state_frame_stamp_round_trips) {
+    const StateStamp st = stamp();
+    const std::string f = tcp_protocol::build_state_frame(selection(), &st);
+    CHECK(f.size() == tcp_protocol::kFrameHeaderSize + tcp_protocol::kFrameStampSize + tcp_protocol::kFrameSummarySize);
+    CHECK(tcp_protocol::frame_length(f.data(), f.size()) == f.size());
+    StateStamp got; std::vector<RegionSummary> sums;
+    CHECK(parse(f, got, sums));
+    CHECK(got.valid && got.tick == st.tick && got.sim_time == st.sim_time);
+    CHECK(sums.size() == 1 && sums[0].team == 2 && sums[0].ships == 3 && sums[0].objects == 4);
+    CHECK(sums[0].x == 1024.0 && sums[0].y == -512.0);
+}
+
+TEST(state_frame_without_stamp_is_unstamped) {
+    const std::string f = tcp_protocol::build_state_frame(selection());
+    StateStamp got = stamp(); std::vector<RegionSummary> sums;
+    CHECK(parse(f, got, sums));
+    CHECK(!got.valid && got.tick == 0);
+    CHECK(sums.size() == 1 && sums[0].ships == 3);
+}
+
+TEST(state_json_stamp_round_trips) {
+    const StateStamp st = stamp();
+    std::string line;
+    tcp_protocol::write_state_json(line, selection(), "abc", &st);
+    std::vector<NetObjectView> objs; std::string hash; std::vector<RegionSummary> sums; StateStamp got;
+    CHECK(tcp_protocol::parse_state_objects(line, objs, &hash, &sums, &got));
+    CHECK(got.valid && got.tick == st.tick && got.sim_time == st.sim_time);
+    CHECK(hash == "abc" && sums.size() == 1);
+
+    line.clear();
+    tcp_protocol::write_state_json(line, selection(), "abc");
+    got = stamp();
+    CHECK(tcp_protocol::parse_state_objects(line, objs, &hash, &sums, &got));
+    CHECK(!got.valid);
+}
+
+TEST(state_frame_rejects_malformed) {
+    const StateStamp st = stamp();
+    const std::string f = tcp_protocol::build_state_frame(selection(), &st);
+    StateStamp got; std::vector<RegionSummary> sums;
+    // Incomplete: not yet a frame, and not decodable
+    for (size_t n = 0; n < f.size(); ++n) {
+        CHECK(tcp_protocol::frame_length(f.data(), n) == 0);
+        CHECK(!parse(f.substr(0, n), got, sums));
+    }
+    // Counts that do not fit the payload (the stamp flag with no room for it)
+    std::string bad = tcp_protocol::build_state_frame(selection());
+    bad[3] = (char)(bad[3] | tcp_protocol::kFrameFlagStamp);
+    CHECK(!parse(bad, got, sums));
+    bad = f; bad[1] = (char)(tcp_protocol::kStateFrameVersion + 1);
+    CHECK(!parse(bad, got, sums));
+    bad = f; bad[2] = (char)tcp_protocol::kFrameKindDelta;
+    CHECK(!parse(bad, got, sums));
+    bad = f; bad[0] = '{';
+    CHECK(!parse(bad, got, sums));
+}
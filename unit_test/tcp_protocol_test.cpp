@@ -0,0 +1,67 @@
+// parse_client_message: field checks on client lines.
+
+#include "test.h"
+
+#include "stream_io/tcp_protocol.h"
+
+#include <string>
+
+using tcp_protocol::ClientMsg;
+using tcp_protocol::parse_client_message;
+
+TEST(parse_state_ack_seq) {
+    ClientMsg m;
+    CHECK(parse_client_message(tcp_protocol::build_state_ack(4242), m));
+    CHECK(m.type == tcp_protocol::ClientMsgType::StateAck && m.seq == 4242);
+    CHECK(parse_client_message("{\"type\":\"state_ack\",\"seq\":4294967295}", m) && m.seq == 4294967295u);
+}
+
+TEST(parse_state_ack_rejects_seq_out_of_range) {
+    const char* lines[] = {
+        "{\"type\":\"state_ack\",\"seq\":4294967296}",
+        "{\"type\":\"state_ack\",\"seq\":-1}",
+    };
+    for (const char* l : lines) {
+        ClientMsg m; std::string err;
+        CHECK(!parse_client_message(l, m, &err));
+        CHECK(err == "bad seq");
+    }
+    ClientMsg m; std::string err;
+    CHECK(!parse_client_message("{\"type\":\"state_ack\"}", m, &err) && err == "missing seq");
+}
+
+TEST(parse_join_team_range) {
+    ClientMsg m; std::string err;
+    CHECK(parse_client_message("{\"type\":\"join\",\"team\":2}", m) && m.team == 2);
+    CHECK(parse_client_message("{\"type\":\"join\"}", m) && m.team == -1);
+    m = ClientMsg();
+    CHECK(!parse_client_message("{\"type\":\"join\",\"team\":4294967298}", m, &err) && err == "bad team");
+    CHECK(!parse_client_message("{\"type\":\"join\",\"team\":-2147483649}", m, &err) && err == "bad team");
+}
+
+TEST(join_request_round_trips) {
+    tcp_protocol::JoinRequest j;
+    j.name = "ui"; j.defs_hash = "abc"; j.team = 3; j.caps = {"bin1", "lz1"}; j.session = 2;
+    j.rate = 20.0; j.max_bps = 50000.0; j.compress_min = 512; j.resume_token = 77;
+    ClientMsg m;
+    CHECK(parse_client_message(tcp_protocol::build_join(j), m));
+    CHECK(m.type == tcp_protocol::ClientMsgType::Join && m.defs_hash == "abc" && m.team == 3 && m.session == 2);
+    CHECK(m.caps == j.caps && m.rate == 20.0 && m.max_bps == 50000.0 && m.compress_min == 512 && m.resume == 77);
+}
+
+TEST(joined_reply_round_trips) {
+    tcp_protocol::JoinedReply r;
+    r.defs_hash = "abc"; r.has_match = true; r.match = false; r.def_keys = {"ship1", "rock"};
+    r.state_format = "delta1"; r.udp_token = 5; r.shm_name = "/focm"; r.compression = "lz1dict";
+    r.resume_token = 9; r.resumed = true; r.pending = {"THROTTLE 1 0.5"};
+    tcp_protocol::JoinedReply got;
+    CHECK(tcp_protocol::parse_joined(tcp_protocol::build_joined_reply(r), got));
+    CHECK(got.defs_hash == "abc" && got.has_match && !got.match && got.def_keys == r.def_keys);
+    CHECK(got.state_format == "delta1" && got.udp_token == 5 && got.shm_name == "/focm" && got.compression == "lz1dict");
+    CHECK(got.resume_token == 9 && got.resumed && got.pending == r.pending);
+
+    // Optional fields left out read back empty
+    CHECK(tcp_protocol::parse_joined(tcp_protocol::build_joined_reply(tcp_protocol::JoinedReply()), got));
+    CHECK(!got.has_match && got.def_keys.empty() && got.state_format.empty() && !got.resume_token && !got.resumed);
+    CHECK(!tcp_protocol::parse_joined("{\"type\":\"ack\"}", got));
+}
@@ -0,0 +1,26 @@
+// Minimal harness for the focm_tests binary: TEST cases register themselves
+// at startup, CHECK reports a failed condition and lets the case go on.
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace unit_test {
+
+struct Case { const char* name; void (*fn)(); };
+std::vector<Case>& cases();
+extern int failures;
+
+struct Register {
+    Register(const char* name, void (*fn)()) { cases().push_back(Case{name, fn}); }
+};
+
+} // namespace unit_test
+
+#define TEST(name) \
+    static void test_##name(); \
+    static unit_test::Register register_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) { ++unit_test::failures; std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
@@ -0,0 +1,25 @@
+// Runs every registered TEST case (or those whose name contains argv[1]).
+
+#include "test.h"
+
+#include <cstring>
+
+namespace unit_test {
+
+std::vector<Case>& cases() { static std::vector<Case> all; return all; }
+int failures = 0;
+
+} // namespace unit_test
+
+int main(int argc, char** argv) {
+    int run = 0, failed = 0;
+    for (const auto& c : unit_test::cases()) {
+        if (argc > 1 && !std::strstr(c.name, argv[1])) continue;
+        const int before = unit_test::failures;
+        c.fn();
+        ++run;
+        if (unit_test::failures != before) { ++failed; std::printf("FAIL %s\n", c.name); }
+    }
+    std::printf("%d/%d test cases passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// TickScheduler: steps owed per wakeup and the stats reported for them.
+
+#include "test.h"
+
+#include "stream_io/tick_scheduler.h"
+
+namespace {
+
+constexpr double kDt = 1.0 / 64.0;
+
+} // namespace
+
+TEST(tick_scheduler_counts_steps_run) {
+    TickConfig cfg; cfg.max_catchup_steps = 32;
+    TickScheduler s(kDt, cfg);
+    CHECK(s.on_tick(1.0) == 0);
+    CHECK(s.on_tick(1.0 + 10 * kDt) == 10);
+    // A turn came due after 4 steps: the other 6 are neither taken nor dropped
+    s.record_work(4, 0.0);
+    CHECK(s.stats().steps == 4 && s.stats().dropped_sim_time == 0.0);
+    CHECK(s.on_tick(1.0 + 11 * kDt) == 7);
+    s.record_work(7, 0.0);
+    CHECK(s.stats().steps == 11 && s.stats().ticks == 3);
+}
+
+TEST(tick_scheduler_drops_past_the_catchup_budget) {
+    TickConfig cfg; cfg.max_catchup_steps = 8;
+    TickScheduler s(kDt, cfg);
+    s.on_tick(0.0);
+    CHECK(s.on_tick(20 * kDt) == 8);
+    s.record_work(8, 0.0);
+    CHECK(s.stats().steps == 8 && s.stats().catchup_overruns == 1);
+    CHECK(s.stats().dropped_sim_time > 11.9 * kDt && s.stats().dropped_sim_time < 12.1 * kDt);
+}
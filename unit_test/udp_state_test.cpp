@@ -0,0 +1,100 @@
+// UdpReassembler: fragment order, superseded frames and malformed datagrams.
+
+#include "test.h"
+
+#include "stream_io/udp_state.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using tcp_protocol::UdpReassembler;
+
+namespace {
+
+// Datagrams of one state frame, as the server sends them
+std::vector<std::string> fragments(const std::string& frame, uint32_t seq) {
+    const size_t count = tcp_protocol::udp_fragment_count(frame.size());
+    std::vector<std::string> out;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t off = i * tcp_protocol::kUdpFragmentPayload;
+        const size_t len = std::min(tcp_protocol::kUdpFragmentPayload, frame.size() - off);
+        std::string d(tcp_protocol::kUdpHeaderSize, '\0');
+        tcp_protocol::write_udp_header((unsigned char*)&d[0], tcp_protocol::kUdpKindState, (uint16_t)i, (uint16_t)count, seq);
+        d.append(frame, off, len);
+        out.push_back(d);
+    }
+    return out;
+}
+
+std::string frame_of(size_t n, char seed) {
+    std::string f(n, '\0');
+    for (size_t i = 0; i < n; ++i) f[i] = (char)(seed + i * 7);
+    return f;
+}
+
+bool add(UdpReassembler& r, const std::string& d) { return r.add(d.data(), d.size()); }
+
+} // namespace
+
+TEST(udp_reassembles_in_any_order) {
+    const std::string f = frame_of(3 * tcp_protocol::kUdpFragmentPayload + 17, 'a');
+    std::vector<std::string> d = fragments(f, 1);
+    CHECK(d.size() == 4);
+    UdpReassembler r;
+    CHECK(!add(r, d[3]) && !add(r, d[0]) && !add(r, d[2]));
+    CHECK(add(r, d[1]));
+    CHECK(r.frame() == f && r.seq() == 1 && r.lost_frames() == 0);
+    // Duplicates of a completed frame are stale
+    CHECK(!add(r, d[1]));
+
+    const std::string small = frame_of(10, 'z');
+    CHECK(add(r, fragments(small, 2)[0]) && r.frame() == small && r.seq() == 2);
+}
+
+TEST(udp_newer_frame_supersedes_incomplete_one) {
+    const std::string a = frame_of(2 * tcp_protocol::kUdpFragmentPayload, 'a');
+    const std::string b = frame_of(100, 'b');
+    UdpReassembler r;
+    CHECK(!add(r, fragments(a, 1)[0]));
+    CHECK(add(r, fragments(a, 1)[1]));
+    const std::vector<std::string> a2 = fragments(a, 2);
+    CHECK(!add(r, a2[0]));
+    CHECK(add(r, fragments(b, 4)[0]) && r.frame() == b && r.seq() == 4);
+    CHECK(r.lost_frames() == 2); // 2 abandoned, 3 never seen
+    CHECK(!add(r, a2[1]));      // late fragment of the abandoned frame
+}
+
+TEST(udp_seq_wraps) {
+    UdpReassembler r;
+    const std::string f = frame_of(5, 'w');
+    CHECK(add(r, fragments(f, 0xFFFFFFFFu)[0]));
+    CHECK(add(r, fragments(f, 0)[0]) && r.seq() == 0 && r.lost_frames() == 0);
+}
+
+TEST(udp_rejects_malformed_datagrams) {
+    UdpReassembler r;
+    const std::string f = frame_of(2 * tcp_protocol::kUdpFragmentPayload + 5, 'm');
+    const std::vector<std::string> d = fragments(f, 1);
+    CHECK(!add(r, d[0].substr(0, tcp_protocol::kUdpHeaderSize - 1)));
+    std::string bad = d[2]; bad[0] = 0;
+    CHECK(!add(r, bad));
+    bad = d[2]; bad[2] = 3; // index past count
+    CHECK(!add(r, bad));
+    bad = d[2]; bad[4] = 0; bad[5] = 0; // no fragments
+    CHECK(!add(r, bad));
+    CHECK(!add(r, d[0].substr(0, d[0].size() - 1))); // short fragment before the last
+    CHECK(!add(r, d[2] + std::string(tcp_protocol::kUdpFragmentPayload, 'x'))); // oversize
+    CHECK(!add(r, tcp_protocol::build_udp_hello(5)));
+    // None of that disturbed reassembly
+    CHECK(!add(r, d[0]) && !add(r, d[1]) && add(r, d[2]) && r.frame() == f);
+}
+
+TEST(udp_hello_round_trips) {
+    uint64_t token = 0;
+    const std::string h = tcp_protocol::build_udp_hello(0x123456789abcdefULL);
+    CHECK(tcp_protocol::parse_udp_hello(h.data(), h.size(), &token) && token == 0x123456789abcdefULL);
+    CHECK(!tcp_protocol::parse_udp_hello(h.data(), h.size() - 1, &token));
+    const std::string state = fragments("x", 1)[0];
+    CHECK(!tcp_protocol::parse_udp_hello(state.data(), state.size(), &token));
+}